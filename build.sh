@@ -532,22 +532,32 @@ export  PHASE1LIST="\
         src/lisa/io_board/floppy          \
         src/storage/profile               \
         src/storage/hle                   \
+        src/storage/floppylib             \
         src/lisa/motherboard/unvars       \
         src/lisa/motherboard/vars         \
         src/lisa/motherboard/glue         \
         src/lisa/motherboard/fliflo_queue \
+        src/lisa/motherboard/inputlog     \
+        src/lisa/motherboard/screenhash   \
+        src/lisa/motherboard/shmvideo     \
+        src/lisa/motherboard/screenrec    \
         src/lisa/io_board/cops            \
+        src/lisa/io_board/keyinject       \
         src/lisa/io_board/z8530           \
         src/lisa/io_board/z8530-telnetd   \
         src/lisa/io_board/z8530-pty       \
         src/lisa/io_board/z8530-tty       \
         src/lisa/io_board/z8530-shell     \
+        src/lisa/io_board/z8530-iothread  \
+        src/lisa/io_board/z8530-mux       \
         src/lisa/io_board/via6522         \
         src/lisa/cpu_board/irq            \
         src/lisa/cpu_board/mmu            \
         src/lisa/cpu_board/rom            \
         src/lisa/cpu_board/romless        \
         src/lisa/cpu_board/memory         \
+        src/printer/imagewriter/iw-stream \
+        src/printer/imagewriter/iw-spool  \
         src/lisa/motherboard/symbols"
 
 export  PHASE2INEXT=cpp PHASE2OUTEXT=o PHASE2OBJDIR=obj
@@ -134,9 +134,11 @@ void LisaConfig::Load(wxFileConfig *config, uint8 *floppy_ram)
    serial1_setting = config->Read(_T("/seriala/connecta"));
    serial1xon = config->Read(_T("/seriala/xon"), "1");
    serial1_param = config->Read(_T("/seriala/parama"));
+   serial1rxmode = config->Read(_T("/seriala/rxmode"), 0L);
    serial2_setting = config->Read(_T("/serialb/connectb"));
    serial2xon = config->Read(_T("/serialb/xon"), "1");
    serial2_param = config->Read(_T("/serialb/paramb"));
+   serial2rxmode = config->Read(_T("/serialb/rxmode"), 0L);
 
    ioromstr = config->Read(_T("ioromver"));
    ioromstr = _T("0x") + ioromstr;
@@ -259,9 +261,11 @@ void LisaConfig::Save(wxFileConfig *config, uint8 *floppy_ram)
    config->Write(_T("/seriala/connecta"), serial1_setting);
    config->Write(_T("/seriala/xon"), serial1xon);
    config->Write(_T("/seriala/parama"), serial1_param);
+   config->Write(_T("/seriala/rxmode"), serial1rxmode);
    config->Write(_T("/serialb/connectb"), serial2_setting);
    config->Write(_T("/serialb/xon"), serial2xon);
    config->Write(_T("/serialb/paramb"), serial2_param);
+   config->Write(_T("/serialb/rxmode"), serial2rxmode);
    config->Write(_T("/ioromver"), ioromstr);
    config->Write(_T("/MemoryKB"), (long)mymaxlisaram);
 
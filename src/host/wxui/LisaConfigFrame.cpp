@@ -152,6 +152,8 @@ LisaConfigFrame::LisaConfigFrame(const wxString &title, LisaConfig *lisaconfig)
     my_lisaconfig = lisaconfig;
     serialabox = NULL;
     serialbbox = NULL;
+    serialarx = NULL;
+    serialbrx = NULL;
     m_dirty = false;
     slotbook = NULL;
     slotpick = NULL;
@@ -173,6 +175,10 @@ LisaConfigFrame::LisaConfigFrame(const wxString &title, LisaConfig *lisaconfig)
     nothingonly[0] = _T("Nothing");
     nothingonly[1] = _T("Loopback");
 
+    serrxopts[0] = _T("One byte at a time");
+    serrxopts[1] = _T("Programmed baud rate");
+    serrxopts[2] = _T("Unlimited");
+
     serportopts[0] = _T("Nothing");
     serportopts[1] = _T("Loopback");
     serportopts[2] = _T("Pipe");
@@ -185,7 +191,8 @@ LisaConfigFrame::LisaConfigFrame(const wxString &title, LisaConfig *lisaconfig)
     serportopts[7] = _T("Shell");
     serportopts[8] = _T("Serial");
     serportopts[9] = _T("PseudoTTY");
-    serialopts = 10;
+    serportopts[10] = _T("Mux");
+    serialopts = 11;
 #else
     serialopts = 6;
 #endif
@@ -494,6 +501,8 @@ void LisaConfigFrame::ApplyChanges()
         return;
     if (!serialbxon)
         return;
+    if (!serialarx || !serialbrx)
+        return;
     if (!m_propath)
         return;
     if (!pportbox)
@@ -534,6 +543,8 @@ void LisaConfigFrame::ApplyChanges()
 
     my_lisaconfig->serial1xon = serialaxon->GetValue() ? "1" : "0";
     my_lisaconfig->serial2xon = serialbxon->GetValue() ? "1" : "0";
+    my_lisaconfig->serial1rxmode = serialarx->GetSelection();
+    my_lisaconfig->serial2rxmode = serialbrx->GetSelection();
 
     consoletermwindow = console_term->GetValue() ? 1 : 0;
     /*
@@ -659,7 +670,7 @@ void LisaConfigFrame::ApplyChanges()
                                 (dipsw1_5->GetSelection() << 4) |
                                 (dipsw1_67->GetSelection() << 5) |
                                 (dipsw1_8->GetValue() ? 128 : 0);
-    my_lisaconfig->iw_png_on = iw_img_box->GetValue();
+    my_lisaconfig->iw_png_on = iw_img_box->GetSelection();
     my_lisaconfig->iw_png_path = iw_img_path->GetValue();
 
     save_configs();
@@ -1013,6 +1024,13 @@ wxPanel *LisaConfigFrame::CreatePortsConfigPage(wxNotebook *parent)
         r2->Add(serialaparam, 1, wxALIGN_CENTER_VERTICAL);
         g->Add(r2, 0, wxEXPAND | wxALL, B);
 
+        wxBoxSizer *r3 = new wxBoxSizer(wxHORIZONTAL);
+        r3->Add(new wxStaticText(panel, wxID_ANY, _T("Receive speed:")), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, B);
+        serialarx = new wxChoice(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, 3, serrxopts);
+        serialarx->SetSelection((my_lisaconfig->serial1rxmode >= 0 && my_lisaconfig->serial1rxmode < 3) ? my_lisaconfig->serial1rxmode : 0);
+        r3->Add(serialarx, 0, wxALIGN_CENTER_VERTICAL);
+        g->Add(r3, 0, wxEXPAND | wxALL, B);
+
         page->Add(g, 0, wxEXPAND | wxALL, B);
     }
 
@@ -1039,6 +1057,13 @@ wxPanel *LisaConfigFrame::CreatePortsConfigPage(wxNotebook *parent)
         r2->Add(serialbparam, 1, wxALIGN_CENTER_VERTICAL);
         g->Add(r2, 0, wxEXPAND | wxALL, B);
 
+        wxBoxSizer *r3 = new wxBoxSizer(wxHORIZONTAL);
+        r3->Add(new wxStaticText(panel, wxID_ANY, _T("Receive speed:")), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, B);
+        serialbrx = new wxChoice(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, 3, serrxopts);
+        serialbrx->SetSelection((my_lisaconfig->serial2rxmode >= 0 && my_lisaconfig->serial2rxmode < 3) ? my_lisaconfig->serial2rxmode : 0);
+        r3->Add(serialbrx, 0, wxALIGN_CENTER_VERTICAL);
+        g->Add(r3, 0, wxEXPAND | wxALL, B);
+
         page->Add(g, 0, wxEXPAND | wxALL, B);
     }
 
@@ -1130,8 +1155,10 @@ wxPanel *LisaConfigFrame::CreatePrinterConfigPage(wxNotebook *parent)
     {
         wxStaticBoxSizer *g = new wxStaticBoxSizer(wxVERTICAL, panel, _T("Output"));
 
-        iw_img_box = new wxCheckBox(panel, wxID_ANY, _T("Print to images"));
-        iw_img_box->SetValue((bool)(!!my_lisaconfig->iw_png_on));
+        wxString iwoutopts[] = {wxT("Host printer"), wxT("PNG images"), wxT("PDF document")};
+        iw_img_box = new wxRadioBox(panel, wxID_ANY, _T("Print to"), wxDefaultPosition, wxDefaultSize,
+                                    3, iwoutopts, 1, wxRA_SPECIFY_ROWS);
+        iw_img_box->SetSelection((my_lisaconfig->iw_png_on >= 0 && my_lisaconfig->iw_png_on <= 2) ? my_lisaconfig->iw_png_on : 0);
         g->Add(iw_img_box, 0, wxALL, B);
 
         wxBoxSizer *r = new wxBoxSizer(wxHORIZONTAL);
@@ -37,9 +37,10 @@ public:
     wxString serial2_param;
     wxString ioromstr;
     wxString serial1xon, serial2xon;
+    long serial1rxmode, serial2rxmode; // SCC_RX_ONEBYTE, SCC_RX_BAUD, SCC_RX_UNLIMITED
 
     wxString iw_png_path; // path to directory to store printouts if png is on
-    int iw_png_on;        // do we save printouts as PNG's or to the host printer?
+    int iw_png_on;        // host printer, PNG's or PDF's: IW_PRINT_OUT, IW_PNG_OUT, IW_PDF_OUT
     int iw_dipsw_1;       // dip switch for imagewriter
 
     long int saw_3a_warning;
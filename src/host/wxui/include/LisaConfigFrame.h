@@ -111,6 +111,8 @@ public:
     wxTextCtrl *serialbparam;
     wxCheckBox *serialaxon;
     wxCheckBox *serialbxon;
+    wxChoice *serialarx;
+    wxChoice *serialbrx;
     wxCheckBox *serialalimit;
     wxCheckBox *serialblimit;
 
@@ -119,6 +121,7 @@ public:
 
     wxString nothingonly[2];
     wxString serportopts[12];
+    wxString serrxopts[3]; // indexed by SCC_RX_ONEBYTE, SCC_RX_BAUD, SCC_RX_UNLIMITED
     int serialopts;
 
     // ImageWriter settings
@@ -128,7 +131,7 @@ public:
     wxChoice *dipsw1_67;
     wxCheckBox *dipsw1_8;
 
-    wxCheckBox *iw_img_box;  // print to images or printer
+    wxRadioBox *iw_img_box;  // print to the host printer, PNG images or a PDF
     wxTextCtrl *iw_img_path; // dir path to store images
     wxButton *iw_img_path_b; // path browse button
 
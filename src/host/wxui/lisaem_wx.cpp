@@ -230,6 +230,7 @@ long emulation_time = 25;
 extern "C"
 {
 #include <vars.h>
+#include <iw-spool.h>
   int32 reg68k_external_execute(int32 clocks);
   void unvars(void);
   void on_lisa_exit(void);
@@ -360,11 +361,22 @@ static int on_start_poweron = 0,
            on_start_center = 0,
            on_start_harddisk = 0,
            on_start_quit_on_poweroff = 0,
+           on_start_absmouse = 0,
            box_x = -1, box_y = -1, box_xh = -1, box_yh = -1; // used for screengrab
 static double on_start_zoom = 0.0;
 
 wxString on_start_lisaconfig = "",
-         on_start_floppy = "";
+         on_start_floppy = "",
+         on_start_record = "",
+         on_start_replay = "",
+         on_start_shm = "",
+         on_start_screenrec = "",
+         on_start_muxa = "",
+         on_start_muxb = "",
+         on_start_spool = "",
+         on_start_floppylib = "",
+         on_start_disks = "",
+         on_start_type = "";
 
 // actions to do about 20s after startup - initialize scc after BOOT ROM tests of SCC are done. Dispatched via LisaWin::OnMouseMove
 // not related to command line options
@@ -391,6 +403,20 @@ static const wxCmdLineEntryDesc cmdLineDesc[] =
         {wxCMD_LINE_OPTION, "c", "config", "Open which lisaem config file", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
 
         {wxCMD_LINE_SWITCH, "k", "kiosk", "kiosk mode (suitable for RPi Lisa case)", wxCMD_LINE_VAL_NONE, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "r", "record", "record all host input to this log from power on", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "R", "replay", "replay host input from this log, ignoring live input", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "m", "shm", "export the Lisa's video in this POSIX shared memory segment", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_SWITCH, "t", "turbo", "turbo mode: run as fast as possible, no real time pacing", wxCMD_LINE_VAL_NONE, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_SWITCH, "x", "fastfloppy", "fast floppy controller: interrupt as soon as a sector is read or written", wxCMD_LINE_VAL_NONE, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "v", "screenrec", "record the Lisa's screen to this file (see lisa-screenrec-to-gif)", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "a", "muxa", "connect serial A to these ;-separated endpoints: listen:, connect:, pty:, log:, record:, replay:", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "b", "muxb", "connect serial B to these ;-separated endpoints, as for --muxa", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "S", "spool", "don't print, save what goes to the printers as raw jobs in this directory for --spoold", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "P", "spoold", "no GUI, rasterise the jobs spooled in dir[;png|pdf][;jobs=N] and serve them on dir/spool.sock", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_SWITCH, "A", "absmouse", "absolute mouse: queue the exact path to each pointer position instead of seeking it", wxCMD_LINE_VAL_NONE, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "y", "type", "type this at power on, {cmd-q} style key combos, {wait 5} for seconds, {disk 2} to insert disk 2 of --disks, {waitscreen x y w h hash} to wait for the screen (see keyinject.c), \\n for Return", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "l", "floppylib", "keep checked DC42 copies of the --disks images in this directory, shared read-only between instances", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+        {wxCMD_LINE_OPTION, "D", "disks", ";-separated set of floppy images for {disk N} in --type scripts", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
         {wxCMD_LINE_SWITCH, "o", "originctr", "skinless mode: center video(-o) vs topleft(-o-)", wxCMD_LINE_VAL_NONE,
 
          wxCMD_LINE_SWITCH_NEGATABLE
@@ -628,6 +654,7 @@ enum
   ID_THROTTLE128,
   ID_THROTTLE256,
   ID_THROTTLE512,
+  ID_TURBO,
 
   ID_ET100_75,
   ID_ET50_30,
@@ -811,6 +838,7 @@ public:
 #ifdef DEBUG
   void OnThrottle1(wxCommandEvent &event);
 #endif
+  void OnTurbo(wxCommandEvent &event);
 
   void OnET100_75(wxCommandEvent &event);
   void OnET50_30(wxCommandEvent &event);
@@ -1012,6 +1040,7 @@ EVT_MENU(ID_THROTTLE100, LisaEmFrame::OnThrottle100)
 EVT_MENU(ID_THROTTLE128, LisaEmFrame::OnThrottle128)
 EVT_MENU(ID_THROTTLE256, LisaEmFrame::OnThrottle256)
 EVT_MENU(ID_THROTTLE512, LisaEmFrame::OnThrottle512)
+EVT_MENU(ID_TURBO, LisaEmFrame::OnTurbo)
 
 EVT_MENU(ID_ET100_75, LisaEmFrame::OnET100_75)
 EVT_MENU(ID_ET50_30, LisaEmFrame::OnET50_30)
@@ -1697,6 +1726,14 @@ void LisaEmFrame::FloppyAnimation(void)
 
 
 
+// host driven mouse seeking runs off host time, so while input is being recorded or replayed
+// it's left to the 68K timer irq side alone, which is deterministic.
+static inline void host_seek_mouse_event(void)
+{
+    if (!inputlog_active() && !mouse_absolute)
+      seek_mouse_event();
+}
+
 void LisaEmFrame::VidRefresh(long now)
 {
     if (!my_lisawin)
@@ -1720,37 +1757,64 @@ void LisaEmFrame::VidRefresh(long now)
 
     screen_paint_update++; // used to figure out effective host refresh rate
     lastrefresh = cpu68k_clocks;
-    seek_mouse_event();
+    host_seek_mouse_event();
 }
 
 
 
+// in turbo mode the 68K runs in slices this long, and the display is refreshed at most this often
+#define TURBO_SLICE_CYCLES (ONE_SECOND / 10)
+#define TURBO_REFRESH_MS 250
+
 int LisaEmFrame::EmulateLoop(long idleentry)
 {
+    static int wasturbo = 0;
     long now = runtime.Time();
 
+    if (wasturbo != turbo_mode()) // pacing needs a new reference point either way
+    {
+      wasturbo = turbo_mode();
+      reset_throttle_clock();
+      update_menu_checkmarks();
+      now = runtime.Time();
+    }
+
     if (my_lisaframe->soundsw.Time() > 1000 && sound_effects_on) // OH WOW! When sound is looping it fails to stop here and we're stuck in a loop!
     {
       my_lisaframe->soundplaying = 0;
       wxSound::Stop();
     } // silence floppy motor if it hasn't been accessed in 500ms
 
-    seek_mouse_event(); // 2020.09.14
+    host_seek_mouse_event(); // 2020.09.14
 
     while (now - idleentry < emulation_time && running) // don't stay in OnIdleEvent for too long, else UI gets unresponsive
     {
       long cpuexecms = (long)((float)(cpu68k_clocks - cpu68k_reference) * clockfactor); // 68K CPU Execution in MS
-      seek_mouse_event();
+      host_seek_mouse_event();
 
-      if (cpuexecms <= now) // balance 68K CPU execution vs host time to honor throttle
+      if (cpuexecms <= now || wasturbo) // balance 68K CPU execution vs host time to honor throttle
       {
-        if (!cycles_wanted)
-          cycles_wanted = (XTIMER)(float)(emulation_time / clockfactor);
-        clx = clx + cycles_wanted; // add in any leftover cycles we didn't execute.
-                                   // but prevent it falling behind or jumping ahead
-                                   // too far.
-        clx = MIN(clx, 2 * cycles_wanted);
-        clx = MAX(clx, cycles_wanted / 2);
+        if (wasturbo) // no balancing at all, run until the time quota is up
+          clx = TURBO_SLICE_CYCLES;
+        else
+        {
+          if (!cycles_wanted)
+            cycles_wanted = (XTIMER)(float)(emulation_time / clockfactor);
+          clx = clx + cycles_wanted; // add in any leftover cycles we didn't execute.
+                                     // but prevent it falling behind or jumping ahead
+                                     // too far.
+          clx = MIN(clx, 2 * cycles_wanted);
+          clx = MAX(clx, cycles_wanted / 2);
+        }
+
+        if (inputlog_replaying()) // stop right where the next logged input event is due
+        {
+          inputlog_replay_due();
+          XTIMER next = inputlog_next_event();
+          if (next > cpu68k_clocks)
+            clx = MIN(clx, next - cpu68k_clocks);
+        }
+
         clx = reg68k_external_execute(clx); // execute some 68K code
 
         now = runtime.Time(); // find out how long we took
@@ -1768,6 +1832,12 @@ int LisaEmFrame::EmulateLoop(long idleentry)
 
         get_next_timer_event(); // handle any pending IRQ's/timer prep work
                                 // if we need to, refresh the display
+        if (wasturbo)
+        {
+          if (now - lastcrtrefresh > TURBO_REFRESH_MS) // drawing would only slow the 68K down
+            VidRefresh(now);
+        }
+        else
 #ifndef __WXOSX__
         if (now - lastcrtrefresh > refresh_rate_used) // OS X, esp slower PPC's suffer if we use the if statement
 #endif
@@ -1775,7 +1845,7 @@ int LisaEmFrame::EmulateLoop(long idleentry)
           VidRefresh(now);
         } // but if we don't, Linux under X11 gets too slow.
 
-        seek_mouse_event();
+        host_seek_mouse_event();
       } // loop if we didn't go over our time quota
       else
         break; // else force exit, time quota is up
@@ -1855,6 +1925,8 @@ void LisaEmFrame::Update_Status(long elapsed,long idleentry)
         profile_total_num_sectors_read, profile_total_num_sectors_written
       );
 
+    if (turbo_mode())
+      text.Prepend(_T("TURBO "));
     SetStatusBarText(text);
     screen_paint_update = 0;
 
@@ -2002,7 +2074,7 @@ bool DnDFile::OnDropFiles(wxCoord x, wxCoord y, const wxArrayString& filenames)
       return false;
     }
 
-    if (paste_to_keyboard)
+    if (paste_to_keyboard || keyinject_busy())
     {
       wxString msg = wxfilename;
       msg << " cannot be pasted as another paste operation is in progress";
@@ -2115,6 +2187,11 @@ void LisaEmFrame::OnEmulationTimer(wxTimerEvent& event)
       clx = cpu68k_clocks;
 
       long ticks = (now - last_decisecond); // update COPS 1/10th second clock.
+      if (turbo_mode()) // comes from 68K cycles instead, see check_current_timer_irq
+      {
+        ticks = 0;
+        last_decisecond = now;
+      }
       while (ticks > 100)
       {
         ticks -= 100;
@@ -2122,7 +2199,7 @@ void LisaEmFrame::OnEmulationTimer(wxTimerEvent& event)
         last_decisecond = now;
       }
 
-      seek_mouse_event();
+      host_seek_mouse_event();
 
       if (EmulateLoop(now)) // 68K execution
       {
@@ -2131,7 +2208,7 @@ void LisaEmFrame::OnEmulationTimer(wxTimerEvent& event)
         barrier = 0;
         return;
       }
-      seek_mouse_event();
+      host_seek_mouse_event();
       elapsed = runtime.Time(); // get time after exist of execution loop
 
       if ((elapsed - last_runtime_sample) > 1000 && running) // update status bar every 1000ms, and check print jobs too
@@ -2145,20 +2222,13 @@ void LisaEmFrame::OnEmulationTimer(wxTimerEvent& event)
         }
       }
 
-      if (paste_to_keyboard && idx_paste_to_kb > -1 && (copsqueuelen >= 0 && copsqueuelen < MAXCOPSQUEUE - 8))
+      // the whole paste is queued at once, keyinject.c types it as fast as the Lisa reads it
+      if (paste_to_keyboard && idx_paste_to_kb > -1)
       {
-        if (paste_to_keyboard[idx_paste_to_kb])
-        {
-          ALERT_LOG(0, "Pasting to keyboard: %02x", paste_to_keyboard[idx_paste_to_kb]);
-          keystroke_cops(paste_to_keyboard[idx_paste_to_kb++]);
-        }
-        else
-        {
-          idx_paste_to_kb = -1;
-          free(paste_to_keyboard);
-          paste_to_keyboard = NULL;
-          ALERT_LOG(0, "//////// End of paste to keyboard ////////");
-        }
+        ALERT_LOG(0, "Pasting %d characters to keyboard", type_text(paste_to_keyboard + idx_paste_to_kb));
+        idx_paste_to_kb = -1;
+        free(paste_to_keyboard);
+        paste_to_keyboard = NULL;
       }
     }
     else // else for   if  (running==emulation_running) we are not running, or we are paused, so yield and sleep a bit
@@ -2176,7 +2246,7 @@ void LisaEmFrame::OnPasteToKeyboard(wxCommandEvent& WXUNUSED(event))
 {
     wxTextDataObject data;
 
-    if (paste_to_keyboard)
+    if (paste_to_keyboard || keyinject_busy())
     {
       wxString msg = "Cannot paste as another paste operation is in progress";
       messagebox(CSTR(msg), "Already pasting");
@@ -3207,7 +3277,28 @@ void LisaEmFrame::SetStatusBarText(wxString &msg) {
     SetStatusText(msg, 0);}
 
 DECLARE_APP(LisaEmApp)           // Implements LisaEmApp& GetApp()
+#ifdef __WXMSW__
 IMPLEMENT_APP(LisaEmApp)         // Give wxWidgets the means to create a LisaEmApp object //valgrind reports:: Conditional jump or move depends on uninitialised value(s)
+#else
+IMPLEMENT_APP_NO_MAIN(LisaEmApp)
+
+extern "C" int iw_spoold_run(const char *arg);
+
+// The printer spooler daemon runs without a GUI, so it's picked off before wx wants a display.
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+      if ((!strcmp(argv[i], "-P") || !strcmp(argv[i], "--spoold")) && i + 1 < argc)
+        return iw_spoold_run(argv[i + 1]);
+      if (!strncmp(argv[i], "--spoold=", 9))
+        return iw_spoold_run(argv[i] + 9);
+    }
+
+    wxDISABLE_DEBUG_SUPPORT();
+    return wxEntry(argc, argv);
+}
+#endif
 
 
 void LisaEmApp::LisaSkinConfig(void)
@@ -3562,8 +3653,60 @@ bool LisaEmApp::OnCmdLineParsed(wxCmdLineParser& parser)
     parser.Found(wxT("c"), &on_start_lisaconfig);
     parser.Found(wxT("z"), &on_start_zoom);
 
+    // input record/replay starts at the next power on
+    if (parser.Found(wxT("r"), &on_start_record) && inputlog_record((char *)(const char *)CSTR(on_start_record)))
+    {
+      fprintf(stderr, "Could not create input log %s\n", (const char *)CSTR(on_start_record));
+      return false;
+    }
+    if (parser.Found(wxT("R"), &on_start_replay) && inputlog_replay((char *)(const char *)CSTR(on_start_replay)))
+    {
+      fprintf(stderr, "Could not open input log %s\n", (const char *)CSTR(on_start_replay));
+      return false;
+    }
+    if (parser.Found(wxT("m"), &on_start_shm) && shmvideo_open((char *)(const char *)CSTR(on_start_shm)))
+    {
+      fprintf(stderr, "Could not export video to shared memory %s\n", (const char *)CSTR(on_start_shm));
+      return false;
+    }
+    if (parser.Found(wxT("v"), &on_start_screenrec) && screenrec_start((char *)(const char *)CSTR(on_start_screenrec)))
+    {
+      fprintf(stderr, "Could not create screen recording %s\n", (const char *)CSTR(on_start_screenrec));
+      return false;
+    }
+
+    // serial multiplexer endpoints override the port's configured device for this session only
+    parser.Found(wxT("a"), &on_start_muxa);
+    parser.Found(wxT("b"), &on_start_muxb);
+
+    if (parser.Found(wxT("S"), &on_start_spool) && iw_spool_set_dir((const char *)CSTR(on_start_spool)))
+    {
+      fprintf(stderr, "Could not spool print jobs to %s\n", (const char *)CSTR(on_start_spool));
+      return false;
+    }
+
+    if (parser.Found(wxT("l"), &on_start_floppylib) && floppylib_set_dir((const char *)CSTR(on_start_floppylib)))
+    {
+      fprintf(stderr, "Could not use %s as a floppy library\n", (const char *)CSTR(on_start_floppylib));
+      return false;
+    }
+    if (parser.Found(wxT("D"), &on_start_disks) && floppylib_set_disks((const char *)CSTR(on_start_disks)) < 0)
+    {
+      fprintf(stderr, "Could not read all of the disks in %s\n", (const char *)CSTR(on_start_disks));
+      return false;
+    }
+
+    parser.Found(wxT("y"), &on_start_type);
+    on_start_absmouse = parser.Found(wxT("A"));
+
     on_start_center = parser.FoundSwitch(wxT("o"));
 
+    if (parser.FoundSwitch(wxT("t")) == wxCMD_LINE_SWITCH_ON)
+      set_turbo_mode(1);
+
+    if (parser.Found(wxT("x")))
+      set_floppy_fast(1);
+
     kioskmode = parser.FoundSwitch(wxT("k"));
     if (kioskmode)
     {
@@ -6733,6 +6876,14 @@ void handle_powerbutton(void)
       ret = initialize_all_subsystems();
       if (!ret)
       {
+        inputlog_poweron(); // before the power switch event below so it lands in the input log
+        keyinject_cancel();
+        set_mouse_absolute(on_start_absmouse); // globals were reset at the last power off
+        if (on_start_type != "") // first power on only
+        {
+          keyinject_script((char *)(const char *)CSTR(on_start_type));
+          on_start_type = "";
+        }
         my_lisawin->powerstate |= POWER_NEEDS_REDRAW | POWER_ON;
         my_lisaframe->running = emulation_running;
         my_lisaframe->runtime.Start(0);
@@ -6771,6 +6922,8 @@ void quit_lisaem(void) {
 extern "C" void lisa_powered_off(void)
 {
     my_lisaframe->running = emulation_off; // no longer running
+    inputlog_stop();
+    keyinject_cancel();
     if ((my_lisawin->floppystate & FLOPPY_ANIM_MASK) != FLOPPY_EMPTY)
     {
       eject_floppy_animation();
@@ -7280,7 +7433,7 @@ void LisaWin::OnMouseMove(wxMouseEvent &event)
           b = 1;
         add_mouse_event(x, y, b);
       }
-      seek_mouse_event();
+      host_seek_mouse_event();
 
       // double click hack  - fixme BUG BUG BUG - fixme - well timing bug, will not be fixed if 32Mhz is allowed
       if (lu)
@@ -7489,6 +7642,9 @@ void LisaEmFrame::OnQuit(wxCommandEvent& WXUNUSED(event))
 //#endif
 {
     save_global_prefs();
+    screenrec_stop();
+    shmvideo_close();
+    floppy_flush(); // finish writing back any ejected floppies
 
     EXTERMINATE(my_lisabitmap);
     EXTERMINATE(my_memDC);
@@ -7732,7 +7888,7 @@ void LisaEmFrame::OnKEY_OPT_7(wxCommandEvent& WXUNUSED(event))           {
 
 void LisaEmFrame::OnKey_wd02501unix(wxCommandEvent& WXUNUSED(event))     {
     static char *wd02501unix = "w(0,2501)unix\n";
-    if (paste_to_keyboard)
+    if (paste_to_keyboard || keyinject_busy())
       return; // paste operation in progress.
 
     int len = strlen(wd02501unix);
@@ -7847,6 +8003,13 @@ Throttle_MENU(512);
 Throttle_MENU(1);
 #endif
 
+// EmulateLoop picks up the change, so turbo can be flipped from C code too.
+void LisaEmFrame::OnTurbo(wxCommandEvent& WXUNUSED(event))
+{
+    set_turbo_mode(!turbo_mode());
+    ALERT_LOG(0, "Turbo mode %s", turbo_mode() ? "on" : "off");
+}
+
 extern "C" void messagebox(char *s, char *t)  // messagebox string of text, title
 {
     ALERT_LOG(0, "%s:%s", t, s); // this works, but the conversion below does not.
@@ -8019,6 +8182,7 @@ void update_menu_checkmarks(void)
       throttleMenu->Check(ID_THROTTLE128, my_lisaframe->throttle == 128.0);
       throttleMenu->Check(ID_THROTTLE256, my_lisaframe->throttle == 256.0);
       throttleMenu->Check(ID_THROTTLE512, my_lisaframe->throttle == 512.0);
+      throttleMenu->Check(ID_TURBO, turbo_mode());
 
       throttleMenu->Check(ID_ET100_75, emulation_time == 100 && emulation_tick == 75);
       throttleMenu->Check(ID_ET50_30, emulation_time == 50 && emulation_tick == 30);
@@ -8274,6 +8438,13 @@ extern "C" void eject_floppy_animation(void)
     return;
 }
 
+// for inserts that don't come through insert_floppy_anim, i.e. {disk N} in a script
+extern "C" void insert_floppy_animation(void)
+{
+    if ((my_lisawin->floppystate & FLOPPY_ANIM_MASK) == FLOPPY_EMPTY) // initiate insert animation sequence
+      my_lisawin->floppystate = FLOPPY_NEEDS_REDRAW | FLOPPY_ANIMATING | FLOPPY_INSERT_0;
+}
+
 // (TODO) JD - Drive sound emulation might be on the chopping block.
 extern "C" void floppy_motor_sounds(int track)
 {
@@ -8942,6 +9113,8 @@ LisaEmFrame::LisaEmFrame(const wxString& title)
     throttleMenu->AppendRadioItem(ID_THROTTLE128, wxT("128 MHz"), wxT("128Mhz - For modern machines"));
     throttleMenu->AppendRadioItem(ID_THROTTLE256, wxT("256 MHz"), wxT("256MHz - For modern machines"));
     throttleMenu->AppendRadioItem(ID_THROTTLE512, wxT("512 Mhz"), wxT("Ludicrous Speed!"));
+    throttleMenu->AppendSeparator();
+    throttleMenu->AppendCheckItem(ID_TURBO, wxT("Turbo\tF12"), wxT("Run as fast as the host allows, only redraw the screen a few times a second"));
 
     throttleMenu->AppendSeparator();
     throttleMenu->AppendRadioItem(ID_ET100_75, wxT("Higher 68000 Performance"), wxT("Normal 100/75ms duty timer - faster emulated CPU, less smooth animations"));
@@ -9651,6 +9824,23 @@ extern "C" void connect_device_to_serial(int port, FILE **scc_port_F, uint8 *ser
       return;
     }
 
+    if (setting->IsSameAs(_T("Mux"), false))
+    {
+      // param is a ;-separated list of endpoints, see lisa/io_board/z8530-mux.c
+      *scc_port_F = NULL;
+      *serial = SCC_MUX;
+
+      ALERT_LOG(0, "Attaching serial multiplexer %s on serial port %d", cstr_param, port);
+      if (init_mux_serial_port(port, cstr_param))
+      {
+        wxString err = wxString();
+        err.Printf(_T("Could not set up the serial multiplexer for Serial port %c: %s"), (port == 0 ? 'B' : 'A'), cstr_param);
+        wxMessageBox(err, _T("Serial port configuration"), wxICON_INFORMATION | wxOK);
+        *serial = SCC_NOTHING;
+      }
+      return;
+    }
+
     if (setting->IsSameAs(_T("Shell"), false))
     {
       // What is this? See comments in file lisa/io_board/z8530-shell.c
@@ -9798,13 +9988,20 @@ int romlessboot_pick(void) //returns 0=profile, 1=floppy
 // this just passes the settings to the ports.
 extern "C" void connect_serial_devices(void)
 {
+    wxString mux = _T("Mux");
+
     connect_device_to_serial(0, &scc_b_port_F, &serial_b,
-                             &my_lisaconfig->serial2_setting, &my_lisaconfig->serial2_param, &my_lisaconfig->serial2xon,
-                             &scc_b_telnet_port);
+                             on_start_muxb.IsEmpty() ? &my_lisaconfig->serial2_setting : &mux,
+                             on_start_muxb.IsEmpty() ? &my_lisaconfig->serial2_param : &on_start_muxb,
+                             &my_lisaconfig->serial2xon, &scc_b_telnet_port);
 
     connect_device_to_serial(1, &scc_a_port_F, &serial_a,
-                             &my_lisaconfig->serial1_setting, &my_lisaconfig->serial1_param, &my_lisaconfig->serial1xon,
-                             &scc_a_telnet_port);
+                             on_start_muxa.IsEmpty() ? &my_lisaconfig->serial1_setting : &mux,
+                             on_start_muxa.IsEmpty() ? &my_lisaconfig->serial1_param : &on_start_muxa,
+                             &my_lisaconfig->serial1xon, &scc_a_telnet_port);
+
+    scc_rx_mode[0] = (int)my_lisaconfig->serial2rxmode;
+    scc_rx_mode[1] = (int)my_lisaconfig->serial1rxmode;
 
     // ::TODO:: add code for QPC once we write it.
 }
@@ -9957,9 +10154,11 @@ int initialize_all_subsystems(void)
     lastvideolatchaddress = videolatchaddress;
 
     if (lisaram)
-      free(lisaram); // remove old junk if it exists
+      shmvideo_free_ram(lisaram); // remove old junk if it exists
 
-    lisaram = (uint8 *)malloc((macworks4mb ? 8 : 2) * 1024 * 1024 + 1024); // always allocate 4MB or 2MB, plus a small buffer.
+    // always reserve the architectural limit, plus a small buffer. In shared memory if --shm was given.
+    // Only the pages the Lisa actually touches get committed.
+    lisaram = shmvideo_alloc_ram(LISA_RAM_RESERVE);
     if (!lisaram)
     {
       wxMessageBox(_T("Could not allocate memory for the Lisa to use."),
@@ -9967,7 +10166,8 @@ int initialize_all_subsystems(void)
       return 23;
     }
 
-    memset(lisaram, 0xff, 2 * 1024 * 1024 + 511); // maxlisaram+511);
+    // power up with ram full of 0xff, as always - the rest of the reservation is left uncommitted.
+    shmvideo_power_up_ram(lisaram, LISA_RAM_RESERVE);
 
     ALERT_LOG(0, "maxlisaram: %08x bytes", maxlisaram);
     ALERT_LOG(0, "minlisaram: %08x bytes", minlisaram);
@@ -10435,6 +10635,11 @@ extern "C" int ImageWriter_LisaEm_Init(int iwnum)
 {
     if (iwnum > 10)
       return -1;
+    if (iw_spooling()) // headless, the bytes go to the spool directory instead
+    {
+      iw_spool_attach(iwnum, my_lisaconfig->iw_dipsw_1);
+      return 0;
+    }
     if (!!imagewriter[iwnum])
       return 0; // already built, reuse it;
     imagewriter[iwnum] = new ImageWriter(my_lisaframe,
@@ -10452,6 +10657,7 @@ extern "C" int ImageWriter_LisaEm_Init(int iwnum)
 extern "C" void iw_shutdown(void)
 {
     int i;
+    iw_spool_end_jobs();
     for (i = 0; i < 10; i++)
       if (!!imagewriter[i])
       {
@@ -10461,15 +10667,20 @@ extern "C" void iw_shutdown(void)
 }
 
 extern "C" void iw_formfeed(int iw)              {
+    if (iw_spooling())                       // only used to flush at shutdown, the rasteriser feeds out the last page
+      iw_spool_end_job(iw);
     if (iw < 10 && iw > -1 && imagewriter[iw])
       imagewriter[iw]->iw_formfeed();     }
 extern "C" void ImageWriterLoop(int iw,uint8 c)  {
-    if (iw < 10 && iw > -1 && imagewriter[iw])
+    if (iw_spooling())
+      iw_spool_putc(iw, c);
+    else if (iw < 10 && iw > -1 && imagewriter[iw])
       imagewriter[iw]->ImageWriterLoop(c);}
 extern "C" void iw_enddocument(int i)
 {
     if (i < 0 || i > 10)
       return;
+    iw_spool_end_job(i);
     if (!!imagewriter[i])
     {
       imagewriter[i]->EndDocument();
@@ -10479,6 +10690,7 @@ extern "C" void iw_enddocument(int i)
 extern "C" void iw_enddocuments(void)
 {
     int i;
+    iw_spool_end_jobs();
     for (i = 2; i < 10; i++)
       if (!!imagewriter[i])
         imagewriter[i]->EndDocument();
@@ -10492,6 +10704,7 @@ extern "C" void iw_enddocuments(void)
 void iw_check_finish_job(void)
 {
     int i;
+    iw_spool_check_idle();
     for (i = 2; i < 10; i++)
       if (!!imagewriter[i])
       {
@@ -10506,6 +10719,44 @@ void iw_check_finish_job(void)
       }
 }
 
+// lisaem --spoold's worker: print one spooled job to PNG or PDF pages in outdir. No GUI here,
+// with no printer DC the ImageWriter only needs wxString and wxDateTime.
+static int iw_spool_rasterise(const char *rawfile, const char *outdir, int type, int dipsw)
+{
+    ImageWriter *iw;
+    FILE *f;
+    int c, pages;
+
+    if (!(f = fopen(rawfile, "rb")))
+      return -1;
+
+    iw = new ImageWriter(NULL, type, wxString(outdir, wxConvLocal), dipsw);
+    while ((c = getc(f)) != EOF)
+      iw->ImageWriterLoop((uint8)c);
+    fclose(f);
+
+    iw->iw_formfeed();
+    pages = (int)iw->PageCount();
+    delete iw; // waits for the last page to be written
+    return pages;
+}
+
+// the workers use wxString, wxDateTime and wxFileName, and this runs before wxEntry() would
+// have set those up
+extern "C" int iw_spoold_run(const char *arg)
+{
+    int ret;
+
+    if (!wxInitialize())
+    {
+      fprintf(stderr, "lisaem-spoold: couldn't initialize wxWidgets\n");
+      return 1;
+    }
+    ret = iw_spoold_main(arg, iw_spool_rasterise);
+    wxUninitialize();
+    return ret;
+}
+
 
 
 void uninit_gui(void);
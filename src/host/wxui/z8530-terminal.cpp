@@ -216,7 +216,7 @@ TerminalWxFrame *TerminalFrame[MAXTERMS];
 
 #define XREADPORT() ((portnum == 3) ? read_serial_port_tty(portnum) : fliflo_buff_get(&SCC_READ[portnum]))
 #define XWRITEPORT(data) ((portnum == 3) ? write_serial_port_tty(portnum, data) : fliflo_buff_add(&SCC_WRITE[portnum], data))
-// &SCC_READ[portnum]  - is used to write to the SCC from TerminalWx
+// scc_line_add(portnum) - is used to write to the SCC from TerminalWx
 // &SCC_WRITE[portnum] - is used to read from the SCC and write to the TerminalWx display
 
 uint8 xreadport(int port)
@@ -233,7 +233,7 @@ void xwriteport(uint8 data, int port)
         write_serial_port_tty(port, data);
         return;
     } // does an actual write to tty from perspective of Z8530
-    fliflo_buff_add(&SCC_READ[port], data);
+    scc_line_add(port, data);
 }
 
 extern "C" void write_serial_port_terminal(int portnum, uint8 data);
@@ -405,6 +405,8 @@ TerminalWx::TerminalWx(wxWindow *parent, wxWindowID id, int port,
 
 extern "C" void init_terminal_serial_port(int port);
 extern "C" void rx_char_available(int port);
+extern "C" int scc_line_is_full(int port);
+extern "C" void scc_line_add(int port, uint8 data);
 extern "C" void lpw_console_output(char *text);
 
 static char lpw_console_str[88 * 34];
@@ -455,12 +457,11 @@ void TerminalWx::SendBack(int len, char *data)
             {
                 keystroke_cops(data[i]);
             }
-            else if (!fliflo_buff_is_full(&SCC_READ[this->portnum]))
+            else if (!scc_line_is_full(this->portnum))
             {
                 // send bytes from TerminalWx to the z8530 so the Lisa can read it. If i'ts the terminal console
                 // push to the my_lisawin keyboard events
-                fliflo_buff_add(&SCC_READ[this->portnum], data[i]);
-                rx_char_available(this->portnum);
+                scc_line_add(this->portnum, data[i]);
 #ifdef DEBUG
                 fprintf(stderr, "SendBack: added i=%d character:%c (%d %02x) to fliflo for port:%d\n\n", i, data[i], data[i], data[i], this->portnum);
 #endif
@@ -478,11 +479,10 @@ void TerminalWx::SendBack(char *data)
             {
                 keystroke_cops(data[i]);
             }
-            else if (!fliflo_buff_is_full(&SCC_READ[this->portnum]))
+            else if (!scc_line_is_full(this->portnum))
             {
                 fprintf(stderr, "\nSendBack: char\n");
-                fliflo_buff_add(&SCC_READ[this->portnum], data[i]);
-                rx_char_available(this->portnum);
+                scc_line_add(this->portnum, data[i]);
 #ifdef DEBUG
                 fprintf(stderr, "SendBack: added i=%d character:%c (%d %02x) to fliflo for port:%d\n\n", i, data[i], data[i], data[i], this->portnum);
 #endif
@@ -578,13 +578,12 @@ void TerminalWxFrame::OnPaste(wxCommandEvent &WXUNUSED(event))
                     {
                         keystroke_cops((uint8)uni_ch);
                     }
-                    else if (!fliflo_buff_is_full(&SCC_READ[this->portnum]))
+                    else if (!scc_line_is_full(this->portnum))
                     {
-                        fliflo_buff_add(&SCC_READ[this->portnum], (uint8)uni_ch);
+                        scc_line_add(this->portnum, (uint8)uni_ch);
                     }
                 }
             }
-            rx_char_available(this->portnum);
         }
         else
         {
@@ -839,10 +838,10 @@ void TerminalWxFrame::OnTimer(wxTimerEvent &WXUNUSED(event))
 
     case 1: // ascii upload
         // send chars until fliflo is full, or we the file ends
-        while (!feof(upload) && !fliflo_buff_is_full(&SCC_READ[this->portnum]))
+        while (!feof(upload) && !scc_line_is_full(this->portnum))
         {
             uint8 c = fgetc(upload);
-            fliflo_buff_add(&SCC_READ[this->portnum], c);
+            scc_line_add(this->portnum, c);
         }
 
         // did we finish? if so, close the file handle and stop the timer
@@ -0,0 +1,66 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*                   Screen recording file format (screenrec.c).                        *
+*          Shared with the lisa-screenrec-to-gif converter, so it only uses            *
+*          fixed size C99 types and doesn't need vars.h/machine.h.                     *
+\**************************************************************************************/
+
+#ifndef GOT_SCREENREC_H
+#define GOT_SCREENREC_H 1
+
+#include <stdint.h>
+
+/*
+ * File:    "LISAREC1" then records until EOF.
+ *
+ * Record:  a 24 byte header, all fields big endian, followed by clen bytes of data.
+ *
+ *   0  type        'K' keyframe: lines hold the pixels
+ *                  'D' delta: lines hold the XOR of the pixels against the previous frame
+ *   1  flags       SCREENREC_RAW if the data is stored as is rather than as an LZ4 block
+ *   2  width       in pixels
+ *   4  height      lines
+ *   6  xbytes      bytes per line
+ *   8  first       first line in this record
+ *  10  nlines      number of lines in this record, lines outside it are unchanged
+ *  12  clocks      64 bit 68K clock (5MHz) count since the start of the recording
+ *  20  clen        length of the data that follows
+ *
+ * Frames are only written when something changed, so a frame lasts until the next record's
+ * clocks.  Pixels are 1bpp, msb leftmost, 1 is black, like Lisa video ram.
+ */
+
+#define SCREENREC_MAGIC "LISAREC1"
+#define SCREENREC_HEADER_SIZE 24
+#define SCREENREC_KEYFRAME 'K'
+#define SCREENREC_DELTA 'D'
+#define SCREENREC_RAW 1
+
+#define SCREENREC_CLOCKS_PER_SEC 5000000
+#define SCREENREC_MAX_FRAME 32768 // 90x364 and 76x431 both fit in a 32K video page
+#define SCREENREC_LZ4_BOUND(n) ((n) + ((n) / 255) + 16)
+
+#endif
@@ -0,0 +1,76 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*              Layout of the shared memory framebuffer export segment.                 *
+*          Shared between the emulator (shmvideo.c) and external viewers, so it        *
+*          only uses fixed size C99 types and doesn't need vars.h/machine.h.           *
+\**************************************************************************************/
+
+#ifndef GOT_SHMVIDEO_H
+#define GOT_SHMVIDEO_H 1
+
+#include <stdint.h>
+
+/*
+ * The segment is a header page followed by all of Lisa RAM - the emulator allocates lisaram
+ * inside the segment, so the 68K writes straight into it and nothing gets copied.  The
+ * current frame is ram[video_offset] .. ram[video_offset + xbytes*height - 1], 1bpp, msb is
+ * the leftmost pixel, 1 is black.
+ *
+ * At every vertical retrace the emulator makes seq odd, updates the header, then makes it
+ * even again.  A reader waits for an even seq that differs from the last one it saw, copies
+ * what it needs, and retries if seq changed while it was copying.  line_frame[y] is the frame
+ * number line y was last written in, so a reader only has to copy lines newer than its last
+ * frame.  Vidram isn't frozen during a frame, so a copy can tear just as a real CRT would.
+ */
+
+#define SHMVIDEO_MAGIC 0x4c697361 // "Lisa"
+#define SHMVIDEO_VERSION 1
+#define SHMVIDEO_HEADER_SIZE 4096
+#define SHMVIDEO_MAX_LINES 512
+
+#define SHMVIDEO_RUNNING 1 // Lisa is powered on, ram contents are live
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t header_size; // lisa ram starts this many bytes into the segment
+  uint32_t ram_size;
+  volatile uint32_t seq; // odd while the header is being updated
+  volatile uint32_t flags;
+  volatile uint32_t frame; // count of vertical retraces since the segment was created
+  volatile uint32_t video_offset;
+  volatile uint32_t width; // in pixels
+  volatile uint32_t height;
+  volatile uint32_t xbytes; // bytes per line
+  uint32_t pid;
+  volatile uint64_t clocks; // cpu68k_clocks at the last retrace
+  volatile uint32_t line_frame[SHMVIDEO_MAX_LINES];
+} shmvideo_header;
+
+#define SHMVIDEO_RAM(hdr) (((uint8_t *)(hdr)) + (hdr)->header_size)
+
+#endif
@@ -950,6 +950,12 @@ GLOBAL(int, mouse_y_tolerance, 0);
 GLOBAL(int, mouse_x_halfing_tolerance, 1);
 GLOBAL(int, mouse_y_halfing_tolerance, 1);
 
+// absolute pointer mode: the path to each host position is worked out once and queued as
+// COPS mouse packets instead of being polled for.  mouse_abs_step is the largest delta the
+// running OS moves 1:1 by, the ones that accelerate get small steps.
+GLOBAL(uint8, mouse_absolute, 0);
+GLOBAL(int, mouse_abs_step, 127);
+
 // can turn these into a pointer and several arrays for various OS's.
 GLOBAL(int, anti_jitter_sample_dec1[], {64, 32, 16, 8, 4, 2, 0, 0, 0});
 GLOBAL(int, anti_jitter_sample_dec2[], {1, 2, 4, 16, 32, 64, 0, 0, 0});
@@ -1064,6 +1070,8 @@ typedef struct _mmu_trans_t
   lisa_mem_t readfn;  /* index to read and write fn's for that segment, that way I            */
   lisa_mem_t writefn; /* can have read only segments without doing special checking.          */
   t_ipc_table *table; /* Pointer to a table of IPC's or NULL if one hasn't been assigned.     */
+  lisa_mem_t stalefn; /* readfn the page had before it went stale_page, see mmu.c            */
+  uint8 *hostptr;     /* host address of the page if it's plain RAM or ROM, else NULL.       */
 } mmu_trans_t;
 
 // Lisa's MMU table.  This get's converted to mmu_trans table above on a per/page basis.
@@ -1082,8 +1090,11 @@ GLOBAL(uint8, floppy_irq_top, 1);
 GLOBAL(uint8, floppy_irq_bottom, 1); // interrupt settings (are floppies allowd to interrupt)
 DECLARE(uint8, floppy_ram[2048]);
 
+// MMU segments whose SOR/SLR were written since the last mmuflush(), a bit per segment per context.
+// mmudirty_all[] counts the set bits, mmudirty is the count for the context last looked at.
 GLOBAL(uint32, mmudirty, 0);
 DECLARE(uint32, mmudirty_all[5]);
+DECLARE(uint32, mmudirty_segs[5][4]);
 
 DECLARE(uint8, lisarom[0x4000]);       // space for the MC68000 ROM
 DECLARE(uint8, dualparallelrom[2048]); // rom space for the dual parallel card
@@ -1124,6 +1135,24 @@ GLOBAL(int, dirty_x_max, 0);
 GLOBAL(int, dirty_y_min, 364);
 GLOBAL(int, dirty_y_max, 0);
 
+// per scanline dirty flags, set by the vidram write handlers from the physical address, so they're
+// right no matter how the video page is mapped.  The writers set all the bits, each consumer tests
+// and clears only its own.
+#define SCREEN_MAX_LINES 512
+#define SCREEN_DIRTY_HASH 1 // screenhash.c
+#define SCREEN_DIRTY_SHM 2  // shmvideo.c
+#define SCREEN_DIRTY_REC 4  // screenrec.c
+DECLARE(uint8, screen_line_dirty[SCREEN_MAX_LINES]);
+#define SCREEN_LINE_DIRTY(pa, bytesperline, len)                            \
+  {                                                                         \
+    uint32 sloff = (uint32)((pa) - videolatchaddress);                      \
+    if (sloff < 32768)                                                      \
+    {                                                                       \
+      screen_line_dirty[sloff / (bytesperline)] = 0xff;                     \
+      screen_line_dirty[(sloff + (len) - 1) / (bytesperline)] = 0xff;       \
+    }                                                                       \
+  }
+
 GLOBAL(int, e_dirty_x_min, 720);
 GLOBAL(int, e_dirty_x_max, 0);
 GLOBAL(int, e_dirty_y_min, 500);
@@ -1302,7 +1331,11 @@ GLOBAL(XTIMER, clktest, 0);
 GLOBAL(XTIMER, cops_event, -1);
 GLOBAL(XTIMER, tenth_sec_cycles, TENTH_OF_A_SECOND); // 10th of a second cycles.  5,000,000 cycles/sec so 500000 10ths/sec
 GLOBAL(XTIMER, z8530_event, -1);
+GLOBAL(XTIMER, z8530_rxb_event, -1); // next character due into the port B receive FIFO, in SCC_RX_BAUD mode
+GLOBAL(XTIMER, z8530_rxa_event, -1); // same for port A
 GLOBAL(XTIMER, cops_mouse, (COPS_IRQ_TIMER_FACTOR * 4));
+GLOBAL(XTIMER, keyinject_due, -1);     // when the next scripted key event may go out, see keyinject.c
+GLOBAL(uint8, keyinject_draining, 0);  // a scripted key code is in the COPS queue, waiting to be read
 
 DECLARE(int, irqs[7]); // flagged IRQs to fire
 
@@ -1316,6 +1349,8 @@ DECLARE(int, irqs[7]); // flagged IRQs to fire
     cops_event = (cops_mouse ? (cpu68k_clocks + cops_mouse) : -1);                             \
     if (copsqueuelen > 0 && ((cops_event > (cpu68k_clocks + KBCOPSCYCLES)) || cops_event < 0)) \
       cops_event = cpu68k_clocks + KBCOPSCYCLES;                                               \
+    if (keyinject_due > -1 && (cops_event > keyinject_due || cops_event < 0))                  \
+      cops_event = MAX(keyinject_due, cpu68k_clocks + 1);                                      \
     DEBUG_LOG(0, "SET_COPS_NEXT:copsqueuelen:%d cops_mouse:%ld cops_event:%016llx    \n",      \
               copsqueuelen, cops_mouse, cops_event);                                           \
   }
@@ -1436,6 +1471,152 @@ EXTERNX uint8 fliflo_buff_peek_end(FLIFLO_QUEUE_t *b);
 EXTERNX int fliflo_buff_create(FLIFLO_QUEUE_t *b, uint32 size);
 EXTERNX void fliflo_buff_destroy(FLIFLO_QUEUE_t *b);
 
+// host input record/replay - inputlog.c
+#define INPUTLOG_OFF 0
+#define INPUTLOG_RECORD 1
+#define INPUTLOG_REPLAY 2
+
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_INPUTLOG_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX int inputlog_record(char *filename);
+EXTERNX int inputlog_replay(char *filename);
+EXTERNX void inputlog_poweron(void);
+EXTERNX void inputlog_stop(void);
+EXTERNX int inputlog_active(void);
+EXTERNX int inputlog_replaying(void);
+EXTERNX XTIMER inputlog_next_event(void);
+EXTERNX int inputlog_event(char type, int32 a, int32 b, int32 c, char *s);
+EXTERNX void inputlog_replay_due(void);
+
+// screen hashes and waits for automation - screenhash.c
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_SCREENHASH_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX void screen_hash_update(void);
+EXTERNX uint32 screen_line_hash(int y);
+EXTERNX uint32 screen_region_hash(int x, int y, int w, int h);
+EXTERNX uint32 screen_hash(void);
+EXTERNX uint64 screen_region_phash(int x, int y, int w, int h);
+EXTERNX int screen_phash_distance(uint64 a, uint64 b);
+EXTERNX int screen_match_template(int x, int y, int tw, int th, uint8 *bits, int stride);
+EXTERNX int screen_find_template(int rx, int ry, int rw, int rh, int tw, int th, uint8 *bits, int stride, int maxdiff,
+                                 int *foundx, int *foundy);
+EXTERNX uint8 *screen_load_template(const char *file, int *tw, int *th, int *stride);
+
+// scripted keyboard input - keyinject.c
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_KEYINJECT_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX int type_text(char *text);
+EXTERNX int press_combo(char *combo);
+EXTERNX int keyinject_script(char *script);
+EXTERNX void keyinject_pause(XTIMER cycles);
+EXTERNX void keyinject_set_pacing(XTIMER key_gap, XTIMER line_gap);
+EXTERNX int keyinject_busy(void);
+EXTERNX void keyinject_cancel(void);
+EXTERNX void keyinject_tick(void);
+EXTERNX void keyinject_drained(void);
+
+// floppy library and disk sets - floppylib.c
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_FLOPPYLIB_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX int floppylib_set_dir(const char *dir);
+EXTERNX int floppylib_canonical(const char *image, char *dc42, int len);
+EXTERNX int floppylib_set_disks(const char *list);
+EXTERNX int floppylib_disks(void);
+EXTERNX int floppylib_drive_empty(void);
+EXTERNX int floppylib_insert_disk(int n);
+
+// shared memory framebuffer export - shmvideo.c
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_SHMVIDEO_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX int shmvideo_open(char *name);
+EXTERNX int shmvideo_active(void);
+EXTERNX uint8 *shmvideo_alloc_ram(uint32 size);
+EXTERNX void shmvideo_free_ram(uint8 *mem);
+EXTERNX void shmvideo_power_up_ram(uint8 *mem, uint32 size);
+EXTERNX void shmvideo_close(void);
+EXTERNX void shmvideo_retrace(void);
+
+// 1bpp screen recorder - screenrec.c
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_SCREENREC_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX int screenrec_start(char *filename);
+EXTERNX void screenrec_stop(void);
+EXTERNX int screenrec_active(void);
+EXTERNX void screenrec_retrace(void);
+
+// serial port host I/O thread - z8530-iothread.c
+#define SCC_IO_NONE 0
+#define SCC_IO_STREAM 1  // pty, shell, tty: read and write the same descriptor
+#define SCC_IO_TELNETD 2 // listening socket, accepts one client and strips telnet commands
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_Z8530_IOTHREAD_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX int scc_io_attach(int port, int fd, int kind);
+EXTERNX void scc_io_detach(int port);
+EXTERNX int scc_io_attached(int port);
+EXTERNX int scc_io_connected(int port);
+EXTERNX int scc_io_getc(int port);
+EXTERNX int scc_io_rx_pending(int port);
+EXTERNX void scc_io_kick(void);
+EXTERNX int scc_io_tx_full(int port);
+EXTERNX int scc_io_putc(int port, uint8 data);
+
+// serial port multiplexer - z8530-mux.c
+#ifdef EXTERNX
+#undef EXTERNX
+#endif
+#ifndef IN_Z8530_MUX_C
+#define EXTERNX extern
+#else
+#define EXTERNX ;
+#endif
+EXTERNX int init_mux_serial_port(int port, char *spec);
+EXTERNX void close_mux_serial_port(int port);
+EXTERNX int scc_mux_getc(int port);
+EXTERNX int scc_mux_rx_pending(int port);
+EXTERNX XTIMER scc_mux_replay_due(int port);
+
 // extern void alertlog(char *alert);
 
 // #endif
@@ -1613,10 +1794,11 @@ extern void on_lisa_exit(void);
 #define CXSASEL ((1 + ((segment1 | segment2) & (lastsflag ? 0 : 3))) & (start ? 0 : 7))
 
 // mmu cache coherency
-#define SET_MMU_DIRTY(x)             \
-  {                                  \
-    mmudirty = (x);                  \
-    mmudirty_all[CXASEL] = mmudirty; \
+#define MMU_SEG_DIRTY(cx, seg) (mmudirty_segs[(cx)][(seg) >> 5] & (1 << ((seg) & 31)))
+#define SET_MMU_DIRTY(seg)                 \
+  {                                        \
+    mark_mmu_segment_dirty(CXASEL, (seg)); \
+    mmudirty = mmudirty_all[CXASEL];       \
   }
 #define GET_MMU_DIRTY(x)             \
   {                                  \
@@ -1632,11 +1814,15 @@ extern void on_lisa_exit(void);
   {                                                            \
     if (context && (mmu[((addr) & 0x00fe0000) >> 17].changed)) \
     {                                                          \
-      SET_MMU_DIRTY(0xdec0de);                                 \
+      SET_MMU_DIRTY(((addr) & 0x00fe0000) >> 17);              \
       mmuflush(0);                                             \
     }                                                          \
   }
 
+// mmu_trans entries are rebuilt lazily (see mmu.c), use this instead of &mmu_trans[page] when
+// looking at an entry directly rather than through its readfn/writefn.
+#define GET_MMU_TRANS(page) ((mmu_trans[(page)].readfn == stale_page) ? rebuild_mmu_page(context, (page)) : &mmu_trans[(page)])
+
 // filter out segment # - i.e. keep page+offset
 #define MMUXXFILT 0x0001ffff
 
@@ -1655,6 +1841,12 @@ extern void on_lisa_exit(void);
 // #define TWOMEGMLIM 0x001fffff
 GLOBAL(uint32, TWOMEGMLIM, 0x001fffff);
 
+// lisaram is always reserved at the most the MacWorks 4MB hack can map, the host only commits the pages
+// that get written.  This is only the allocation, the MMU is still limited to TWOMEGMLIM.
+#define LISA_RAM_RESERVE (8 * 1024 * 1024 + 1024)
+// the Lisa's RAM powers up as this many bytes of 0xff, zeros after that
+#define LISA_RAM_POWERUP_FF (2 * 1024 * 1024 + 511)
+
 // memory function definitions.
 #ifndef IN_REG68K_C
 #define EXTERN extern
@@ -1736,6 +1928,7 @@ extern void reg68k_sanity_check_bitorder(void);
 
 extern char *mspace(lisa_mem_t fn);
 extern int floppy_insert(char *Image, uint8 insert_in_upper_floppy_drive);
+extern int floppy_insert_readonly(char *Image, uint8 insert_in_upper_floppy_drive);
 extern void floppy_eject_button_pressed(uint8 on_upper_floppy_drive) ;
 extern void apple_1(void);
 extern void apple_2(void);
@@ -1743,6 +1936,7 @@ extern void apple_3(void);
 extern void apple_dot(void);
 extern void apple_dot_down(void);
 extern void apple_dot_up(void);
+extern void apple_combo_key(uint8 key, uint8 shift, uint8 cmdkey, uint8 option, char *s);
 extern void send_nmi_key(void);
 extern void presspowerswitch(void);
 
@@ -1811,6 +2005,12 @@ EXTERNX uint32 lrol(uint32 outdata, uint8 loop);
 #endif
 EXTERNX void init_lisa_mmu(void);
 EXTERNX void checkcontext(uint8 c, char *text);
+EXTERNX mmu_trans_t *rebuild_mmu_page(int cx, uint32 epage);
+EXTERNX void reset_lazy_mmu(void);
+EXTERNX void refresh_mmu_hostptrs(void);
+EXTERNX void refresh_mmu_page_hostptr(uint32 epage);
+EXTERNX void mark_mmu_segment_dirty(int cx, int segment);
+EXTERNX void mark_mmu_changed_dirty(int cx);
 
 #ifdef EXTERNX
 #undef EXTERNX
@@ -1851,6 +2051,8 @@ EXTERNX void VIAProfileLoop(int vianum, ProFileType *P, int event);
 extern int8 IRQRingBufferAdd(uint8 irql, uint32 address);
 extern uint8 IRQRingGet(void);
 extern void init_IRQ(void);
+extern void set_turbo_mode(int on);
+extern int turbo_mode(void);
 #endif
 
 #ifndef IN_COPS_C
@@ -1861,6 +2063,11 @@ extern void init_cops(void);
 
 #ifndef IN_FLOPPY_C
 extern void floppy_go6504(void);
+extern void set_floppy_fast(int on);
+extern int floppy_fast_mode(void);
+extern void floppy_flush(void);
+extern uint8 is_upper_floppy_currently_inserted(void);
+extern uint8 is_lower_floppy_currently_inserted(void);
 #endif
 
 #ifndef IN_PROFILE_C
@@ -1919,9 +2126,14 @@ GLOBAL(FILE, *scc_b_port_F, NULL);
 DECLARE(int, xonenabled[2]);
 DECLARE(int, baudoverride[2]);
 
+// how received characters are fed to the Lisa, per port (0=B, 1=A)
+#define SCC_RX_ONEBYTE 0   // one character at a time, port B throttled to SCC_MIN_CYCLES_BETWEEN_READS
+#define SCC_RX_BAUD 1      // paced at the baud rate the Lisa programmed, into the 3 byte receive FIFO
+#define SCC_RX_UNLIMITED 2 // the receive FIFO is topped back up as soon as the Lisa reads from it
+DECLARE(int, scc_rx_mode[2]);
+
 // Used by memory diag tests
 GLOBAL(uint8, *mem_parity_bits1, NULL);
-GLOBAL(uint8, *mem_parity_bits2, NULL);
 GLOBAL(uint32, last_bad_parity_adr, 0);
 
 GLOBAL(int, scc_running, 0);
@@ -2017,9 +2229,11 @@ GLOBAL(int32, physaddr, 0);
 
 #define OxVoid 26 /* Reserved mem fn's that do nothing, and return junk                */
 
-// 27-31 unused.
+#define stale_page 27 /* SOR/SLR changed, translation not rebuilt yet - done on first access */
+
+// 28-31 unused.
 
-#define MAX_LISA_MFN 27 /* The last Lisa Memory function type we have                        */
+#define MAX_LISA_MFN 28 /* The last Lisa Memory function type we have                        */
 
 #define DEBUG_MFN_TRACE 32 // trap/trace fn's.
 
@@ -2051,7 +2265,8 @@ GLOBAL(char, *memspaces[],
         "23-sio_mmu",
         "24-io",
         "25-Oxd400_amd9512",
-        "26-OxVoid"});
+        "26-OxVoid",
+        "27-stale_page"});
 
 ACGLOBAL(lisa_mem_t, io_map[],
          {
@@ -2221,13 +2436,68 @@ extern void dmem68k_store_long(char *file, char *function, int line, uint32 a, u
 #define storelong(a, d) dmem68k_store_long((char *)__FILE__, (char *)__FUNCTION__, __LINE__, (uint32)(a), (uint32)(d))
 #else
 
+// Plain RAM and ROM pages carry a host pointer (see mmu_hostptr() in mmu.c) so they're a single
+// inline big endian load or store.  Everything else - I/O, video ram, read only and bad pages,
+// odd addresses, longs that might cross into the next page and writes to pages that still have
+// IPC's to invalidate - goes through the memory function for the page as before.
+static inline uint8 fetchbyte_fast(uint32 a)
+{
+  mmu_trans_t *m = &mmu_trans[(a & MMUEPAGEFL) >> 9];
+  if (m->hostptr)
+    return m->hostptr[a & 0x1ff];
+  return mem68k_fetch_byte[m->readfn](a);
+}
+
+static inline uint16 fetchword_fast(uint32 a)
+{
+  mmu_trans_t *m = &mmu_trans[(a & MMUEPAGEFL) >> 9];
+  if (m->hostptr && !(a & 1))
+    return LOCENDIAN16(*(uint16 *)(m->hostptr + (a & 0x1ff)));
+  return mem68k_fetch_word[m->readfn](a);
+}
+
+static inline uint32 fetchlong_fast(uint32 a)
+{
+  mmu_trans_t *m = &mmu_trans[(a & MMUEPAGEFL) >> 9];
+  if (m->hostptr && !(a & 1) && (a & 0x1ff) <= 0x1fc)
+    return LOCENDIAN32(*(uint32 *)(m->hostptr + (a & 0x1ff)));
+  return mem68k_fetch_long[m->readfn](a);
+}
+
+static inline void storebyte_fast(uint32 a, uint8 d)
+{
+  mmu_trans_t *m = &mmu_trans[(a & MMUEPAGEFL) >> 9];
+  if (m->hostptr && m->writefn == ram && !m->table)
+    m->hostptr[a & 0x1ff] = d;
+  else
+    mem68k_store_byte[m->writefn](a, d);
+}
+
+static inline void storeword_fast(uint32 a, uint16 d)
+{
+  mmu_trans_t *m = &mmu_trans[(a & MMUEPAGEFL) >> 9];
+  if (m->hostptr && m->writefn == ram && !m->table && !(a & 1))
+    *(uint16 *)(m->hostptr + (a & 0x1ff)) = LOCENDIAN16(d);
+  else
+    mem68k_store_word[m->writefn](a, d);
+}
+
+static inline void storelong_fast(uint32 a, uint32 d)
+{
+  mmu_trans_t *m = &mmu_trans[(a & MMUEPAGEFL) >> 9];
+  if (m->hostptr && m->writefn == ram && !m->table && !(a & 1) && (a & 0x1ff) <= 0x1fc)
+    *(uint32 *)(m->hostptr + (a & 0x1ff)) = LOCENDIAN32(d);
+  else
+    mem68k_store_long[m->writefn](a, d);
+}
+
 #define fetchaddr(a) mem68k_memptr[(mmu_trans[((a) & MMUEPAGEFL) >> 9].readfn)](a)
-#define fetchbyte(a) mem68k_fetch_byte[(mmu_trans[((a) & MMUEPAGEFL) >> 9].readfn)](a)
-#define fetchword(a) mem68k_fetch_word[(mmu_trans[((a) & MMUEPAGEFL) >> 9].readfn)](a)
-#define fetchlong(a) mem68k_fetch_long[(mmu_trans[((a) & MMUEPAGEFL) >> 9].readfn)](a)
-#define storebyte(a, d) mem68k_store_byte[(mmu_trans[((a) & MMUEPAGEFL) >> 9].writefn)]((a), (uint8)(d))
-#define storeword(a, d) mem68k_store_word[(mmu_trans[((a) & MMUEPAGEFL) >> 9].writefn)]((a), (uint16)(d))
-#define storelong(a, d) mem68k_store_long[(mmu_trans[((a) & MMUEPAGEFL) >> 9].writefn)]((a), (uint32)(d))
+#define fetchbyte(a) fetchbyte_fast((uint32)(a))
+#define fetchword(a) fetchword_fast((uint32)(a))
+#define fetchlong(a) fetchlong_fast((uint32)(a))
+#define storebyte(a, d) storebyte_fast((uint32)(a), (uint8)(d))
+#define storeword(a, d) storeword_fast((uint32)(a), (uint16)(d))
+#define storelong(a, d) storelong_fast((uint32)(a), (uint32)(d))
 #endif
 
 // As these are defined in memory.c, we cannot define them here as externs.  like duh!
@@ -2496,6 +2766,7 @@ extern void lisa_wl_OxVoid(uint32 addr, uint32 data);
 
 extern void keystroke_cops(unsigned char c);
 extern void send_cops_keycode(int k);
+extern void set_mouse_absolute(int on);
 
 extern void apple_1(void);
 extern void apple_2(void);
@@ -2533,6 +2804,7 @@ extern CPP2C void messagebox(char *s, char *t);
 extern CPP2C int yesnomessagebox(char *s, char *t);
 extern CPP2C void floppy_motor_sounds(int track);
 extern CPP2C void eject_floppy_animation(void);
+extern CPP2C void insert_floppy_animation(void);
 extern CPP2C void save_pram(void);
 extern CPP2C int pickprofilesize(char *filename, int allowexisting);
 
@@ -2549,6 +2821,9 @@ void set_loram_clk(void);
 
 extern void lisa_diag2_on_mem(void);
 extern void lisa_diag2_off_mem(void);
+extern void lisa_diag2_bad_pages_mem(void);
+extern int parity_page_bad(uint32 epage);
+extern void clear_parity_bits(void);
 
 extern void lisa_buserror(uint32 addr);
 extern void mc68k_reset(void);
@@ -2588,6 +2863,7 @@ extern void flag_vert_retrace_irq(void);
 
 extern int get_nmi_pending_irq(void);
 extern int get_scc_pending_irq(void);
+extern void scc_rx_timer(unsigned int port);
 // extern int get_exs0_pending_irq(void);
 // extern int get_exs1_pending_irq(void);
 // extern int get_exs2_pending_irq(void);
@@ -45,8 +45,11 @@
 #define SCC_TTY 22      // physical serial port
 #define SCC_TERMINAL 23 // terminal window
 #define SCC_SHELL 24    // shell
+#define SCC_MUX 25      // several host endpoints sharing one port, z8530-mux.c
 
 #define SCC_BUFFER_SIZE 2
+#define SCC_RX_FIFO_SIZE 3        // receive FIFO, the Z8530 has 3 bytes of it
+#define SCC_LINE_BUFFER_SIZE 4096 // characters typed or uploaded in the terminal window, not yet received
 
 #define SERIAL_PORT_A_DATA 0xFCD247
 #define SERIAL_PORT_A_CONTROL 0xFCD243
@@ -321,12 +321,12 @@ then
 
   #          1         2         3         4         5         6         7
   #01234567890123456789012345678901234567890123456789012345678901234567890123456789
-  #  Writing C files... 0. 1. 2. 3. 4. 5. 6. 7. 8. 9. a. b. c. d. e. f. done.
+  #  Writing C files... 0. 1. 2. 3. 4. 5. 6. 7. 8. 9. a. b. c. d. e. f. g. done.
 
   export COMPILEPHASE="generating"
   export PERCENTJOB=2 NUMJOBSINPHASE=24
   echo -n "  Compiled  cpu68k-: "
-  for src in 0 1 2 3 4 5 6 7 8 9 a b c d e f; do
+  for src in 0 1 2 3 4 5 6 7 8 9 a b c d e f g; do
       #echo -n "${src}. "
       qjob    "${src}. " $CC $WITHDEBUG $WITHTRACE $INC $CFLAGS $ARCH -c cpu68k-${src}.c -o ../obj/cpu68k-${src}.o
       COMPILED="yes"
@@ -35,6 +35,10 @@ typedef enum
 /* file-scope global variables */
 
 static int total = 0;
+
+/* flags read by each condition code T, F, HI, LS, CC, CS, NE, EQ, VC, VS,
+   PL, MI, GE, LT, GT, LE - X=1 N=2 Z=4 V=8 C=16 as in the iib */
+static int cc_used[16] = {0, 0, 20, 20, 16, 16, 4, 4, 8, 8, 2, 2, 10, 10, 14, 14};
 static int clocks_movetable[];   /* pre-declaration */
 static int clocks_movetable_l[]; /* pre-declaration */
 
@@ -85,6 +89,10 @@ int main(int argc, char *argv[])
   myoutiibs = outiibs;
 
   fprintf(outiibs, "/* automatically generated by def68k.c */\n\n");
+  fprintf(outiibs, "/* conditions read only the flags they test, except in debug builds,\n");
+  fprintf(outiibs, "   which keep every flag live so traces show real flags */\n");
+  fprintf(outiibs, "#ifdef DEBUG\n#define CC_USED(cc, all) (all)\n");
+  fprintf(outiibs, "#else\n#define CC_USED(cc, all) (cc)\n#endif\n\n");
   fprintf(outiibs, "t_iib iibs[] = {\n");
   fprintf(outiibs, "  /* mask, bits, mnemonic, { priv, endblk, zero, ");
   fprintf(outiibs, "used, set },\n");
@@ -208,6 +216,7 @@ void procline(char *line, int lineno, FILE *outiibs, FILE *outfuncs,
   char mnemonic[16], *m;
   int setting;
   int clocks;
+  int iibused;
 
   /* parameters to fill in about instruction */
   int mnemonic_num;
@@ -2095,11 +2104,34 @@ void procline(char *line, int lineno, FILE *outiibs, FILE *outfuncs,
               exit(1);
             }
 
+            /* a condition only reads the flags it tests, not the XNZVC the
+               .def line gives for every cc, so liveness can drop the rest */
+            iibused = used;
+            switch (mnemonic_num)
+            {
+            case i_Bcc:
+            case i_DBcc:
+            case i_Scc:
+              iibused = cc_used[cc];
+              break;
+            case i_DBRA:
+            case i_SF:
+              iibused = 0;
+              break;
+            default:
+              break;
+            }
+
             /* write output lines */
 
-            fprintf(outiibs, "  { 0x%x, 0x%x, %d, { %d, %d, %d, %d, %d }, ",
-                    mask, bits, mnemonic_num, priv, endblk, imm_notzero, used,
-                    set);
+            if (iibused != used)
+              fprintf(outiibs, "  { 0x%x, 0x%x, %d, { %d, %d, %d, CC_USED(%d, %d), %d }, ",
+                      mask, bits, mnemonic_num, priv, endblk, imm_notzero, iibused,
+                      used, set);
+            else
+              fprintf(outiibs, "  { 0x%x, 0x%x, %d, { %d, %d, %d, %d, %d }, ",
+                      mask, bits, mnemonic_num, priv, endblk, imm_notzero, used,
+                      set);
             fprintf(outiibs, "%d, %d, %d, %d, %d, %d, %d, %d, %d, %d /*clk*/    },\n",
                     size, stype, dtype, sbitpos, dbitpos, immvalue,
                     cc, total, wordlen, clocks);
@@ -60,6 +60,7 @@ static int gendbg = 0;
 #endif
 
 void generate(FILE *o, int topnibble);
+void generate_fused(FILE *o);
 void generate_ea(FILE *o, t_iib *iib, t_type type, int update);
 void generate_eaval(FILE *o, t_iib *iib, t_type type);
 void generate_eastore(FILE *o, t_iib *iib, t_type type);
@@ -114,6 +115,7 @@ void generate_bits(FILE *o, t_iib *iib);
 
 #define OUT(x) fputs(x, o);
 #define FNAME_GEN68K_CPU_OUT "cpu68k-%x.c"
+#define FNAME_GEN68K_FUSED_OUT "cpu68k-g.c"
 
 /* program entry routine */
 
@@ -159,6 +161,21 @@ int main(int argc, char *argv[])
         }
     }
 
+    printf("g. ");
+    fflush(stdout);
+
+    if ((o = fopen(FNAME_GEN68K_FUSED_OUT, "w")) == NULL)
+    {
+        perror("fopen output");
+        exit(1);
+    }
+    generate_fused(o);
+    if (fclose(o))
+    {
+        perror("fclose output");
+        exit(1);
+    }
+
     printf("done.\n");
     fflush(stdout);
 
@@ -2433,6 +2450,85 @@ void generate(FILE *o, int topnibble)
     }
 }
 
+/*
+ * Fused pairs.  The addressing mode and size specialisation is already done by def68k, which
+ * expands every mode of every instruction into its own cpu_op_N, so CMP.B D1,D0 never goes
+ * near fetchbyte.  What's left is the dispatch between instructions, so the common flag
+ * setter + branch idioms get a single function that calls both halves directly, and the
+ * second indirect call (and the exec loop's trip around for it) goes away.
+ * cpu68k_makeipclist() swaps these in for the first IPC of a matching pair that sits in the
+ * same IPC table as the second.  -- RA
+ */
+
+static int fuse_first(t_iib *iib)
+{
+    switch (iib->mnemonic)
+    {
+    case i_CMP: // CMP.z <ea>,Dn and CMPI.z #,Dn
+        return iib->dtype == dt_Dreg &&
+               (iib->stype == dt_Dreg || iib->stype == dt_Aind || iib->stype == dt_Ainc || iib->stype == dt_Adis ||
+                iib->stype == dt_ImmB || iib->stype == dt_ImmW || iib->stype == dt_ImmL);
+    case i_TST:
+        return iib->stype == dt_Dreg || iib->stype == dt_Aind || iib->stype == dt_Adis || iib->stype == dt_AbsW;
+    case i_MOVE: // MOVE.z <ea>,(An)+ copy loops
+        return iib->dtype == dt_Ainc &&
+               (iib->stype == dt_Dreg || iib->stype == dt_Aind || iib->stype == dt_Ainc || iib->stype == dt_Adis);
+    default:
+        return 0;
+    }
+}
+
+static int fuse_second(t_iib *first, t_iib *second)
+{
+    if (first->mnemonic == i_MOVE)
+        return second->mnemonic == i_DBRA;
+    return second->mnemonic == i_Bcc && second->cc > 1; // BRA/BSR don't look at the flags
+}
+
+void generate_fused(FILE *o)
+{
+    int i, j;
+
+    fprintf(o, "/*****************************************************************************/\n");
+    fprintf(o, "/* cpu68k-g.c - fused instruction pairs, see generate_fused() in gen68k.c    */\n");
+    fprintf(o, "/*****************************************************************************/\n\n");
+    fprintf(o, "#include <cpu68k-inline.h>\n#include <def68k-proto.h>\n\n");
+
+    for (i = 0; i < iibs_num; i++)
+    {
+        if (!fuse_first(&iibs[i]) || !iibs[i].flags.set)
+            continue;
+
+        for (j = 0; j < iibs_num; j++)
+        {
+            if (!fuse_second(&iibs[i], &iibs[j]))
+                continue;
+
+            fprintf(o, "void cpu_fuse_%i_%i(t_ipc *ipc) /* %s + %s */ {\n", i, j,
+                    mnemonic_table[iibs[i].mnemonic].name, mnemonic_table[iibs[j].mnemonic].name);
+            OUT("  t_ipc *next = ipc->next;\n\n");
+            fprintf(o, "  cpu_op_%ib(ipc);\n", i);
+            OUT("  ABORT_OPCODE_CHK();\n");
+            OUT("  if (!next->function) return; // first half wrote to this page and freed its IPCs\n\n");
+            OUT("  InstructionRegister = next->opcode;\n");
+            OUT("  cpu68k_clocks += next->clks;\n");
+            fprintf(o, "  cpu_op_%ia(next);\n}\n\n", j);
+        }
+    }
+
+    OUT("t_fused cpu68k_fusedindex[] = {\n");
+    for (i = 0; i < iibs_num; i++)
+    {
+        if (!fuse_first(&iibs[i]) || !iibs[i].flags.set)
+            continue;
+
+        for (j = 0; j < iibs_num; j++)
+            if (fuse_second(&iibs[i], &iibs[j]))
+                fprintf(o, "    {%i, %i, cpu_fuse_%i_%i},\n", i, j, i, j);
+    }
+    OUT("    {-1, -1, NULL}};\n");
+}
+
 void generate_ea(FILE *o, t_iib *iib, t_type type, int update)
 {
     t_datatype datatype = type ? iib->dtype : iib->stype;
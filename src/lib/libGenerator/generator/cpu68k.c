@@ -41,6 +41,9 @@ t_ipc **ipcs = NULL;
 // 2005.04.14 - set IPCS much much higher - sorry, LisaTest needs'em.
 #define ipcs_to_get 8192 // 1024
 
+// first entry in cpu68k_fusedindex for each iib, or -1 if it never starts a fused pair.
+static int *fused_start = NULL;
+
 /*** forward references ***/
 
 void cpu68k_reset(void);
@@ -438,6 +441,16 @@ int cpu68k_init(void)
 
   cpu68k_totalfuncs = iibs_num;
 
+  if (!fused_start)
+    fused_start = (int *)malloc(iibs_num * sizeof(int));
+  if (!fused_start)
+    EXITR(85, 0, "Out of memory for the fused instruction index");
+  for (i = 0; i < iibs_num; i++)
+    fused_start[i] = -1;
+  for (i = 0; cpu68k_fusedindex[i].first >= 0; i++) // generated grouped by first
+    if (fused_start[cpu68k_fusedindex[i].first] < 0)
+      fused_start[cpu68k_fusedindex[i].first] = i;
+
   for (i = 0; i < 256; i++)
   {
     for (j = 0; j < 8; j++)
@@ -1095,6 +1108,179 @@ void checkNullIPCFN(void)
 }
 
 // 20061223 need to optimize this - it's the heaviest fn according to gprof.
+// Is there a fused function for this opcode followed by that one?  see generate_fused() in gen68k.c
+static t_fused *find_fused(uint16 opcode, uint16 nextopcode)
+{
+  t_iib *iib = cpu68k_iibtable[opcode], *niib = cpu68k_iibtable[nextopcode];
+  int first, second, i;
+
+  if (!iib || !niib || !fused_start)
+    return NULL;
+
+  first = (int)(iib - iibs);
+  second = (int)(niib - iibs);
+  if (first < 0 || first >= iibs_num || (i = fused_start[first]) < 0)
+    return NULL;
+
+  for (; cpu68k_fusedindex[i].first == first; i++)
+    if (cpu68k_fusedindex[i].second == second)
+      return &cpu68k_fusedindex[i];
+  return NULL;
+}
+
+#ifndef DEBUG
+// MOVE.L (Ay)+,(Ax)+ / DBRA and CLR.L (Ax)+ / DBRA loops.  These run in place of the MOVE or CLR
+// and do as many whole trips around the loop as they can on the host pointers of plain RAM pages,
+// stopping at a page boundary, before the next event is due, and before the last trip - that one
+// and the DBRA that falls out of the loop run as normal instructions, so the flags, the end of the
+// loop and anything that faults are exactly what they always were.  Each trip costs the MOVE/CLR
+// plus a taken DBRA, same as when they ran one by one.
+static uint32 bulk_loop_trips(t_ipc *ipc, uint32 src, uint32 dst)
+{
+  t_ipc *dbra = ipc->next;
+  mmu_trans_t *md = &mmu_trans[(dst & MMUEPAGEFL) >> 9];
+  uint32 trips = reg68k_regs[dbra->opcode & 7] & 0xffff; // the last one falls through the DBRA
+  uint32 clks = ipc->clks + dbra->clks;
+  XTIMER stop;
+
+  if ((dst & 1) || !md->hostptr || md->writefn != ram || md->table) // vidram, I/O, or code to invalidate
+    return 0;
+  trips = MIN(trips, (0x200 - (dst & 0x1ff)) >> 2);
+
+  if (src != 0xffffffff) // CLR has no source
+  {
+    mmu_trans_t *ms = &mmu_trans[(src & MMUEPAGEFL) >> 9];
+    if ((src & 1) || !ms->hostptr)
+      return 0;
+    trips = MIN(trips, (0x200 - (src & 0x1ff)) >> 2);
+  }
+
+  stop = MIN(clks_stop, cpu68k_clocks_stop);
+  if (cpu68k_clocks + clks >= stop)
+    return 0;
+  return MIN(trips, (uint32)((stop - cpu68k_clocks - 1) / clks));
+}
+
+static void bulk_loop_done(t_ipc *ipc, uint32 trips)
+{
+  t_ipc *dbra = ipc->next;
+  uint32 *count = &reg68k_regs[dbra->opcode & 7];
+
+  *count = (*count & 0xffff0000) | ((*count - trips) & 0xffff);
+  cpu68k_clocks += (XTIMER)trips * (ipc->clks + dbra->clks);
+  cpu68k_functable[(ipc->opcode << 1) + 1](ipc); // and this trip's MOVE/CLR the normal way
+}
+
+static void cpu68k_copyloop(t_ipc *ipc)
+{
+  uint32 *sreg = &reg68k_regs[8 + (ipc->opcode & 7)], *dreg = &reg68k_regs[8 + ((ipc->opcode >> 9) & 7)];
+  uint32 i, trips = bulk_loop_trips(ipc, *sreg, *dreg);
+
+  if (trips)
+  {
+    uint8 *s = mmu_trans[(*sreg & MMUEPAGEFL) >> 9].hostptr + (*sreg & 0x1ff);
+    uint8 *d = mmu_trans[(*dreg & MMUEPAGEFL) >> 9].hostptr + (*dreg & 0x1ff);
+
+    for (i = 0; i < trips; i++) // one long at a time, overlapping copies have to see earlier stores
+    {
+      uint32 l;
+      memcpy(&l, s + (i << 2), 4);
+      memcpy(d + (i << 2), &l, 4);
+    }
+    *sreg += trips << 2;
+    *dreg += trips << 2;
+  }
+  bulk_loop_done(ipc, trips);
+}
+
+static void cpu68k_fillloop(t_ipc *ipc)
+{
+  uint32 *dreg = &reg68k_regs[8 + (ipc->opcode & 7)];
+  uint32 trips = bulk_loop_trips(ipc, 0xffffffff, *dreg);
+
+  if (trips)
+  {
+    memset(mmu_trans[(*dreg & MMUEPAGEFL) >> 9].hostptr + (*dreg & 0x1ff), 0, trips << 2);
+    *dreg += trips << 2;
+  }
+  bulk_loop_done(ipc, trips);
+}
+
+// Is this a copy or clear loop, that is MOVE.L (Ay)+,(Ax)+ or CLR.L (Ax)+ followed by a DBRA back to it?
+static void (*find_bulk_loop(t_ipc *ipc, t_ipc *dbra, uint32 pc))(t_ipc *ipc)
+{
+  if ((dbra->opcode & 0xfff8) != 0x51c8 || (dbra->src & ADDRESSFILT) != pc)
+    return NULL;
+  if ((ipc->opcode & 0xf1f8) == 0x20d8 && (ipc->opcode & 7) != ((ipc->opcode >> 9) & 7))
+    return cpu68k_copyloop;
+  if ((ipc->opcode & 0xfff8) == 0x4298)
+    return cpu68k_fillloop;
+  return NULL;
+}
+
+// Which flags does the code at addr read before it sets them?  Walks straight line code on the
+// page's host pointer (never through I/O) until every flag has been written or the next branch,
+// where whatever hasn't been written yet counts as needed.
+static uint16 flags_needed_at(uint32 addr)
+{
+  mmu_trans_t *mmu_trn = GET_MMU_TRANS(addr >> 9);
+  uint32 page = addr >> 9;
+  uint16 needed = 0, killed = 0;
+  t_iib *iib;
+  int n;
+
+  for (n = 0; n < 16 && killed != 0x1F; n++)
+  {
+    uint8 *p;
+
+    if ((addr >> 9) != page || !mmu_trn->hostptr)
+      break;
+    p = mmu_trn->hostptr + (addr & 0x1ff);
+    iib = cpu68k_iibtable[(p[0] << 8) | p[1]];
+    if (!iib)
+      break;
+    needed |= iib->flags.used & ~killed;
+    killed |= iib->flags.set;
+    if (iib->flags.endblk)
+      break;
+    addr += iib->wordlen << 1;
+  }
+  return needed | (0x1F & ~killed);
+}
+
+// Flags the successors of a block need when it ends in a branch, or 0x1F if they can't be known.
+// Only when the whole block and its successors share one page, so nothing outlives the code it
+// was worked out from - any write to the page or remap of it throws the lot away together.
+static uint16 block_exit_flags(t_ipc *last, uint32 lastpc, uint32 startpc)
+{
+  t_iib *iib = cpu68k_iibtable[last->opcode];
+  uint32 nextpc = lastpc + (last->wordlen << 1);
+  uint32 target = last->src & ADDRESSFILT;
+
+  if (!iib || (startpc >> 9) != (lastpc >> 9))
+    return 0x1F;
+
+  switch (iib->mnemonic)
+  {
+  case i_Bcc:
+    if ((target >> 9) != (lastpc >> 9))
+      return 0x1F;
+    if (iib->cc == 0) // BRA
+      return flags_needed_at(target);
+    if ((nextpc >> 9) != (lastpc >> 9))
+      return 0x1F;
+    return flags_needed_at(target) | flags_needed_at(nextpc);
+  case i_DBcc:
+  case i_DBRA:
+    if ((target >> 9) != (lastpc >> 9) || (nextpc >> 9) != (lastpc >> 9))
+      return 0x1F;
+    return flags_needed_at(target) | flags_needed_at(nextpc);
+  default:
+    return 0x1F;
+  }
+}
+#endif
+
 t_ipc_table *cpu68k_makeipclist(uint32 pc)
 {
   // Generator was meant to work from ROMs, not from volatile RAM.
@@ -1162,7 +1348,7 @@ t_ipc_table *cpu68k_makeipclist(uint32 pc)
       EXITN(0, 0, "Out of memory in makeipclist trying to get ipc pointers!");
   }
 
-  mmu_trn = &mmu_trans[((pc) >> 9)];
+  mmu_trn = GET_MMU_TRANS((pc) >> 9);
   if (mmu_trn->readfn == bad_page)
   {
     free(ipcs);
@@ -1313,7 +1499,7 @@ t_ipc_table *cpu68k_makeipclist(uint32 pc)
     {
       xpc = pc | 0x1ff;
       DEBUG_LOG(200, "XPC I set as limit: %08x pc is %08x", xpc, pc);
-      mmu_trn = &mmu_trans[(pc >> 9) & 32767];
+      mmu_trn = GET_MMU_TRANS((pc >> 9) & 32767);
       table = mmu_trn->table; // we might not yet have table until we get here.
       if (!table)
       {
@@ -1394,6 +1580,11 @@ t_ipc_table *cpu68k_makeipclist(uint32 pc)
   ix = instrs; /*****************/
   //    ipc = ipcs[ix];
   required = 0x1F; /* all 5 flags need to be correct at end */
+#ifndef DEBUG
+  // unless the block ends in a branch to code we can see, then only what that code reads
+  required = block_exit_flags(ipcs[instrs - 1], (pc - (ipcs[instrs - 1]->wordlen << 1)) & ADDRESSFILT,
+                              original_pc & ADDRESSFILT);
+#endif
 
   // check_ipct_counts(__FUNCTION__,__LINE__);
 
@@ -1431,6 +1622,29 @@ t_ipc_table *cpu68k_makeipclist(uint32 pc)
   DEBUG_LOG(200, "out of ix-- loop, ix=%ld ipc is now %p at pc %06lx max %06lx **** corrected ipc's: %ld instructions **** \n\n", (long)ix,
             ipc, (long)pc, (long)xpc, (long)instrs);
 
+#ifndef DEBUG
+  // Now that the flags are settled, swap in the copy/clear loops and the fused CMP/TST+Bcc and
+  // MOVE+DBRA functions.  Only for pairs in the same page, so both live in one IPC table and get
+  // freed together.  Debug builds keep running one instruction at a time so the trace and the
+  // tracer see each of them.
+  pc = original_pc & ADDRESSFILT;
+  for (ix = 0; ix + 1 < (int)instrs; ix++)
+  {
+    uint32 nextpc = pc + (ipcs[ix]->wordlen << 1);
+    void (*bulk)(t_ipc *ipc);
+    t_fused *fused;
+
+    if (!((pc ^ nextpc) & ~0x1ff))
+    {
+      if ((bulk = find_bulk_loop(ipcs[ix], ipcs[ix + 1], pc)) != NULL)
+        ipcs[ix]->function = bulk;
+      else if (ipcs[ix]->set && (fused = find_fused(ipcs[ix]->opcode, ipcs[ix + 1]->opcode)) != NULL)
+        ipcs[ix]->function = fused->function;
+    }
+    pc = nextpc;
+  }
+#endif
+
   if (ipcs)
   {
     free(ipcs);
@@ -1178,7 +1178,7 @@ int is_valid_procname_w(uint16 w) { return (is_valid_procname(w >> 8) && is_vali
 int get_address_mmu_rfn_type(uint32 addr)
 {
   addr = addr & ADDRESSFILT;
-  return mmu_trans[(addr >> 9) & 32767].readfn;
+  return GET_MMU_TRANS((addr >> 9) & 32767)->readfn;
 }
 
 extern long get_wx_millis(void);
@@ -1658,7 +1658,7 @@ void print_ipc(uint32 pc)
 
   uint32 page;
   page = (pc & ADDRESSFILT) >> 9;
-  mt = &mmu_trans[page];
+  mt = GET_MMU_TRANS(page);
   ipc = &(mt->table->ipc[(pc & 0x1ff) >> 1]);
   piib = cpu68k_iibtable[ipc->opcode];
 
@@ -2213,7 +2213,7 @@ int32 reg68k_external_execute(int32 clocks)
 #endif
 
       ////////////////////////////////////////////////////////////////////////////////////////////////////////////
-      mt = &mmu_trans[(pc24 >> 9) & 32767];
+      mt = GET_MMU_TRANS((pc24 >> 9) & 32767);
       if (mt->readfn == bad_page)
       {
         // ALERT_LOG(0,"****************\nCurrent opcode lives inside a bad_page, throwing lisa_mmu_exception @ %ld/%08lx. Previous IR=%04lx",
@@ -2239,7 +2239,7 @@ int32 reg68k_external_execute(int32 clocks)
 #endif
       // get the page and the mmu_translation table entry for this pc24
       page = (pc24 & ADDRESSFILT) >> 9;
-      mt = &mmu_trans[page];
+      mt = GET_MMU_TRANS(page);
 
       // Is this page table allocated?  If not allocate it as needed.
       if (mt != NULL && mt->table != NULL)
@@ -2873,6 +2873,7 @@ void enable_4MB_macworks(void)
       mmu_trans_all[1][i].readfn = 17;
       mmu_trans_all[1][i].writefn = 17;
     }
+    reset_lazy_mmu();
     for (uint32 i = 0; i < maxlisaram / 0x20000; i++)
     {
       mmu[i].sor = 0x000;
@@ -2881,6 +2882,7 @@ void enable_4MB_macworks(void)
 
     minlisaram = 0;
   }
+  refresh_mmu_hostptrs();
 
   // might be able to get as high as 8MB as videoram latch=255 -> 0x7F8000
   videolatchaddress = maxlisaram - 32768;
@@ -2973,8 +2975,7 @@ void reg68k_internal_vector(int vno, uint32 oldpc, uint32 addr_error)
     // if (segment1|segment2)                 // if we're not in supervisor space already, flush the mmu
     {
       DEBUG_LOG(0, "Turning Supervisor flag on while in internal_vector flushing mmu context=%ld s1/s2=%ld/%ld start=%ld\n", (long)context, (long)segment1, (long)segment2, (long)start);
-      SET_MMU_DIRTY(0xdec0de);
-      mmuflush(0x3000);
+      mmuflush(0x3000); // 0x2000: flush every changed segment
       DEBUG_LOG(0, "post mmuflush context=%d s1/s2=%d/%d start=%d\n", context, segment1, segment2, start);
     }
 
@@ -3001,8 +3002,7 @@ void reg68k_internal_vector(int vno, uint32 oldpc, uint32 addr_error)
     if (x == 0xaf)
     {
       ALERT_LOG(0, "OOPS! Got bus error whilst trying to fetch vector:%ld - PC:%ld/%08lx", (long)vno, (long)context, (long)oldpc);
-      SET_MMU_DIRTY(0xdec0de);
-      mmuflush(0x3000);
+      mmuflush(0x3000); // 0x2000: flush every changed segment
       x = GETVECTOR(vno);
       if (x == 0xaf)
         ALERT_LOG(0, "Failed again after trying to flush mmu! Something is very wrong!");
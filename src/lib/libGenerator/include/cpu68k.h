@@ -9,10 +9,19 @@ extern unsigned int cpu68k_line;
 extern t_regs regs;
 extern uint8 movem_bit[256];
 extern unsigned int cpu68k_adaptive;
+extern XTIMER clks_stop; /* end of the current reg68k_external_execute() slice */
 
 extern t_iib iibs[];
 extern int iibs_num;
 
+typedef struct
+{
+  int first, second;            /* iib numbers of the pair */
+  void (*function)(t_ipc *ipc); /* runs both, called with the first's ipc */
+} t_fused;
+
+extern t_fused cpu68k_fusedindex[]; /* generated into cpu68k-g.c, ends with first=-1 */
+
 int cpu68k_init(void);
 void cpu68k_printipc(t_ipc *ipc);
 void cpu68k_ipc(uint32 addr68k, t_iib *iib, t_ipc *ipc);
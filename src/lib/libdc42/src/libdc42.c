@@ -1048,7 +1048,19 @@ int dc42_open(DC42ImageType *F, char *filename, char *options)
    }
    else
    {
-      // Open the image file in read-only mode
+      // Open the image file in read-only mode, the header read above closed it
+#ifndef __MSVCRT__
+      F->fd = open(F->fname, O_RDONLY);
+      if (F->fd < 3)
+         DC42_RET_CODE(F, -6, "Cannot open the file.", return F->retval);
+      F->fh = NULL;
+#else
+      F->fh = fopen(F->fname, "rb");
+      if (!F->fh)
+         DC42_RET_CODE(F, -6, "Cannot open the file.", return F->retval);
+      F->fd = 0;
+#endif
+
 #ifdef HAVE_MMAPEDIO
       if (F->mmappedio)
       {
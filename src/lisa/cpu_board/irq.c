@@ -706,6 +706,18 @@ void get_next_timer_event(void)
         next_expired_timer = CYCLE_TIMER_Z8530;
     }
 
+    // next character clocked into a receive FIFO
+    if (cpu68k_clocks_stop > z8530_rxb_event && z8530_rxb_event > -1)
+    {
+        cpu68k_clocks_stop = z8530_rxb_event;
+        next_expired_timer = CYCLE_TIMER_SCC_B_RCVD_CHAR;
+    }
+    if (cpu68k_clocks_stop > z8530_rxa_event && z8530_rxa_event > -1)
+    {
+        cpu68k_clocks_stop = z8530_rxa_event;
+        next_expired_timer = CYCLE_TIMER_SCC_A_RCVD_CHAR;
+    }
+
     // OOps! A timer expired, but we missed it! Do it very soon if it's enabled, if there's no timer, then recalculate this again
     // by setting clocks_stop very far in the future, which should cause the tenth_sec_cycles to kick in - if it's not, we just
     // get a null timer which kicks in again needlessly after 164 cycles.  We're not trying for recusrsion here, this shouldn't
@@ -735,6 +747,10 @@ void get_next_timer_event(void)
         DEBUG_LOG(0, "FDIR TIMER        :%016llx \t(diff:%016llx)", fdir_timer, fdir_timer - cpu68k_clocks);
     if (z8530_event != -1)
         DEBUG_LOG(0, "Z8530 Count Zero  :%016llx \t(diff:%016llx)", z8530_event, z8530_event - cpu68k_clocks);
+    if (z8530_rxb_event != -1)
+        DEBUG_LOG(0, "Z8530 B Rx char   :%016llx \t(diff:%016llx)", z8530_rxb_event, z8530_rxb_event - cpu68k_clocks);
+    if (z8530_rxa_event != -1)
+        DEBUG_LOG(0, "Z8530 A Rx char   :%016llx \t(diff:%016llx)", z8530_rxa_event, z8530_rxa_event - cpu68k_clocks);
     DEBUG_LOG(0, "Next timer        :%d %s", next_expired_timer, gettimername(next_expired_timer));
     DEBUG_LOG(0, "-------------------------------------------");
 #endif
@@ -757,6 +773,14 @@ extern void LisaScreenRefresh(void);
 // 1/0001bd28 (0 0/0/0) : 66ee                       : f.       : 1053 : BNE.B      $0001bd18  SRC:clk:00000000105f56fd +8 clks
 // so added a limit on how often you can reset the VTIR
 static XTIMER lastvideotimimgreset = 0;
+
+// Turbo mode: the host doesn't pace the 68K at all, so the COPS clock can't come from host time,
+// it's ticked off 68K cycles by the 1/10th second timer instead.  The VIA timers already run on
+// 68K cycles.  Not kept in vars.h so that a reboot in the middle of an install doesn't turn it off.
+static uint8 turbo = 0;
+void set_turbo_mode(int on) { turbo = (on != 0); }
+int turbo_mode(void) { return turbo; }
+
 void reset_video_timing(void)
 {
     // if you keep mashing on enable VTIR in a loop, this will only reset the circuitry once
@@ -777,6 +801,9 @@ void decisecond_clk_tick(void)
 {
     int years, days, hours, minutes, seconds, tenths;
 
+    if (inputlog_event('T', 0, 0, 0, NULL)) // host time driven, so it's replayed from the input log
+        return;
+
     // get current time into human readable variables
     years = lisa_clock.year & 0x0f;
     days = (((lisa_clock.days_h & 0xf0) >> 4) * 100 + (lisa_clock.days_h & 0x0f) * 10 + lisa_clock.days_l);
@@ -885,7 +912,11 @@ void check_current_timer_irq(void)
         case CYCLE_TIMER_SCC_B_EXT_STAT_CHG:
             break;
         case CYCLE_TIMER_SCC_B_RCVD_CHAR:
-            break;
+            z8530_rxb_event = -1;
+            scc_rx_timer(0);
+            next_expired_timer = 0;
+            get_next_timer_event();
+            return;
         case CYCLE_TIMER_SCC_B_SPECIAL:
             break;
         case CYCLE_TIMER_SCC_A_XMT_BUF_EMPTY:
@@ -893,7 +924,11 @@ void check_current_timer_irq(void)
         case CYCLE_TIMER_SCC_A_EXT_STAT_CHG:
             break;
         case CYCLE_TIMER_SCC_A_RCVD_CHAR:
-            break;
+            z8530_rxa_event = -1;
+            scc_rx_timer(1);
+            next_expired_timer = 0;
+            get_next_timer_event();
+            return;
         case CYCLE_TIMER_SCC_A_SPECIAL:
             break;
         }
@@ -938,6 +973,8 @@ void check_current_timer_irq(void)
             virq_start = cpu68k_clocks + VERT_RETRACE_ON;
             vertical = 1;
             verticallatch = 1;
+            shmvideo_retrace(); // frame done, publish it to any shared memory viewers
+            screenrec_retrace();
 
             if (videoirq & 1) // Interrupt if turned on.
             {                 // STAMP("autovector: firing video IRQ\n");
@@ -973,12 +1010,15 @@ void check_current_timer_irq(void)
     if ((next_expired_timer & 0x7f) == CYCLE_TIMER_COPS_MOUSE_IRQ)
     { // need to be careful with the next line as it calls reg68k_internal vector while *OUTSIDE*!!!!
         DEBUG_LOG(0, " CYCLE_TIMER_COPS_MOUSE_IRQ");
+        if (keyinject_due > -1 && cpu68k_clocks >= keyinject_due)
+            keyinject_tick(); // next scripted key code, if the Lisa has read the last one
         SET_COPS_NEXT_EVENT(0);
         // DEBUG_LOG(0,"COPS Timer Entered:: cpu68k_clocks:%ld, cops_event:%ld cops_mouse:%d\n",cpu68k_clocks,cops_event,cops_mouse);
 
         // Are COPS IRQ's enabled?  If so, either mouse timer IRQ's enabled? or was there a keystroke?
         // then, fire the IRQ.
-        if ((cops_event > 0 || copsqueuelen)) // 20060609   was (via[1].via[IER] & VIA_IRQ_BIT_CA1)    &&
+        // a timer that's only running for scripted keys doesn't send mouse data
+        if (((cops_event > 0 && cops_mouse) || copsqueuelen)) // 20060609   was (via[1].via[IER] & VIA_IRQ_BIT_CA1)    &&
         {
             DEBUG_LOG(0, "Setting IFR because either of these happened:");
             DEBUG_LOG(0, "via[1].via[IER] & CA1 bit:%d", (via[1].via[IER] & VIA_IRQ_BIT_CA1));
@@ -1058,6 +1098,8 @@ void check_current_timer_irq(void)
             return; // ensure we're not updating too often.
 
         // decisecond_clk_tick();             // handled by lisaem_wx.cpp OnIdle loop //20070409//
+        if (turbo)
+            decisecond_clk_tick(); // except in turbo mode, where host time has nothing to do with the 68K's
         tenth_sec_cycles = cpu68k_clocks + TENTH_OF_A_SECOND; // schedule next 1/10th second IRQ to fire
 
         // ALERT_LOG(0,"1/10th tick. cpu clk:%lld\n",cpu68k_clocks);
@@ -718,36 +718,95 @@ void fixmmu(uint32 addr)  ///////////////// junk?
 }
 */
 
-void activate_parity_check(void)
-{
+// Bad parity bookkeeping.  Only the bytes written while DIAG2 is on carry bad parity, which is a
+// handful of test locations, so they're kept as a sparse set: a 64 byte bitmap for each 512 byte
+// page that has any, with a count of bad bits per page and a total.  While DIAG2 is off only the
+// pages with bad bits go through the parity handlers (see lisa_diag2_bad_pages_mem), and once the
+// last bad bit has been read back or overwritten the parity handlers are removed altogether.
 
-    lisa_diag2_on_mem(); // hook memory function
-    if (mem_parity_bits2)
-        return; // already allocated, don't do it again
+#define PARITY_PAGES 16384 // 512 byte pages in 8MB, more than maxlisaram can be
+#define PARITY_PAGE_BYTES (512 / 8)
 
-    DEBUG_LOG(100, "allocating %d bits", (2 + (maxlisaram >> 3))); // 1 parity bit for every 8 bits
-    mem_parity_bits2 = calloc(1, 2 + (maxlisaram >> 3));
-    if (!mem_parity_bits2)
-    {
-        EXIT(313, 0, "Couldn't allocate %d bytes of memory for parity check.", (2 + (maxlisaram >> 3)));
-    }
+static uint8 *parity_page_bits[PARITY_PAGES];
+static uint16 parity_page_count[PARITY_PAGES];
+static uint32 parity_bad_count = 0;
+static uint8 parity_active = 0;
 
-    memset(mem_parity_bits2, 0, maxlisaram >> 3);
+int parity_page_bad(uint32 epage) { return epage < PARITY_PAGES && parity_page_count[epage]; }
+
+// Forget every bad bit without touching the memory fn's, used by release and by init_lisa_mmu.
+void clear_parity_bits(void)
+{
+    uint32 i;
+
+    if (parity_bad_count || parity_active)
+        for (i = 0; i < PARITY_PAGES; i++)
+        {
+            if (parity_page_bits[i])
+                free(parity_page_bits[i]);
+            parity_page_bits[i] = NULL;
+            parity_page_count[i] = 0;
+        }
+    parity_bad_count = 0;
+    parity_active = 0;
 }
 
-int release_parity_check(void)
+void activate_parity_check(void)
 {
-    if (!mem_parity_bits2)
-        free(mem_parity_bits2); // can't free NULL. :)
-    mem_parity_bits2 = NULL;
+    lisa_diag2_on_mem(); // hook memory function
+    parity_active = 1;
+}
 
+int release_parity_check(void)
+{
+    clear_parity_bits();
     lisa_diag2_off_mem(); // restore memory functions
     return 0;             // always return 0!!!
 }
 
+// DIAG2 was turned off: bytes written from now on get good parity.
+static void parity_diag2_off(void)
+{
+    if (!parity_active)
+        return;
+    if (!parity_bad_count)
+        release_parity_check();
+    else
+        lisa_diag2_bad_pages_mem();
+}
+
+static void clear_parity_bit(uint32 address)
+{
+    uint32 page = address >> 9;
+    uint8 bit = 1 << (address & 7);
+    uint8 *bits = parity_page_bits[page];
+
+    if (!bits || !(bits[(address & 511) >> 3] & bit))
+        return;
+
+    bits[(address & 511) >> 3] &= ~bit;
+    parity_bad_count--;
+    if (--parity_page_count[page])
+        return;
+
+    free(bits);
+    parity_page_bits[page] = NULL;
+    if (!diag2)
+    {
+        if (!parity_bad_count)
+        {
+            ALERT_LOG(0, "no bad parity bits left, releasing parity checks");
+            release_parity_check();
+        }
+        else
+            refresh_mmu_page_hostptr(page); // this page is clean again
+    }
+}
+
 int parity_check(uint32 address)
 {
-    uint32 retval, i, size, sum, *parity32;
+    uint32 retval;
+    uint8 *bits;
 
     // -1 means that it was a hardmem test (write to hardmem 2x)  if abort_opcode - then this is from the NMI or opcode decoder
     // so ignore parity issues.
@@ -759,9 +818,9 @@ int parity_check(uint32 address)
         return 0;
     }
 
-    if (mem_parity_bits2 == NULL)
+    if (!parity_bad_count)
     {
-        DEBUG_LOG(100, "No parity bits allocated, returning 0\n");
+        DEBUG_LOG(100, "No bad parity bits, returning 0\n");
         return 0;
     }
     if (address > maxlisaram)
@@ -770,45 +829,19 @@ int parity_check(uint32 address)
         return 0;
     }
 
-    DEBUG_LOG(100, "will be checking parity for %08x mem_parity_bits2[%08x]=%08x & %02x results: %02x\n", address, (address >> 3), mem_parity_bits2[address >> 3], (1 << (address & 7)), (mem_parity_bits2[address >> 3] & (1 << (address & 7))));
-
     if (!hardmem)
     {
         DEBUG_LOG(100, "hardmem isn't set, so I'm not checking it\n");
         return 0;
     }
 
-    retval = (mem_parity_bits2[address >> 3] & (1 << (address & 7)));
-
-    if (!diag2) // If diag2 mode is off, we might be able to free the parity array and save 256K
-    {
-        mem_parity_bits2[address >> 3] &= (0xff ^ (1 << (address & 7))); // clear the bad bit, it was already read
+    bits = parity_page_bits[address >> 9];
+    retval = bits ? (bits[(address & 511) >> 3] & (1 << (address & 7))) : 0;
+    DEBUG_LOG(100, "checked parity for %08x: %02x, %d bad bits on this page, %d total", address, retval,
+              parity_page_count[address >> 9], parity_bad_count);
 
-        //-----can we free the parity array yet?--------------------------------------------------------------------------------------
-        parity32 = (uint32 *)(mem_parity_bits2); // do these 32 bits wide at a time, es muy rapido!
-        size = (maxlisaram >> 5);                // div by 8 ,for 8 bits/byte, div by 4 for 4 bytes/uint32
-        for (sum = 0, i = 0; i < size && !sum; sum |= parity32[i++])
-            ; // check the bits - if any are set, we keep the mem_parity array
-
-        ALERT_LOG(0, "binary or sum of parity set bits is:%d, if zero, releasing parity memory", sum);
-
-        if (!sum)
-            release_parity_check(); // if no mem_parity bits, we can free up some memory.
-                                    //--------------------------------------------------------------------------------------------------------------------
-    }
-    else
-    {
-        ALERT_LOG(0, "DIAG2 is still set, I didn't try to release the parity ram");
-    }
-
-#ifdef DEBUG
-    if (mem_parity_bits2)
-        DEBUG_LOG(100, "checking mem_parity_bits2[%08x]=%08x & %02x results: %02x",
-                  (address >> 3),
-                  mem_parity_bits2[address >> 3],
-                  (1 << (address & 7)),
-                  (mem_parity_bits2[address >> 3] & (1 << (address & 7))));
-#endif
+    if (!diag2) // If diag2 mode is off, the bad bit was already read
+        clear_parity_bit(address);
 
     parity_error_hit |= (retval != 0);
 
@@ -819,30 +852,44 @@ int parity_check(uint32 address)
 
 void set_parity_check(uint32 address)
 {
-    // uint32 size,i;
+    uint32 page = address >> 9;
+    uint8 bit = 1 << (address & 7);
+    uint8 *bits;
 
-    if (address > maxlisaram)
+    if (address > maxlisaram || page >= PARITY_PAGES)
     {
         DEBUG_LOG(100, "Parity check address out of bounds! %08x>%08x", address, maxlisaram);
         return;
     }
 
-    if (mem_parity_bits2 == NULL)
+    if (!diag2) // good parity gets written, so this byte isn't bad anymore
+    {
+        clear_parity_bit(address);
+        return;
+    }
+
+    if (!parity_active)
     {
-        DEBUG_LOG(100, "No parity bits allocated, activating parity check...");
+        DEBUG_LOG(100, "Parity checks not active, activating parity check...");
         activate_parity_check();
-#ifdef DEBUG
-        if (mem_parity_bits2 == NULL)
+    }
+
+    bits = parity_page_bits[page];
+    if (!bits)
+    {
+        bits = parity_page_bits[page] = calloc(1, PARITY_PAGE_BYTES);
+        if (!bits)
         {
-            EXIT(314, 0, "Parity bits activation failure even after retry.");
+            EXIT(313, 0, "Couldn't allocate %d bytes of memory for parity check.", PARITY_PAGE_BYTES);
         }
-#endif
     }
 
-    DEBUG_LOG(100, "Setting mem_parity_bits2[%08x]=%08x | %02x results: %02x", (address >> 3), mem_parity_bits2[address >> 3], (1 << (address & 7)), (mem_parity_bits2[address >> 3] | (1 << (address & 7))));
-    mem_parity_bits2[address >> 3] |= 1 << (address & 7);
-
-    return;
+    DEBUG_LOG(100, "Setting bad parity for %08x", address);
+    if (bits[(address & 511) >> 3] & bit)
+        return;
+    bits[(address & 511) >> 3] |= bit;
+    parity_page_count[page]++;
+    parity_bad_count++;
 }
 
 int getsnbit(void)
@@ -3002,6 +3049,7 @@ void lisa_wb_Oxe000_latches(uint32 addr, uint8 data)
         if (diag2)
         {
             diag2 = 0;
+            parity_diag2_off();
         }
         return;
 
@@ -3781,6 +3829,7 @@ void lisa_wb_vidram(uint32 addr, uint8 data)
     // DEBUG_LOG(100,"mmu translation of %d/%08x is: %08x",context,addr,physaddr);
     if (physaddr > -1)
     {
+        SCREEN_LINE_DIRTY(physaddr, 90, 1);
         *(uint8 *)(&lisaram[physaddr]) = data;
         return;
     }
@@ -3828,6 +3877,7 @@ void lisa_ww_vidram(uint32 addr, uint16 data)
     CHK_RAM_LIMITS(addr);
     if (physaddr > -1)
     {
+        SCREEN_LINE_DIRTY(physaddr, 90, 2);
         *(uint16 *)(&lisaram[physaddr]) = LOCENDIAN16(data);
         return;
     }
@@ -3892,6 +3942,7 @@ void lisa_wl_vidram(uint32 addr, uint32 data)
     // DEBUG_LOG(100,"mmu translation of %d/%08x is: %08x",context,addr,physaddr);
     if (physaddr > -1)
     {
+        SCREEN_LINE_DIRTY(physaddr, 90, 4);
         *(uint32 *)(&lisaram[physaddr]) = LOCENDIAN32(data);
         return;
     }
@@ -3936,6 +3987,7 @@ void lisa_wb_xlvidram(uint32 addr, uint8 data)
 
     if (physaddr > -1)
     {
+        SCREEN_LINE_DIRTY(physaddr, 76, 1);
         *(uint8 *)(&lisaram[physaddr]) = data;
         return;
     }
@@ -3983,6 +4035,7 @@ void lisa_ww_xlvidram(uint32 addr, uint16 data)
     }
     if (physaddr > -1)
     {
+        SCREEN_LINE_DIRTY(physaddr, 76, 2);
         *(uint16 *)(&lisaram[physaddr]) = LOCENDIAN16(data);
         return;
     }
@@ -4046,6 +4099,7 @@ void lisa_wl_xlvidram(uint32 addr, uint32 data)
     }
     if (physaddr > -1)
     {
+        SCREEN_LINE_DIRTY(physaddr, 76, 4);
         *(uint32 *)(&lisaram[physaddr]) = LOCENDIAN32(data);
         return;
     }
@@ -4352,24 +4406,16 @@ void lisa_wb_sio_mrg(uint32 addr, uint8 data)
         //   dumpmmupage(con,a,buglog);
         // #endif
 
-        /* If the MMU is already dirty and it's a different register set, MMUDIRTY will be >128 since
-           we shift the last mmudirty to the left 8 bits.  This situation then indicates that we need
-           to flush all segments with mmu_all[con][seg].changed=1 in the current context (discounting START mode)
-
-           We do a+1 since segment 0 would be dirty, but need to set mmudirty to nonzero.
-
-           And we don't flush the mmu changes until we either change contexts, or we need to use
-           the MMU map while in special I/O mode.  This way we can be a bit lazy and avoid needless
-           MMU map recalculations.
+        /* Mark the segment dirty.  In START mode nothing is flushed here: the whole burst of SOR/SLR
+           writes is flushed once, when the context is next selected or when the MMU map is used
+           while in special I/O mode.  Outside START mode the live map is flushed right away, but
+           that only marks the segment's pages stale, they're rebuilt on their next access.  Either
+           way an SOR+SLR pair is one dirty bit, so its pages are only ever rebuilt once.
         */
 
-        GET_MMU_DIRTY(0);
-        if ((a + 1) != mmudirty)
-        {
-            SET_MMU_DIRTY((mmudirty << 8) | (a + 1));
-            if (context)
-                mmuflush(0);
-        }
+        SET_MMU_DIRTY(a);
+        if (context)
+            mmuflush(0);
         return;
     }
     else // Segment Limit Register
@@ -4393,13 +4439,9 @@ void lisa_wb_sio_mrg(uint32 addr, uint8 data)
         mmu_all[con][a].changed |= 1;
 
         // must correct mmu here!
-        GET_MMU_DIRTY(0);
-        if ((a + 1) != mmudirty)
-        {
-            SET_MMU_DIRTY((mmudirty << 8) | (a + 1));
-            if (context)
-                mmuflush(0);
-        }
+        SET_MMU_DIRTY(a);
+        if (context)
+            mmuflush(0);
         return;
     }
 }
@@ -4432,13 +4474,9 @@ void lisa_ww_sio_mrg(uint32 addr, uint16 data)
         mmu_all[con][a].sor = data;
         mmu_all[con][a].changed |= 2;
 
-        GET_MMU_DIRTY(0);
-        if ((a + 1) != mmudirty)
-        {
-            SET_MMU_DIRTY((mmudirty << 8) | (a + 1));
-            if (context)
-                mmuflush(0);
-        }
+        SET_MMU_DIRTY(a);
+        if (context)
+            mmuflush(0);
 #ifdef DEBUG
         {
             int16 pagestart, pageend;
@@ -4480,13 +4518,9 @@ void lisa_ww_sio_mrg(uint32 addr, uint16 data)
 
         /// correct MMU here!
 
-        GET_MMU_DIRTY(0);
-        if ((a + 1) != mmudirty)
-        {
-            SET_MMU_DIRTY((mmudirty << 8) | (a + 1));
-            if (context)
-                mmuflush(0);
-        }
+        SET_MMU_DIRTY(a);
+        if (context)
+            mmuflush(0);
 
 #ifdef DEBUG
         {
@@ -39,6 +39,48 @@
 void init_start_mode(void);
 int check_mmu0_chk(void);
 static uint32 mmu0_checksum = 0;
+static uint8 hostptrs_off = 0; // DIAG2 parity writes need every RAM access to go through the handlers
+
+// Host address of a translated page for the inline fetch/store fast path in vars.h, or NULL if
+// it has to go through its memory functions.  Only whole pages inside the installed RAM qualify,
+// CHK_RAM_LIMITS() in the handlers takes care of the rest.
+static uint8 *mmu_hostptr(mmu_trans_t *mt, uint32 epage)
+{
+    uint32 phys;
+
+    if (hostptrs_off)
+        return NULL;
+    if (mt->readfn == sio_rom)
+        return &lisarom[(epage << 9) & 0x3fff];
+    if (mt->readfn != ram || !lisaram || parity_page_bad(epage))
+        return NULL;
+
+    phys = (uint32)((int32)(epage << 9) + mt->address);
+    if (phys < minlisaram || phys + 512 > maxlisaram)
+        return NULL;
+    return &lisaram[phys];
+}
+
+// Recompute every page's host pointer after RAM limits or the parity diagnostic mode changed.
+void refresh_mmu_hostptrs(void)
+{
+    int cx;
+    uint32 i;
+
+    for (cx = 0; cx < 5; cx++)
+        for (i = 0; i < 32768; i++)
+            mmu_trans_all[cx][i].hostptr = mmu_hostptr(&mmu_trans_all[cx][i], i);
+}
+
+// Same, for one virtual page in every context - its last bad parity bit was just cleared.
+void refresh_mmu_page_hostptr(uint32 epage)
+{
+    int cx;
+
+    epage &= 32767;
+    for (cx = 0; cx < 5; cx++)
+        mmu_trans_all[cx][epage].hostptr = mmu_hostptr(&mmu_trans_all[cx][epage], epage);
+}
 
 #ifdef DEBUG
 void validate_mmu_segments(char *from);
@@ -174,12 +216,15 @@ void enable_vidram(void)
         mem68k_store_long[vidram] = lisa_wl_vidram;
     }
     videoramdirty |= 9; // ok now it's time to do so.
+    memset(screen_line_dirty, 0xff, SCREEN_MAX_LINES); // written through the ram handlers while it was off
 }
 
 void lisa_diag2_off_mem(void)
 {
     DEBUG_LOG(0, "mmmmmmm ** DISABLING PARITY MEMORY DIAGNOSTIC FUNCTIONS ** mmmmmmmmmm");
     // Turn off parity memory diagnostics
+    hostptrs_off = 0;
+    refresh_mmu_hostptrs();
     mem68k_memptr[ram] = lisa_mptr_ram;
 
     mem68k_fetch_byte[ram] = lisa_rb_ram;
@@ -211,6 +256,8 @@ void lisa_diag2_on_mem(void)
 {
     DEBUG_LOG(0, "mmmmmmm ** ENABLING PARITY MEMORY DIAGNOSTIC FUNCTIONS ** mmmmmmmmmm");
     // Turn on parity memory diagnostics
+    hostptrs_off = 1;
+    refresh_mmu_hostptrs();
     mem68k_fetch_byte[ram] = lisa_rb_ram_parity;
     mem68k_fetch_word[ram] = lisa_rw_ram_parity;
     mem68k_fetch_long[ram] = lisa_rl_ram_parity;
@@ -231,6 +278,15 @@ void lisa_diag2_on_mem(void)
     mem68k_memptr[vidram] = lisa_mptr_vidram;
 }
 
+// DIAG2 is off again but some bytes still hold bad parity.  The parity handlers stay in place,
+// but only pages with bad bits lose their host pointer, so everything else is back on the fast path.
+void lisa_diag2_bad_pages_mem(void)
+{
+    DEBUG_LOG(0, "mmmmmmm ** PARITY MEMORY DIAGNOSTICS NARROWED TO PAGES WITH BAD PARITY ** mmmmmmmmmm");
+    hostptrs_off = 0;
+    refresh_mmu_hostptrs();
+}
+
 uint32 get_mmu0_chk(void)
 {
     uint32 mmu0_checksum = 0;
@@ -313,6 +369,7 @@ void init_start_mode_segment(long i)
     mmu_trans_all[0][i].readfn = rfn;
     mmu_trans_all[0][i].writefn = wfn;
     mmu_trans_all[0][i].table = NULL; // 20190601 fixed a huge bug!
+    mmu_trans_all[0][i].hostptr = mmu_hostptr(&mmu_trans_all[0][i], i);
 }
 
 void init_start_mode(void)
@@ -322,6 +379,133 @@ void init_start_mode(void)
         init_start_mode_segment(i);
 }
 
+/*
+Lazy fill.  LOS rewrites SOR/SLR pairs all the time while swapping segments, and most of the
+256 pages of a segment aren't touched before it's changed again, so create_mmu_segment() only
+records what the segment now maps to, bumps its generation and turns its pages into stale_page.
+The first access to a stale page goes through the stale_page handlers below (or GET_MMU_TRANS
+for code that looks at mmu_trans directly, such as the PC lookup) which build just that page.
+A page's IPC's are kept unless the page really maps somewhere else now.
+*/
+
+typedef struct
+{
+    int32 ea;                 // what the segment maps to as of the last flush
+    lisa_mem_t rfn, wfn;      //
+    int16 pagestart, pageend; // -1 for an invalid SLR
+    uint32 gen;               // bumped every time the segment is flushed
+    uint16 stale;             // pages still waiting to be rebuilt, 256 means none were touched
+} mmu_seg_fill_t;
+
+static mmu_seg_fill_t mmu_seg_fill[5][128];
+
+/*
+Snapshot of the SOR/SLR pairs each context's translation tables were built from - the context's
+fingerprint, kept exact rather than hashed so it can't collide.  Xenix and UniPlus reload the whole
+user context on a process switch, and LOS writes SORs a byte at a time, so a segment is often dirty
+but ends up holding exactly what its tables already map.  mmuflush() skips those, keeping their
+pages and IPC's as they are, so re-entering an unchanged context costs no rebuilds at all.
+*/
+
+#define MMU_PAIR(m) ((((uint32)(m).sor & 0x0fff) << 16) | (m).slr)
+#define MMU_PAIR_NONE 0xffffffff // sor is only 12 bits, so this never matches
+
+static uint32 mmu_built[5][128];
+
+// Forget the stale counts, for when the translation tables are rewritten wholesale.
+void reset_lazy_mmu(void)
+{
+    memset(mmu_seg_fill, 0, sizeof(mmu_seg_fill));
+    memset(mmu_built, 0xff, sizeof(mmu_built)); // MMU_PAIR_NONE
+}
+
+static void stale_mmu_segment(uint8 segment, int32 ea, lisa_mem_t rfn, lisa_mem_t wfn, int16 pagestart, int16 pageend)
+{
+    int cx = CXSEL, i;
+    mmu_seg_fill_t *sf = &mmu_seg_fill[cx][segment];
+    mmu_trans_t *mt = &mmu_trans_all[cx][segment << 8];
+
+    if (!is_valid_slr(mmu_all[cx][segment].slr))
+    {
+        pagestart = -1;
+        pageend = -1;
+    }
+
+    sf->ea = ea;
+    sf->rfn = rfn;
+    sf->wfn = wfn;
+    sf->pagestart = pagestart;
+    sf->pageend = pageend;
+    sf->gen++;
+
+    DEBUG_LOG(0, "segment %d context %d generation %d, %d pages were still stale", segment, cx, sf->gen, sf->stale);
+    if (sf->stale == 256)
+        return; // nobody looked at it since the last change, the pages are already stale
+
+    for (i = 0; i < 256; i++, mt++)
+        if (mt->readfn != stale_page)
+        {
+            mt->stalefn = mt->readfn;
+            mt->readfn = stale_page;
+            mt->writefn = stale_page;
+            mt->hostptr = NULL;
+        }
+    sf->stale = 256;
+}
+
+// Build a single stale page from what its segment was last flushed with.
+mmu_trans_t *rebuild_mmu_page(int cx, uint32 epage)
+{
+    mmu_trans_t *mt;
+    mmu_seg_fill_t *sf;
+    lisa_mem_t rfn = bad_page, wfn = bad_page;
+    int32 ea = 0;
+    int i;
+
+    epage &= 32767;
+    mt = &mmu_trans_all[cx][epage];
+    if (mt->readfn != stale_page)
+        return mt;
+
+    sf = &mmu_seg_fill[cx][epage >> 8];
+    i = epage & 255;
+    if (i >= sf->pagestart && i <= sf->pageend)
+    {
+        rfn = sf->rfn;
+        wfn = sf->wfn;
+        ea = sf->ea;
+        // wfn to ram is special because writes could be to video ram which I need to trap
+        if (wfn == ram && (videolatchaddress + 32768) > (epage << 9) && videolatchaddress <= (epage << 9))
+        {
+            wfn = vidram;
+            lastvideo_mt = mt;
+        }
+    }
+
+    if (mt->table && (mt->address != ea || mt->stalefn != rfn))
+    {
+        DEBUG_LOG(0, "calling free_ipct for mmu_trans_all[%d][%ld], mapping moved", cx, (long)epage);
+        free_ipct(mt->table);
+        mt->table = NULL;
+    }
+
+    mt->address = ea;
+    mt->readfn = rfn;
+    mt->writefn = wfn;
+    mt->hostptr = mmu_hostptr(mt, epage);
+    if (sf->stale)
+        sf->stale--;
+    return mt;
+}
+
+static uint8 *lisa_mptr_stale(uint32 addr) { return mem68k_memptr[rebuild_mmu_page(context, (addr & MMUEPAGEFL) >> 9)->readfn](addr); }
+static uint8 lisa_rb_stale(uint32 addr) { return mem68k_fetch_byte[rebuild_mmu_page(context, (addr & MMUEPAGEFL) >> 9)->readfn](addr); }
+static uint16 lisa_rw_stale(uint32 addr) { return mem68k_fetch_word[rebuild_mmu_page(context, (addr & MMUEPAGEFL) >> 9)->readfn](addr); }
+static uint32 lisa_rl_stale(uint32 addr) { return mem68k_fetch_long[rebuild_mmu_page(context, (addr & MMUEPAGEFL) >> 9)->readfn](addr); }
+static void lisa_wb_stale(uint32 addr, uint8 data) { mem68k_store_byte[rebuild_mmu_page(context, (addr & MMUEPAGEFL) >> 9)->writefn](addr, data); }
+static void lisa_ww_stale(uint32 addr, uint16 data) { mem68k_store_word[rebuild_mmu_page(context, (addr & MMUEPAGEFL) >> 9)->writefn](addr, data); }
+static void lisa_wl_stale(uint32 addr, uint32 data) { mem68k_store_long[rebuild_mmu_page(context, (addr & MMUEPAGEFL) >> 9)->writefn](addr, data); }
+
 void init_lisa_mmu(void)
 {
     long i, j;
@@ -331,13 +515,13 @@ void init_lisa_mmu(void)
     segment2 = 0;
     context = 0;
     mmudirty = 0;
-    mmudirty_all[0] = 0;
-    mmudirty_all[1] = 0;
-    mmudirty_all[2] = 0;
-    mmudirty_all[3] = 0;
-    mmudirty_all[4] = 0;
+    memset(mmudirty_all, 0, sizeof(mmudirty_all));
+    memset(mmudirty_segs, 0, sizeof(mmudirty_segs));
 
     DEBUG_LOG(0, "Initializing... mmu_trans_all: %p mmu_all: %p", mmu_trans_all, mmu_all);
+    reset_lazy_mmu();
+    clear_parity_bits(); // the memory fn's below start out without parity diagnostics
+    hostptrs_off = 0;
 
     for (i = 0; i < 32768; i++) // Initialize START mode (setup in hwg81) translation table
     {
@@ -350,30 +534,27 @@ void init_lisa_mmu(void)
         mmu_trans_all[1][i].readfn = bad_page;
         mmu_trans_all[1][i].writefn = bad_page;
         mmu_trans_all[1][i].table = NULL;
+        mmu_trans_all[1][i].hostptr = NULL;
 
         mmu_trans_all[2][i].address = 0;
         mmu_trans_all[2][i].readfn = bad_page;
         mmu_trans_all[2][i].writefn = bad_page;
         mmu_trans_all[2][i].table = NULL;
+        mmu_trans_all[2][i].hostptr = NULL;
 
         mmu_trans_all[3][i].address = 0;
         mmu_trans_all[3][i].readfn = bad_page;
         mmu_trans_all[3][i].writefn = bad_page;
         mmu_trans_all[3][i].table = NULL;
+        mmu_trans_all[3][i].hostptr = NULL;
 
         mmu_trans_all[4][i].address = 0;
         mmu_trans_all[4][i].readfn = bad_page;
         mmu_trans_all[4][i].writefn = bad_page;
         mmu_trans_all[4][i].table = NULL;
+        mmu_trans_all[4][i].hostptr = NULL;
 
         init_start_mode_segment(i);
-
-        mmudirty = 0;
-        mmudirty_all[0] = 0;
-        mmudirty_all[1] = 0xdec0de;
-        mmudirty_all[2] = 0xdec0de;
-        mmudirty_all[3] = 0xdec0de;
-        mmudirty_all[4] = 0xdec0de;
     }
 
     for (i = 0; i < 128; i++) // Initialize START mode fake mmu table
@@ -396,6 +577,8 @@ void init_lisa_mmu(void)
         mmu_all[2][i].changed = 1;
         mmu_all[4][i].changed = 1;
     }
+    for (i = 1; i < 5; i++)
+        mark_mmu_changed_dirty(i);
 
     // fill up memory
     for (j = 0, i = (minlisaram >> 9); i < (maxlisaram >> 9); i += ((128 * 1024) >> 9), j++)
@@ -631,6 +814,14 @@ void init_lisa_mmu(void)
     mem68k_store_word[OxVoid] = lisa_ww_OxVoid;
     mem68k_store_long[OxVoid] = lisa_wl_OxVoid;
 
+    mem68k_memptr[stale_page] = lisa_mptr_stale;
+    mem68k_fetch_byte[stale_page] = lisa_rb_stale;
+    mem68k_fetch_word[stale_page] = lisa_rw_stale;
+    mem68k_fetch_long[stale_page] = lisa_rl_stale;
+    mem68k_store_byte[stale_page] = lisa_wb_stale;
+    mem68k_store_word[stale_page] = lisa_ww_stale;
+    mem68k_store_long[stale_page] = lisa_wl_stale;
+
     DEBUG_LOG(0, "mmu_trans_all: %p mmu_all: %p", mmu_trans_all, mmu_all);
     segment1 = 0;
     segment2 = 0;
@@ -716,6 +907,7 @@ void fill_mmu_segment(uint8 segment, int32 ea, lisa_mem_t rfn, lisa_mem_t wfn, i
     }
 
     DEBUG_LOG(0, "starting on segment %d", segment);
+    mmu_seg_fill[cx][segment].stale = 0; // every page gets filled in right now
 
     if (!is_valid_slr(mmu_all[cx][segment].slr))
     {
@@ -739,6 +931,7 @@ void fill_mmu_segment(uint8 segment, int32 ea, lisa_mem_t rfn, lisa_mem_t wfn, i
                 mt->table = NULL;
             } // invalidate ipct's
               // and wipe pointer to be sure it won't be followed
+            mt->hostptr = mmu_hostptr(mt, segment8 + i);
         }
     }
     else if (wfn == ram) // wfn to ram is special because writes could be to video ram which I need to trap
@@ -789,6 +982,7 @@ void fill_mmu_segment(uint8 segment, int32 ea, lisa_mem_t rfn, lisa_mem_t wfn, i
                 mt->table = NULL;
             } // invalidate ipct's
               //   and wipe pointer to be sure it won't be followed
+            mt->hostptr = mmu_hostptr(mt, segment8 + i);
         }
     }
     else
@@ -822,6 +1016,7 @@ void fill_mmu_segment(uint8 segment, int32 ea, lisa_mem_t rfn, lisa_mem_t wfn, i
                 mt->table = NULL;
             } // invalidate ipct's
               //   and wipe pointer to be sure it won't be followed
+            mt->hostptr = mmu_hostptr(mt, segment8 + i);
 
 #ifdef DEBUG
             in = (segment << 17) + (i << 9);
@@ -934,7 +1129,8 @@ void create_mmu_segment(uint8 segment)
     get_slr_page_range(context, segment, &pagestart, &pageend, &rfn, &wfn);
     DEBUG_LOG(0, "MMU: Got values from page_range Segment:%d ea:%08x, rfn:%d, wfn:%d, pagestart:%08x,pageend:%08x\n", segment, ea, rfn, wfn, pagestart, pageend);
 
-    fill_mmu_segment(segment, ea, rfn, wfn, pagestart, pageend);
+    stale_mmu_segment(segment, ea, rfn, wfn, pagestart, pageend);
+    mmu_built[context][segment] = MMU_PAIR(mmu[segment]);
 
     //    #ifdef DEBUG
     //    if ( (slr & FILTR)==SLR_RO_STK || (slr & FILTR)==SLR_RW_STK )  {
@@ -959,17 +1155,34 @@ void create_mmu_segment(uint8 segment)
 /*
 Flush dirty MMU pages to our mmu_trans structures.
 
-If the MMU is already dirty and it's a different register set, MMUDIRTY will be >128 since
-we shift the last mmudirty to the left 8 bits.  This situation then indicates that we need
-to flush all segments with mmu[seg].changed=1 in the current context (discounting START mode)
-
-We do a+1 since segment 0 would be dirty, but need to set mmudirty to nonzero.
+Each SOR/SLR write sets its segment's bit in mmudirty_segs[context], so a burst of writes -
+LOS reprogramming a handful of segments on a process swap - costs a bit per segment, and
+writing both registers of a segment still leaves just the one bit.  The flush walks the set
+bits only, rebuilding each changed segment once.
 
 And we don't flush the mmu changes until we either change contexts, or we need to use
 the MMU map while in special I/O mode.  This way we can be a bit lazy and avoid needless
 MMU map recalculations.
 */
 
+void mark_mmu_segment_dirty(int cx, int segment)
+{
+    if (MMU_SEG_DIRTY(cx, segment))
+        return;
+    mmudirty_segs[cx][segment >> 5] |= 1 << (segment & 31);
+    mmudirty_all[cx]++;
+}
+
+// every segment of the context with its changed flag set, for when the registers were set behind our back
+void mark_mmu_changed_dirty(int cx)
+{
+    int i;
+
+    for (i = 0; i < 128; i++)
+        if (mmu_all[cx][i].changed)
+            mark_mmu_segment_dirty(cx, i);
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 // reg68k externs - allow us to make sure that lastsflag is correct before     //
 // changing contexts, else we face disasterous unpredictable results!          //
@@ -985,7 +1198,8 @@ extern void refresh_vidram_fns(void);
 
 void mmuflush(uint16 opts)
 {
-    int i, changedcx[5]; //,j
+    int i, w, built = 0, kept = 0;
+    uint32 bits;
 
     /* Save context and push to context without START mode.  Changes to the MMU map during Context 0 (START)
        need to propagate to the proper MMU context bank!  This ensures that it's done.  Further, our context 0
@@ -1003,10 +1217,10 @@ void mmuflush(uint16 opts)
         lastsflag = 1;
     else
         reg68k_update_supervisor_external();
-    if (opts & 0x2000)
-        mmudirty = 0xdec0de;
-
     CONTEXTSELECTOR();
+    if (opts & 0x2000)
+        mark_mmu_changed_dirty(context);
+    mmudirty = mmudirty_all[context];
 
     DEBUG_LOG(10, "mmu flush - old context:%d supervisor_flag:%d current s flag:%d switching to context=%d s1/s2=%d/%d start=%d\n",
               lastcontext, lastsflag, regs.sr.sr_struct.s,
@@ -1031,24 +1245,6 @@ void mmuflush(uint16 opts)
         return;
     }
 
-    ////// there's some fucked up bug where the flush doesn't properly happen ////////////////////////////////
-    changedcx[0] = 0;
-    changedcx[1] = 0;
-    changedcx[2] = 0;
-    changedcx[3] = 0;
-    changedcx[4] = 0;
-
-    // for (j=1; j<5; j++)
-    // for (i=0; i<128; i++) if (mmu_all[j][i].changed) cxchanged[cx]=1;
-    for (i = 0; i < 128; i++)
-        if (mmu[i].changed)
-            changedcx[context]++;
-    if (changedcx[context] > 1)
-        mmudirty = 0xdec0de;
-    if (changedcx[context] == 1 && !mmudirty)
-        mmudirty = 0xdec0de;
-    /////////////////////////////////////////////////////////////////////////////////////////////////////////
-
     if (!mmudirty)
     {
         lastcontext = context;
@@ -1056,45 +1252,31 @@ void mmuflush(uint16 opts)
         return;
     }
 
-    // if (!mmudirty) mmudirty=0xdec0de;   // temporary hack, let's see what happens.
-
     DEBUG_LOG(0, "context=%d s1/s2=%d/%d start=%d", context, segment1, segment2, start);
-    DEBUG_LOG(0, "mmudirty=%08x mmu context=%d", mmudirty, context);
-
-    if (mmudirty <= 128)  // singe mmu change
-    {                     ////////
-        i = mmudirty - 1; // correct it, -1 since we did a+1 in the lisa_??_mrg fn's - check the changed flag just incase.
-        if (i < 0)
-        {
-            EXIT(341, 10, "i<0!!!!!!!!");
-        }
+    DEBUG_LOG(0, "mmudirty=%d segments, mmu context=%d", mmudirty, context);
 
-        if (mmu[i].changed && is_valid_slr(mmu[i].slr))
-        {
-            DEBUG_LOG(0, "flushing mmu segment %d (invalidate+create) in context %d slr=%04x,sor=%04x", i, context, mmu[i].slr, mmu[i].sor);
-            create_mmu_segment(i);
-            mmu[i].changed = 0;
-        }
-        else
-        {
-            mmudirty = 0xdec0de;
-        } // fall through, something's odd}
-
-    } /////////
-
-    if (mmudirty > 128) // ---------------------------------------------------------------------------------------------------
+    for (w = 0; w < 4; w++)
     {
-        DEBUG_LOG(10, "mmu is dirty(context switch or more than one mmu change- doing all changed registers with valid SLR's\n");
-        for (i = 0; i < 128; i++)
-            if (mmu[i].changed && is_valid_slr(mmu[i].slr))
+        bits = mmudirty_segs[context][w];
+        mmudirty_segs[context][w] = 0;
+        for (i = w << 5; bits; i++, bits >>= 1)
+            if ((bits & 1) && mmu[i].changed && is_valid_slr(mmu[i].slr))
             {
+                mmu[i].changed = 0;
+                if (mmu_built[context][i] == MMU_PAIR(mmu[i]))
+                {
+                    kept++;
+                    continue; // written back to what the tables already map
+                }
                 DEBUG_LOG(0, "flushing mmu segment %d (invalidate+create) in context %d slr=%04x,sor=%04x", i, context, mmu[i].slr, mmu[i].sor);
                 create_mmu_segment(i);
-                mmu[i].changed = 0;
+                built++;
             }
+    }
+    DEBUG_LOG(0, "context %d: %d segments rebuilt, %d unchanged since the last build", context, built, kept);
+    mmudirty_all[context] = 0; // MMU is now clean.
+    mmudirty = 0;
 
-        SET_MMU_DIRTY(0); // MMU is now clean.
-    }                     // 0xdec0de --- ends
 #ifdef DEBUG
     DEBUG_LOG(10, "Validating MMU segments.");
     DEBUG_LOG(10, "pre-validating context=%d s1/s2=%d/%d start=%d\n", context, segment1, segment2, start);
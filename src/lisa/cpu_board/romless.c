@@ -494,12 +494,8 @@ int romless_boot(int profileboot)
   segment1 = 0;
   segment2 = 0;
   start = 0;
-  mmudirty = 0xdec0de;
-  mmudirty_all[0] = 0;
-  mmudirty_all[1] = 0xdec0de;
-  mmudirty_all[2] = 0xdec0de;
-  mmudirty_all[3] = 0xdec0de;
-  mmudirty_all[4] = 0xdec0de;
+  for (i = 1; i < 5; i++)
+    mark_mmu_changed_dirty(i);
   mmuflush(0x2000);
 
   for (i = 0; i < 0x560; i++)
@@ -710,6 +706,7 @@ int romless_boot(int profileboot)
   }
 
   videoramdirty = 32768;
+  memset(screen_line_dirty, 0xff, SCREEN_MAX_LINES);
 
   reg68k_sr.sr_struct.c = 0;
   cpu68k_makeipclist(pc24);
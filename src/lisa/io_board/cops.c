@@ -112,6 +112,8 @@ int mouse_keys_enabled = 0, mouse_keys_x = 0, mouse_keys_y = 0;
 void init_clock(void);
 
 void bigm_delta(int16 x, int16 y);
+static void mouse_abs_event(int16 x, int16 y, int8 button);
+static void mouse_abs_next(void);
 // void recalibratemouse_inside(int x,int y,int wx,int wy,int ww,int wh);
 
 #define MAXQUEUEFULL 32
@@ -413,6 +415,8 @@ void keystroke_cops(unsigned char c)
   uint8 j, len;
 
   //    DEBUG_LOG(0,"SRC: COPS Keystroke %02x %c",c,c>31 && c<127 ? c:'*');
+  if (inputlog_event('K', c, 0, 0, NULL))
+    return;
 
   for (len = 0, j = 0; j < 9; j++)
     if (keydecodetable[(unsigned)c][j])
@@ -479,6 +483,8 @@ void send_nmi_key(void)
 
 void send_cops_keycode(int k)
 {
+  if (inputlog_event('C', k, 0, 0, NULL))
+    return;
   SEND_COPS_CODE(k);
   SET_COPS_NEXT_EVENT(0);
 }
@@ -499,6 +505,9 @@ void apple_combo_key(uint8 key, uint8 shift, uint8 cmdkey, uint8 option, char *s
 {
   int size = 1;
 
+  if (inputlog_event('A', key, (shift ? 1 : 0) | (cmdkey ? 2 : 0) | (option ? 4 : 0), 0, NULL))
+    return;
+
   ALERT_LOG(0, "Sending %s", s);
 
   if (shift)
@@ -557,6 +566,8 @@ void shift_option_7(void) { apple_combo_key(KEYCODE_7, 1, 0, 1, "Shift-Option-7"
 
 void apple_dot_down(void)
 {
+  if (inputlog_event('D', 1, 0, 0, NULL))
+    return;
   if ((NMIKEY & 0x7f) == KEYCODE_DOT)
   {
     lisa_external_nmi_vector(pc24);
@@ -571,6 +582,8 @@ void apple_dot_down(void)
 
 void apple_dot_up(void)
 {
+  if (inputlog_event('D', 0, 0, 0, NULL))
+    return;
   if (copsqueuelen > MAXCOPSQUEUE - 3 || copsqueuelen < 0)
     return;
   DEBUG_LOG(0, "apple-. up");
@@ -580,6 +593,8 @@ void apple_dot_up(void)
 
 void presspowerswitch(void)
 {
+  if (inputlog_event('P', 0, 0, 0, NULL))
+    return;
   DEBUG_LOG(0, "SRC: COPS: Pressing Power Switch");
   SEND_RESETCOPS_AND_CODE(0xFB); // 0x80 0xFB - Soft Power Switch Sequence
 }
@@ -681,6 +696,7 @@ void cops_reset(void) // write 0 to port b bit 0
   // Older COPS behavior is to send keyboard unplugged signal before keyboard id,
   // and mouse unplugged signal before mouse plugged signal on a reset.
   copsqueuelen = 0;
+  keyinject_drained(); // a scripted key code that was waiting is gone
 
   // DEBUG_LOG(0,"COPS Reset");
   // if ((pc24 & 0x00ff0000)!=0x00fe0000) {debug_on("cops_reset"); debug_log_enabled=1;}
@@ -1307,6 +1323,10 @@ uint8 via1_ira(uint8 regnum)
 
   VIA_CLEAR_IRQ_PORT_A(1); // clear CA1/CA2 on ORA/IRA access
 
+  // in absolute mode the next queued packet is loaded here, a button change goes out as a key code
+  if (copsqueuelen <= 0 && mouse_absolute)
+    mouse_abs_next();
+
   // if there are no keystrokes pending, send mouse events.
   if (copsqueuelen <= 0)
   {
@@ -1341,6 +1361,8 @@ uint8 via1_ira(uint8 regnum)
     copsqueue[i] = copsqueue[i + 1];
   copsqueuelen--;
   copsqueue[i] = 0x00;
+  if (keyinject_draining && !copsqueuelen)
+    keyinject_drained(); // scripted keys go out as the Lisa reads them
   //    ALERT_LOG(0,"returning %02x, %d bytes left.  %02x,%02x,%02x,%02x,%02x,%02x,%02x,%02x,",data,copsqueuelen,
   //                copsqueue[0],copsqueue[1],copsqueue[2],copsqueue[3],
   //				copsqueue[4],copsqueue[5],copsqueue[6],copsqueue[7]);
@@ -1351,6 +1373,9 @@ uint8 via1_ira(uint8 regnum)
 
 void add_mouse_event(int16 x, int16 y, int8 button)
 {
+  if (inputlog_event('M', x, y, button, NULL))
+    return;
+
   if (mousequeuelen + 1 > MAXMOUSEQUEUE)
   {
     ALERT_LOG(0, "overflowed mouse queue!");
@@ -1363,6 +1388,12 @@ void add_mouse_event(int16 x, int16 y, int8 button)
   if (x < 0 || x > lisa_vid_size_x || y < 0 || y > lisa_vid_size_y)
     return;
 
+  if (mouse_absolute)
+  {
+    mouse_abs_event(x, y, button);
+    return;
+  }
+
   // if it's not a click, update the current one in the queue - if there is one.
   if (!button && mousequeuelen && !mousequeue[mousequeuelen].button)
   {
@@ -1397,6 +1428,9 @@ void seek_mouse_event(void)
   if (floppy_6504_wait > 0 && floppy_6504_wait < 128)
     floppy_6504_wait--;
 
+  if (mouse_absolute)
+    return; // nothing to poll for, the packets were queued by add_mouse_event
+
   if (mouse_seek_count)
   {
     mouse_seek_count--;
@@ -1515,6 +1549,176 @@ void seek_mouse_event(void)
   } // 2006.07.12 moved this inside of the if statement.
 }
 
+// Absolute pointer positioning.  Rather than polling the OS's idea of the pointer every
+// slice and nudging it along, each host event is turned into the exact list of deltas
+// that gets there, and via1_ira hands one out per mouse packet.  The list only depends on
+// where the pointer was when it was last empty, so a replayed input log lands on the same
+// spots.  Once it drains the position is read back a frame later and up to two
+// corrections are queued, that covers an OS that clips or accelerates a step anyway.
+
+#define MOUSE_ABS_QUEUE 1024
+#define MOUSE_ABS_CHECKS 2
+
+typedef struct
+{
+  int8 dx, dy;
+  int8 button; // 0 for motion, otherwise +1 down, -1 up
+} mouse_abs_t;
+
+static mouse_abs_t mouse_abs_q[MOUSE_ABS_QUEUE];
+static int mouse_abs_head = 0, mouse_abs_len = 0;
+static int16 mouse_abs_x = -1, mouse_abs_y = -1; // where the pointer is once the queue has gone out
+static int mouse_abs_checks = 0;
+static XTIMER mouse_abs_sent = 0;
+
+static int mouse_abs_read(int16 *x, int16 *y)
+{
+  int xabort_opcode = abort_opcode;
+
+  if (!is_lisa_mouse_on())
+    return 0;
+
+  abort_opcode = 2;
+  GET_RAT_XY(0);
+  abort_opcode = xabort_opcode;
+
+  if (ratx > lisa_vid_size_x || raty > lisa_vid_size_y)
+    return 0;
+
+  *x = (int16)ratx;
+  *y = (int16)raty;
+  return 1;
+}
+
+static void mouse_abs_push(int dx, int dy, int button)
+{
+  mouse_abs_t *m;
+
+  if (mouse_abs_len >= MOUSE_ABS_QUEUE)
+  {
+    ALERT_LOG(0, "overflowed absolute mouse queue!");
+    return;
+  }
+
+  m = &mouse_abs_q[(mouse_abs_head + mouse_abs_len) % MOUSE_ABS_QUEUE];
+  m->dx = dx;
+  m->dy = dy;
+  m->button = button;
+  mouse_abs_len++;
+}
+
+static void mouse_abs_path(int16 x, int16 y)
+{
+  int dx = x - mouse_abs_x, dy = y - mouse_abs_y, sx, sy;
+  int step = mouse_abs_step > 0 && mouse_abs_step < 127 ? mouse_abs_step : 127;
+
+  while (dx || dy)
+  {
+    sx = dx > step ? step : (dx < -step ? -step : dx);
+    sy = dy > step ? step : (dy < -step ? -step : dy);
+    mouse_abs_push(sx, sy, 0);
+    dx -= sx;
+    dy -= sy;
+  }
+
+  mouse_abs_x = x;
+  mouse_abs_y = y;
+}
+
+static void mouse_abs_event(int16 x, int16 y, int8 button)
+{
+  mouse_abs_t *m;
+
+  if (!mouse_abs_len)
+  {
+    if (!mouse_abs_read(&mouse_abs_x, &mouse_abs_y) && mouse_abs_x < 0)
+    {
+      mouse_abs_x = x;
+      mouse_abs_y = y;
+    }
+  }
+  else
+    while (mouse_abs_len) // motion that hasn't gone out yet is re-planned from where it would have ended
+    {
+      m = &mouse_abs_q[(mouse_abs_head + mouse_abs_len - 1) % MOUSE_ABS_QUEUE];
+      if (m->button)
+        break;
+      mouse_abs_x -= m->dx;
+      mouse_abs_y -= m->dy;
+      mouse_abs_len--;
+    }
+
+  mouse_abs_path(x, y);
+
+  if (button == 1 || button == -1)
+  {
+    if (last_mouse_button_state != (button == 1))
+      mouse_abs_push(0, 0, button);
+    last_mouse_button_state = (button == 1);
+  }
+
+  mouse_abs_checks = MOUSE_ABS_CHECKS;
+  DEBUG_LOG(0, "absolute mouse to %d,%d button %d, %d packets queued", x, y, button, mouse_abs_len);
+}
+
+static void mouse_abs_next(void)
+{
+  mouse_abs_t *m;
+  int16 x, y;
+
+  if (mouse_abs_sent > cpu68k_clocks)
+    mouse_abs_sent = cpu68k_clocks; // the clock was halved under us
+
+  if (!mouse_abs_len)
+  {
+    if (!mouse_abs_checks || cpu68k_clocks - mouse_abs_sent < FULL_FRAME_CYCLES)
+      return;
+
+    mouse_abs_checks--;
+    if (!mouse_abs_read(&x, &y) || (x == mouse_abs_x && y == mouse_abs_y))
+    {
+      mouse_abs_checks = 0;
+      return;
+    }
+
+    DEBUG_LOG(0, "absolute mouse landed on %d,%d instead of %d,%d, correcting", x, y, mouse_abs_x, mouse_abs_y);
+    {
+      int16 tx = mouse_abs_x, ty = mouse_abs_y;
+      mouse_abs_x = x;
+      mouse_abs_y = y;
+      mouse_abs_path(tx, ty);
+    }
+    if (!mouse_abs_len)
+      return;
+  }
+
+  m = &mouse_abs_q[mouse_abs_head];
+  mouse_abs_head = (mouse_abs_head + 1) % MOUSE_ABS_QUEUE;
+  mouse_abs_len--;
+  mouse_abs_sent = cpu68k_clocks;
+
+  if (m->button)
+  {
+    if (copsqueuelen < 0)
+      copsqueuelen = 0;
+    set_mouse_button(m->button > 0);
+    return;
+  }
+
+  mouse_pending_x = m->dx;
+  mouse_pending_y = m->dy;
+}
+
+void set_mouse_absolute(int on)
+{
+  mouse_absolute = !!on;
+  mouse_abs_head = mouse_abs_len = 0;
+  mouse_abs_x = mouse_abs_y = -1;
+  mouse_abs_checks = 0;
+  mousequeuelen = 0;
+  ALERT_LOG(0, "absolute mouse positioning %s", mouse_absolute ? "on" : "off");
+}
+
 void set_loram_clk(void)
 {
   // $1BA-1BF : Clock setting (Ey,dd,dh,hm,ms,st)
@@ -49,6 +49,9 @@
  */
 #define IN_FLOPPY_C
 #include <vars.h>
+#ifndef __MSVCRT__
+#include <pthread.h>
+#endif
 
 #ifdef DEBUG
 static int16 turn_logging_on_sector = -1, turn_logging_on_write = -1;
@@ -57,6 +60,13 @@ static int16 turn_logging_on_sector = -1, turn_logging_on_write = -1;
 // slowdown floppy access - was 7f
 #define SLOWDOWN 0x03
 
+// FDIR delay after an RWTS command.  In fast controller mode it's just long enough for the
+// 68000 to get past the instruction that wrote the gobyte.
+#define FAST_FDIR_DELAY 8
+#define RWTS_FDIR_DELAY (floppy_fast ? FAST_FDIR_DELAY : HUN_THOUSANDTH_OF_A_SEC)
+
+static int floppy_fast = 0; // not a GLOBAL so that it survives unvars() at power off, like turbo
+
 // Floppy controller macro commands
 #define FLOP_CONTROLLER 0xFCC001
 #define FLOP_CTRLR_SHAKE 0x80 // Handshake
@@ -706,6 +716,84 @@ void FloppyIRQ(uint32 delay)
     DEBUG_LOG(0, "returning from FloppyIRQ - event should not have fired now uness CPU stopped, check it please.");
 }
 
+void set_floppy_fast(int on) { floppy_fast = (on != 0); }
+int floppy_fast_mode(void) { return floppy_fast; }
+
+/*************************************************************************************\
+*  Ejected images are closed by a thread.  Closing recalculates both checksums over   *
+*  the whole image, then msync's and fsync's it, which stalls the emulator for a      *
+*  noticeable while on every disk swap of a multi-disk install.  The drive's          *
+*  DC42ImageType is copied off and cleared right away so it looks empty at once.      *
+\*************************************************************************************/
+#ifndef __MSVCRT__
+static pthread_t floppy_closer[2];
+static DC42ImageType *floppy_closing[2]; // image being closed for the upper/lower drive, or NULL
+
+static void *floppy_close_thread(void *arg)
+{
+    DC42ImageType *F = (DC42ImageType *)arg;
+
+    F->close_image(F);
+    return NULL;
+}
+#endif
+
+// wait for a pending close on drive d (0=upper, 1=lower) to finish
+static void floppy_close_wait(int d)
+{
+#ifndef __MSVCRT__
+    if (!floppy_closing[d])
+        return;
+
+    pthread_join(floppy_closer[d], NULL);
+    free(floppy_closing[d]);
+    floppy_closing[d] = NULL;
+#endif
+}
+
+// wait for all ejected images to be written back, call before quitting
+void floppy_flush(void)
+{
+    floppy_close_wait(0);
+    floppy_close_wait(1);
+}
+
+static void floppy_close(DC42ImageType *F)
+{
+#ifndef __MSVCRT__
+    int d = (F == &current_upper_floppy_image) ? 0 : 1;
+    DC42ImageType *C;
+#endif
+
+    if (!F->close_image) // ensure function pointer is valid before calling it
+        return;
+
+#ifndef __MSVCRT__
+    if (F->RAM)
+    {
+        floppy_close_wait(d);
+
+        C = (DC42ImageType *)malloc(sizeof(DC42ImageType));
+        if (C)
+        {
+            memcpy(C, F, sizeof(DC42ImageType));
+            if (!pthread_create(&floppy_closer[d], NULL, floppy_close_thread, C))
+            {
+                floppy_closing[d] = C;
+                F->RAM = NULL; // the copy owns the mapping and the file now
+                F->fd = -1;
+                F->fh = NULL;
+                return;
+            }
+            ALERT_LOG(0, "Could not start a thread to close %s, closing it now", F->fname);
+            free(C);
+        }
+    }
+#endif
+
+    F->close_image(F);
+}
+
 #ifdef JUNK
 void floppy_sec_dump(int lognum, DC42ImageType *F, int32 sectornumber, char *text)
 {
@@ -927,7 +1015,7 @@ void floppy_go6504(void)
         }
     }
 
-    if (floppy_6504_wait < 250)
+    if (floppy_6504_wait < 250 && !floppy_fast) // no wait states in fast controller mode
     {
         slowdown = ((slowdown & SLOWDOWN) ? (slowdown & SLOWDOWN) - 1 : 0);
         if (k == FLOP_CTRLR_CLIS)
@@ -1128,7 +1216,7 @@ void floppy_go6504(void)
             append_floppy_log("------------------------------------------------------------------");
             append_floppy_log(templine);
 
-            FloppyIRQ(HUN_THOUSANDTH_OF_A_SEC);
+            FloppyIRQ(RWTS_FDIR_DELAY);
             return;
 
         case FLOP_CMD_WRITX:
@@ -1199,7 +1287,7 @@ void floppy_go6504(void)
                      floppy_ram[0x1F4 + 0], floppy_ram[0x1F4 + 1], floppy_ram[0x1F4 + 2], floppy_ram[0x1F4 + 3], floppy_ram[0x1F4 + 4], floppy_ram[0x1F4 + 5],
                      floppy_ram[0x1F4 + 6], floppy_ram[0x1F4 + 7], floppy_ram[0x1F4 + 8], floppy_ram[0x1F4 + 9], floppy_ram[0x1F4 + 10], floppy_ram[0x1F4 + 11]);
 #endif
-            FloppyIRQ(HUN_THOUSANDTH_OF_A_SEC);
+            FloppyIRQ(RWTS_FDIR_DELAY);
             return;
 
         case FLOP_CMD_CLAMP: // Lisa 1 generates this command to clamp the twiggy heads onto the disk. 
@@ -1213,8 +1301,7 @@ void floppy_go6504(void)
 
         case FLOP_CMD_UCLAMP: // eject/close/unclamp disk image
             DEBUG_LOG(0, "Floppy eject queued on drive %02x \n", floppy_ram[DRIVE]);
-            if (F->close_image) // ensure function pointer is valid before calling it
-                F->close_image(F);
+            floppy_close(F);
             floppy_ram[0x20] = 0;
             RWTS_IRQ_SIGNAL(0);
             floppy_FDIR = 1;
@@ -1733,11 +1820,16 @@ void deserialize(DC42ImageType *F)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // insert_floppy
-int floppy_insert(char *Image, uint8 insert_in_upper_floppy_drive) // emulator should call this when user decides to open disk image...
+// readonly images are library copies (see floppylib.c), they were checked when they were made,
+// and writes to them stay in RAM so the same file can be shared by every instance.
+static int floppy_open(char *Image, uint8 insert_in_upper_floppy_drive, int readonly)
 {
     DC42ImageType *F = (insert_in_upper_floppy_drive) ? &current_upper_floppy_image:&current_lower_floppy_image;
     int err = 0;
 
+    if (inputlog_event(readonly ? 'L' : 'I', insert_in_upper_floppy_drive, 0, 0, Image))
+        return 0;
+
     DEBUG_LOG(0, "Inserting [%s] floppy", Image);
     DEBUG_LOG(0, "MAX RAM:%08x MINRAM:%08x TOTRAM:%08X BADRAMID:%02x SYSTEMTYPE:%02x 0=lisa1, 1=lisa2, 2=lisa2+profile 3=lisa2+widget ramchkbitmap:%04x",
               fetchlong(0x294),
@@ -1750,14 +1842,20 @@ int floppy_insert(char *Image, uint8 insert_in_upper_floppy_drive) // emulator s
     append_floppy_log("Inserting floppy:");
     append_floppy_log(Image);
 
+    floppy_close(F); // close any previously opened disk image
+
+#ifndef __MSVCRT__
+    // reopening an image that's still being written back would map it mid-checksum
+    for (int d = 0; d < 2; d++)
+        if (floppy_closing[d] && !strcmp(floppy_closing[d]->fname, Image))
+            floppy_close_wait(d);
+#endif
+
     strncpy(F->fname, Image, 255);
     // fprintf(buglog,"SRC:Opening Floppy Image file... %s\n",F->fname);
     errno = 0;
 
-    if (F->close_image) // ensure function pointer is valid before calling it
-        F->close_image(F); // close any previously opened disk image
-
-    err = dc42_auto_open(F, Image, "wb"); // for testing the emulator, open images as private "p"  w=writeable, b=best
+    err = dc42_auto_open(F, Image, readonly ? "pb" : "wb"); // for testing the emulator, open images as private "p"  w=writeable, b=best
     if (err)
     {
         ALERT_LOG(0, "could not open: %s because %s", Image, F->errormsg);
@@ -1767,7 +1865,7 @@ int floppy_insert(char *Image, uint8 insert_in_upper_floppy_drive) // emulator s
         return -1;
     }
 
-    err = dc42_check_checksums(F); // 0 if they match, 1 if tags, 2 if data, 3 if both don't match
+    err = readonly ? 0 : dc42_check_checksums(F); // 0 if they match, 1 if tags, 2 if data, 3 if both don't match
     switch (err)
     {
     case 1:
@@ -1841,6 +1939,16 @@ int floppy_insert(char *Image, uint8 insert_in_upper_floppy_drive) // emulator s
     return 0;
 }
 
+int floppy_insert(char *Image, uint8 insert_in_upper_floppy_drive) // emulator should call this when user decides to open disk image...
+{
+    return floppy_open(Image, insert_in_upper_floppy_drive, 0);
+}
+
+int floppy_insert_readonly(char *Image, uint8 insert_in_upper_floppy_drive)
+{
+    return floppy_open(Image, insert_in_upper_floppy_drive, 1);
+}
+
 // Set IRQ upon RWTS completion. Won't fire any IRQ if the interrupt mask isn't right.
 void RWTS_IRQ_SIGNAL(uint8 status) {
     if (floppy_ram[DRIVE] == 0x00)
@@ -1864,7 +1972,7 @@ void RWTS_IRQ_SIGNAL(uint8 status) {
     {
         DEBUG_LOG(0, "Will be Firing IRQ1 after delay since INTSTAT is %02x & INTMASK is %02x, 2e is :%02x\n",
                   floppy_ram[FLOP_INT_STAT], floppy_ram[FLOP_INT_MASK], floppy_ram[0x2e]);
-        FloppyIRQ(HUN_THOUSANDTH_OF_A_SEC);
+        FloppyIRQ(RWTS_FDIR_DELAY);
     }
     else
     {
@@ -1901,6 +2009,9 @@ void fix_intstat_if_needed()
  */
 void floppy_eject_button_pressed(uint8 on_upper_floppy_drive)
 {
+    if (inputlog_event('E', on_upper_floppy_drive, 0, 0, NULL))
+        return;
+
     if (on_upper_floppy_drive) 
     {
         floppy_ram[FLOP_INT_STAT] |= FLOP_IRQ_SRC_BTN1;
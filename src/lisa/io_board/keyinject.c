@@ -0,0 +1,555 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*  Scripted keyboard input: paste, type_text(), press_combo() and --type.              *
+*                                                                                      *
+*  Rather than stuffing whole keystrokes into the COPS queue from a host timer, key    *
+*  codes are handed to the COPS one at a time on the 68K's clock.  The next one goes   *
+*  out a key gap after the Lisa has read the last one (via1_ira), so typing runs as    *
+*  fast as the keyboard driver takes it, and never faster.  After a Return there's a   *
+*  longer line gap, so whatever is reading the lines gets a chance to keep up.         *
+*                                                                                      *
+*  keyinject_due is the 68K cycle the next code may go out at, it's folded into the    *
+*  COPS timer by SET_COPS_NEXT_EVENT, whose handler in irq.c calls keyinject_tick().   *
+*                                                                                      *
+*  Scripts can also hold the rest of the queue until the screen shows something, see   *
+*  screenhash.c.  Those waits are checked once a frame from the same timer, so the     *
+*  Lisa carries on as usual meanwhile, at whatever speed it's running.                 *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_KEYINJECT_C
+#include <vars.h>
+#include <keyscan.h>
+
+#define KEYINJECT_KEY_GAP KBCOPSCYCLES
+#define KEYINJECT_LINE_GAP TENTH_OF_A_SECOND
+#define KEYINJECT_MAXDIRECTIVE 1024
+#define KEYINJECT_SCREEN_TIMEOUT 60 // seconds of Lisa time a screen wait gives up after by default
+
+#define KEYCODE_SHIFT_DOWN (KEYCODE_SHIFT | KEY_DOWN)
+#define KEYCODE_COMMAND_DOWN (KEYCODE_COMMAND | KEY_DOWN)
+#define KEYCODE_OPTION_DOWN (KEYCODE_OPTION | KEY_DOWN)
+
+extern char keydecodetable[256][11]; // keytable.h, by way of cops.c
+
+typedef struct
+{
+  int16 code; // COPS key code, -1 for a pause, -2 to insert a disk of the --disks set, -3 for a screen wait
+  XTIMER gap; // how long to wait after the Lisa reads it, how long to pause, the disk number or screens[] index
+} keyinject_t;
+
+enum
+{
+  SCREEN_HASH,     // {waitscreen}, the region's exact hash
+  SCREEN_PHASH,    // {waitlike}, its average hash, within maxdiff bits
+  SCREEN_TEMPLATE, // {waitimage}, a PBM anywhere in the region, within maxdiff pixels
+  SCREEN_SHOW      // {hashscreen}, just log the region's hashes
+};
+
+typedef struct
+{
+  int kind, x, y, w, h;
+  uint64 hash;
+  int maxdiff;
+  uint8 *bits; // the template, and its size
+  int tw, th, stride;
+  XTIMER timeout;  // 0 waits forever
+  XTIMER deadline; // -1 until the wait reaches the head of the queue
+} keyinject_screen_t;
+
+static keyinject_t *keys = NULL;
+static uint32 keys_head = 0, keys_len = 0, keys_size = 0;
+static XTIMER key_gap = KEYINJECT_KEY_GAP, line_gap = KEYINJECT_LINE_GAP;
+static XTIMER drained_gap = 0; // gap that goes with the code being read right now
+static keyinject_screen_t *screens = NULL;
+static uint32 screens_len = 0, screens_size = 0;
+
+static const struct
+{
+  const char *name;
+  uint8 code;
+} keynames[] = {
+    {"return", KEYCODE_RETURN},
+    {"enter", KEYCODE_LENTER},
+    {"numenter", KEYCODE_ENTERNUM},
+    {"tab", KEYCODE_TAB},
+    {"backspace", KEYCODE_BACKSPACE},
+    {"space", KEYCODE_SPACE},
+    {"clear", KEYCODE_CLEAR},
+    {"left", KEYCODE_CURSORL},
+    {"right", KEYCODE_CURSORR},
+    {"up", KEYCODE_CURSORU},
+    {"down", KEYCODE_CURSORD},
+    {"capslock", KEYCODE_CAPSLOCK},
+    {"plus", KEYCODE_PLUS},
+    {"minus", KEYCODE_MINUS},
+};
+
+static int add(int16 code, XTIMER gap)
+{
+  if (keys_head && keys_head == keys_len) // all sent, start over at the front
+    keys_head = keys_len = 0;
+
+  if (keys_len == keys_size)
+  {
+    uint32 size = keys_size ? keys_size * 2 : 4096;
+    keyinject_t *k = (keyinject_t *)realloc(keys, size * sizeof(keyinject_t));
+
+    if (!k)
+    {
+      ALERT_LOG(0, "Out of memory queueing keystrokes");
+      return -1;
+    }
+    keys = k;
+    keys_size = size;
+  }
+  keys[keys_len].code = code;
+  keys[keys_len].gap = gap;
+  keys_len++;
+  return 0;
+}
+
+// Something was queued, get the COPS timer going if it's idle.
+static void arm(void)
+{
+  if (keyinject_due < 0 && !keyinject_draining && keys_head < keys_len)
+  {
+    keyinject_due = cpu68k_clocks;
+    SET_COPS_NEXT_EVENT(0);
+  }
+}
+
+// Live host input is ignored while replaying an input log, and so is this.
+static int refused(void)
+{
+  if (!inputlog_replaying())
+    return 0;
+  ALERT_LOG(0, "Ignoring scripted keys while replaying an input log");
+  return 1;
+}
+
+int keyinject_busy(void) { return keyinject_draining || keys_head < keys_len; }
+
+void keyinject_cancel(void)
+{
+  keys_head = keys_len = 0;
+  keyinject_due = -1;
+  keyinject_draining = 0;
+}
+
+void keyinject_set_pacing(XTIMER kgap, XTIMER lgap)
+{
+  if (kgap >= 0)
+    key_gap = kgap;
+  if (lgap >= 0)
+    line_gap = lgap;
+}
+
+void keyinject_pause(XTIMER cycles)
+{
+  if (refused() || add(-1, cycles))
+    return;
+  arm();
+}
+
+// Queue the key codes for one host character, as keystroke_cops() would send them.
+static int add_char(uint8 c)
+{
+  int j, len;
+
+  for (len = -1, j = 0; j < 9; j++)
+    if (keydecodetable[c][j])
+      len = j;
+  if (len < 0)
+    return -1;
+
+  for (j = 0; j <= len; j++)
+    if (keydecodetable[c][j] && add((uint8)keydecodetable[c][j], key_gap))
+      return -1;
+
+  if (c == '\r' || c == '\n')
+    keys[keys_len - 1].gap = line_gap;
+  return 0;
+}
+
+// Type a string, returns how many characters were queued.  CR LF is a single Return,
+// characters the keyboard can't type are skipped.
+int type_text(char *text)
+{
+  int n = 0;
+  uint8 *s = (uint8 *)text;
+
+  if (refused() || !s)
+    return -1;
+
+  for (; *s; s++)
+  {
+    if (*s == '\n' && s > (uint8 *)text && s[-1] == '\r')
+      continue;
+    if (!add_char(*s))
+      n++;
+    else
+    {
+      DEBUG_LOG(0, "Can't type %02x, skipping it", *s);
+    }
+  }
+  arm();
+  return n;
+}
+
+// The key that types c, and whether it needs shift to do so.
+static int char_keycode(uint8 c, int *shift)
+{
+  int j;
+
+  *shift = 0;
+  for (j = 0; j < 9; j++)
+  {
+    uint8 k = (uint8)keydecodetable[c][j];
+
+    if (k == KEYCODE_SHIFT_DOWN)
+      *shift = 1;
+    else if ((k & KEY_DOWN) && k != KEYCODE_COMMAND_DOWN && k != KEYCODE_OPTION_DOWN)
+      return k & 0x7f;
+  }
+  return -1;
+}
+
+// Press and release a key with modifiers, i.e. "cmd-shift-q", "apple+.", "option-return".
+// Modifiers are cmd/command/apple, shift and option/opt/alt, separated by - or +, then either
+// a single character or one of the key names above.
+int press_combo(char *combo)
+{
+  static const struct
+  {
+    const char *name;
+    uint8 code;
+  } mods[] = {{"cmd", KEYCODE_COMMAND}, {"command", KEYCODE_COMMAND}, {"apple", KEYCODE_COMMAND},
+              {"shift", KEYCODE_SHIFT}, {"option", KEYCODE_OPTION}, {"opt", KEYCODE_OPTION},
+              {"alt", KEYCODE_OPTION}};
+  uint8 down[4];
+  int ndown = 0, key = -1, shift = 0, i, j;
+  char *s = combo;
+
+  if (refused() || !s)
+    return -1;
+
+  for (;;) // modifiers
+  {
+    for (i = 0; i < (int)(sizeof(mods) / sizeof(mods[0])); i++)
+    {
+      size_t len = strlen(mods[i].name);
+      if (!strncasecmp(s, mods[i].name, len) && (s[len] == '-' || s[len] == '+') && s[len + 1])
+        break;
+    }
+    if (i == (int)(sizeof(mods) / sizeof(mods[0])))
+      break;
+    for (j = 0; j < ndown && down[j] != mods[i].code; j++)
+      ;
+    if (j == ndown && ndown < 3)
+      down[ndown++] = mods[i].code;
+    s += strlen(mods[i].name) + 1;
+  }
+
+  if (s[0] && !s[1])
+    key = char_keycode((uint8)s[0], &shift);
+  else
+    for (i = 0; i < (int)(sizeof(keynames) / sizeof(keynames[0])); i++)
+      if (!strcasecmp(s, keynames[i].name))
+        key = keynames[i].code;
+
+  if (key < 0)
+  {
+    ALERT_LOG(0, "Don't know how to press %s", combo);
+    return -1;
+  }
+
+  if (shift) // i.e. cmd-? is cmd-shift-/
+  {
+    for (j = 0; j < ndown && down[j] != KEYCODE_SHIFT; j++)
+      ;
+    if (j == ndown)
+      down[ndown++] = KEYCODE_SHIFT;
+  }
+
+  for (j = 0; j < ndown; j++)
+    add(down[j] | KEY_DOWN, key_gap);
+  add(key | KEY_DOWN, key_gap);
+  add(key | KEY_UP, (key == KEYCODE_RETURN && !ndown) ? line_gap : key_gap);
+  for (j = ndown - 1; j >= 0; j--)
+    add(down[j] | KEY_UP, key_gap);
+
+  arm();
+  return 0;
+}
+
+// Queue a screen wait or {hashscreen} from a script directive, returns -1 if it doesn't parse.
+static int add_screen(int kind, char *args)
+{
+  keyinject_screen_t *w;
+  char file[KEYINJECT_MAXDIRECTIVE];
+  unsigned long long hash = 0;
+  double secs = KEYINJECT_SCREEN_TIMEOUT;
+  int n, i;
+
+  if (!keys_len) // nothing left queued, so nothing refers to the old ones
+  {
+    for (i = 0; i < (int)screens_len; i++)
+      free(screens[i].bits);
+    screens_len = 0;
+  }
+  if (screens_len == screens_size)
+  {
+    uint32 size = screens_size ? screens_size * 2 : 16;
+    keyinject_screen_t *s = (keyinject_screen_t *)realloc(screens, size * sizeof(keyinject_screen_t));
+
+    if (!s)
+    {
+      ALERT_LOG(0, "Out of memory queueing a screen wait");
+      return -1;
+    }
+    screens = s;
+    screens_size = size;
+  }
+
+  w = &screens[screens_len];
+  memset(w, 0, sizeof(keyinject_screen_t));
+  w->kind = kind;
+  switch (kind)
+  {
+  case SCREEN_HASH:
+    n = sscanf(args, "%d %d %d %d %llx %lf", &w->x, &w->y, &w->w, &w->h, &hash, &secs);
+    n = (n >= 5);
+    break;
+  case SCREEN_PHASH:
+    n = sscanf(args, "%d %d %d %d %llx %d %lf", &w->x, &w->y, &w->w, &w->h, &hash, &w->maxdiff, &secs);
+    n = (n >= 6);
+    break;
+  case SCREEN_TEMPLATE:
+    n = sscanf(args, "%1023s %d %d %d %d %d %lf", file, &w->x, &w->y, &w->w, &w->h, &w->maxdiff, &secs);
+    n = (n >= 6 && (w->bits = screen_load_template(file, &w->tw, &w->th, &w->stride)) != NULL);
+    break;
+  default:
+    n = (sscanf(args, "%d %d %d %d", &w->x, &w->y, &w->w, &w->h) == 4);
+  }
+  if (!n)
+  {
+    fprintf(stderr, "Can't make sense of the screen wait \"%s\"\n", args);
+    return -1;
+  }
+  w->hash = (uint64)hash;
+  w->timeout = (XTIMER)(secs * ONE_SECOND);
+  w->deadline = -1;
+
+  if (add(-3, screens_len))
+  {
+    free(w->bits);
+    return -1;
+  }
+  screens_len++;
+  arm();
+  return 0;
+}
+
+// Does the screen show what w is waiting for yet?  A {hashscreen} always does, once it has been logged.
+static int screen_matches(keyinject_screen_t *w)
+{
+  switch (w->kind)
+  {
+  case SCREEN_HASH:
+    return screen_region_hash(w->x, w->y, w->w, w->h) == (uint32)w->hash;
+  case SCREEN_PHASH:
+    return screen_phash_distance(screen_region_phash(w->x, w->y, w->w, w->h), w->hash) <= w->maxdiff;
+  case SCREEN_TEMPLATE:
+    return screen_find_template(w->x, w->y, w->w, w->h, w->tw, w->th, w->bits, w->stride, w->maxdiff, NULL, NULL) >= 0;
+  }
+  // on stderr rather than the debug log, so it's there in release builds for writing scripts with
+  fprintf(stderr, "Screen %d,%d %dx%d: {waitscreen %d %d %d %d %08x} {waitlike %d %d %d %d %016llx 4}\n", w->x, w->y,
+          w->w, w->h, w->x, w->y, w->w, w->h, screen_region_hash(w->x, w->y, w->w, w->h), w->x, w->y, w->w, w->h,
+          (unsigned long long)screen_region_phash(w->x, w->y, w->w, w->h));
+  return 1;
+}
+
+// Type a script: text, with \n \r \t \\ and \{ escapes, {combo} for press_combo(),
+// {wait seconds} for a pause of that many seconds of Lisa time, and {disk n} to put disk n
+// of the --disks set in the drive once everything before it has been typed and the Lisa has
+// ejected the disk that was in it.  For --type.
+//
+// The rest of the script can wait for the screen, with a region given as x y w h in pixels
+// and an optional timeout in seconds of Lisa time at the end (default 60, 0 waits forever):
+//   {waitscreen x y w h hash [secs]}            until the region's exact hash matches
+//   {waitlike x y w h phash bits [secs]}        until its average hash is at most bits off
+//   {waitimage file.pbm x y w h pixels [secs]}  until the PBM is in it, at most pixels off
+// {hashscreen x y w h} logs both hashes of a region as it is then, ready to paste in.  If a wait
+// times out whatever is still queued is thrown away, it'd only be typed into the wrong thing.
+int keyinject_script(char *script)
+{
+  char text[1024], combo[KEYINJECT_MAXDIRECTIVE];
+  char *s = script;
+  int n = 0, t = 0;
+
+  if (refused() || !s)
+    return -1;
+
+  while (*s)
+  {
+    if (*s == '\\' && s[1])
+    {
+      s++;
+      text[t++] = (*s == 'n') ? '\r' : (*s == 'r') ? '\r' : (*s == 't') ? '\t' : *s;
+      s++;
+    }
+    else if (*s == '{' && strchr(s, '}'))
+    {
+      char *e = strchr(s, '}');
+      int len = (int)MIN(e - s - 1, KEYINJECT_MAXDIRECTIVE - 1);
+
+      text[t] = 0;
+      if (t)
+        n += type_text(text);
+      t = 0;
+
+      memcpy(combo, s + 1, len);
+      combo[len] = 0;
+      if (!strncasecmp(combo, "wait ", 5))
+        keyinject_pause((XTIMER)(atof(combo + 5) * ONE_SECOND));
+      else if (!strncasecmp(combo, "disk ", 5))
+      {
+        if (!add(-2, atoi(combo + 5)))
+          arm();
+      }
+      else if (!strncasecmp(combo, "waitscreen ", 11) || !strncasecmp(combo, "waitlike ", 9) ||
+               !strncasecmp(combo, "waitimage ", 10) || !strncasecmp(combo, "hashscreen ", 11))
+      {
+        int kind = (combo[0] == 'h' || combo[0] == 'H') ? SCREEN_SHOW
+                   : (combo[4] == 's' || combo[4] == 'S') ? SCREEN_HASH
+                   : (combo[4] == 'l' || combo[4] == 'L') ? SCREEN_PHASH
+                                                          : SCREEN_TEMPLATE;
+
+        if (add_screen(kind, strchr(combo, ' ') + 1))
+        {
+          fprintf(stderr, "Not typing the rest of the script, it'd go to the wrong place without the wait\n");
+          return n;
+        }
+      }
+      else if (!press_combo(combo))
+        n++;
+      s = e + 1;
+    }
+    else
+      text[t++] = *s++;
+
+    if (t >= (int)sizeof(text) - 2)
+    {
+      text[t] = 0;
+      n += type_text(text);
+      t = 0;
+    }
+  }
+  text[t] = 0;
+  if (t)
+    n += type_text(text);
+  return n;
+}
+
+// From the COPS timer in irq.c, once keyinject_due has come around.  Hands the next code to
+// the COPS if it's got nothing else to send, otherwise waits for the Lisa to read that first.
+void keyinject_tick(void)
+{
+  keyinject_due = -1;
+
+  while (keys_head < keys_len && !keyinject_draining)
+  {
+    keyinject_t *k = &keys[keys_head];
+
+    if (k->code == -2)
+    {
+      if (!floppylib_drive_empty()) // the Lisa hasn't ejected the last disk yet, look again later
+      {
+        keyinject_due = cpu68k_clocks + TENTH_OF_A_SECOND;
+        return;
+      }
+      keys_head++;
+      floppylib_insert_disk((int)k->gap);
+      continue;
+    }
+    if (k->code == -3)
+    {
+      keyinject_screen_t *w = &screens[k->gap];
+
+      if (w->deadline < 0)
+        w->deadline = w->timeout ? cpu68k_clocks + w->timeout : 0;
+      if (!screen_matches(w))
+      {
+        if (w->deadline && cpu68k_clocks >= w->deadline)
+        {
+          fprintf(stderr, "Gave up waiting for the screen at %d,%d %dx%d, dropping the rest of the script\n", w->x,
+                  w->y, w->w, w->h);
+          keys_head = keys_len = 0;
+          return;
+        }
+        keyinject_due = cpu68k_clocks + FULL_FRAME_CYCLES; // look again next frame
+        return;
+      }
+      keys_head++;
+      continue;
+    }
+    if (k->code < 0)
+    {
+      keys_head++;
+      keyinject_due = cpu68k_clocks + k->gap;
+      return;
+    }
+    if (copsqueuelen)
+    {
+      keyinject_due = cpu68k_clocks + KBCOPSCYCLES; // the Lisa is still reading something else
+      return;
+    }
+
+    keys_head++;
+    drained_gap = k->gap;
+    keyinject_draining = 1;
+    send_cops_keycode(k->code);
+  }
+
+  if (keys_head == keys_len && !keyinject_draining)
+    keys_head = keys_len = 0;
+}
+
+// The Lisa read the last code we sent (or the COPS was reset), the next one can go out a gap later.
+void keyinject_drained(void)
+{
+  if (!keyinject_draining)
+    return;
+  keyinject_draining = 0;
+  if (keys_head < keys_len)
+  {
+    keyinject_due = cpu68k_clocks + drained_gap;
+    SET_COPS_NEXT_EVENT(0);
+  }
+  else
+    keys_head = keys_len = 0;
+}
@@ -0,0 +1,596 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*                     Z8530 SCC host I/O thread for the telnetd,                       *
+*                     pty, shell and tty serial port backends                          *
+*                                                                                      *
+*  The backends used to poll() or select() and read() one byte every time the Lisa     *
+*  looked at RR0, and the pty write path could block the whole emulator.  Now their    *
+*  descriptors are handed to a single I/O thread (epoll on Linux, poll elsewhere)      *
+*  that reads whatever the host has in large chunks into a per port receive ring and   *
+*  writes the transmit ring out the same way.  The emulation side only ever touches    *
+*  the rings, which are single producer/single consumer, so it doesn't lock or make a  *
+*  system call on the serial hot path.  It only pokes the thread's wake up pipe when   *
+*  the thread has gone to sleep with nothing to send.                                  *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_Z8530_IOTHREAD_C
+#include <vars.h>
+
+#ifndef __MSVCRT__
+
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#define SCC_IO_PORTS 2
+#define SCC_IO_RING 65536 // power of 2
+#define SCC_IO_CHUNK 4096
+#define SCC_IO_LINGER_MS 50 // keep polling the tx ring this long after the last byte before sleeping
+#define SCC_IO_RETRY_MS 100 // how often to look at a hung up pty or a full rx ring again
+
+// telnet protocol
+#define IAC 0xff
+#define TELNET_SB 0xfa
+#define TELNET_SE 0xf0
+#define TELNET_WILL 0xfb
+#define TELNET_DONT 0xfe
+
+enum
+{
+  TN_DATA,
+  TN_IAC,
+  TN_OPTION,
+  TN_SB,
+  TN_SB_IAC
+};
+
+typedef struct
+{
+  uint8 rx[SCC_IO_RING], tx[SCC_IO_RING];
+  uint32 rx_head, rx_tail; // head is written by the producer, tail by the consumer
+  uint32 tx_head, tx_tail;
+
+  int kind;       // SCC_IO_NONE, SCC_IO_STREAM, SCC_IO_TELNETD
+  int fd;         // the stream, or the connected telnet client, -1 if none
+  int listenfd;   // telnetd listening socket
+  int watched;    // POLLIN/POLLOUT currently registered for fd / listenfd (same bits as EPOLLIN/OUT)
+  int64 hungup;   // pty with nobody on the other end, leave it alone until this time
+  int telnet;     // telnet parser state
+  uint32 tx_dropped; // bytes the Lisa sent while the tx ring was full
+} scc_io_port_t;
+
+static scc_io_port_t *sccio[SCC_IO_PORTS];
+static pthread_t sccio_thread;
+static int sccio_running = 0;
+static int sccio_wake[2] = {-1, -1};
+static int sccio_awake = 0; // the thread is polling with a short timeout, no need to wake it
+static pthread_mutex_t sccio_lock = PTHREAD_MUTEX_INITIALIZER;
+#ifdef __linux__
+static int sccio_epoll = -1;
+#endif
+
+// telnet options we send to a new client: WILL ECHO, WILL SUPPRESS-GO-AHEAD, DO 0xf3
+static const uint8 telnethax[] = {0xff, 0xfb, 0x01, 0xff, 0xfb, 0x03, 0xff, 0xfd, 0x0f3};
+
+static int64 now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline uint32 ring_load(uint32 *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static inline void ring_store(uint32 *p, uint32 v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+static void rx_put(scc_io_port_t *p, uint8 c)
+{
+  uint32 head = p->rx_head;
+
+  if (head - ring_load(&p->rx_tail) >= SCC_IO_RING) // can't happen, reads are limited to the free space
+    return;
+  p->rx[head & (SCC_IO_RING - 1)] = c;
+  ring_store(&p->rx_head, head + 1);
+}
+
+static uint32 rx_room(scc_io_port_t *p) { return SCC_IO_RING - (p->rx_head - ring_load(&p->rx_tail)); }
+static uint32 tx_pending(scc_io_port_t *p) { return ring_load(&p->tx_head) - p->tx_tail; }
+
+// Strip telnet commands out of what the client sent, same mapping as the old per byte reader used.
+static void telnet_input(scc_io_port_t *p, uint8 *buf, int len)
+{
+  int i;
+
+  for (i = 0; i < len; i++)
+  {
+    uint8 c = buf[i];
+
+    switch (p->telnet)
+    {
+    case TN_DATA:
+      if (c == IAC)
+        p->telnet = TN_IAC;
+      else
+        rx_put(p, c);
+      break;
+
+    case TN_IAC:
+      p->telnet = TN_DATA;
+      if (c >= TELNET_WILL && c <= TELNET_DONT)
+        p->telnet = TN_OPTION;
+      else if (c == TELNET_SB)
+        p->telnet = TN_SB;
+      else if (c == IAC || c == 0x00) // escaped 0xff, sync
+        rx_put(p, 0xff);
+      else if (c == 0xee || c == 0xf4 || c == 0xf5) // abort, interrupt process, abort output
+        rx_put(p, 3);
+      else if (c == 0xf7) // erase character
+        rx_put(p, 8);
+      break; // break, nop, eor, go ahead, erase line, are you there are dropped
+
+    case TN_OPTION:
+      p->telnet = TN_DATA;
+      break;
+
+    case TN_SB:
+      if (c == IAC)
+        p->telnet = TN_SB_IAC;
+      break;
+
+    case TN_SB_IAC:
+      p->telnet = (c == TELNET_SE) ? TN_DATA : TN_SB;
+      break;
+    }
+  }
+}
+
+static void watch(int fd, int events, int old)
+{
+#ifdef __linux__
+  struct epoll_event ev;
+
+  if (!old && !events)
+    return;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.fd = fd;
+  if (!old)
+    epoll_ctl(sccio_epoll, EPOLL_CTL_ADD, fd, &ev);
+  else if (!events)
+    epoll_ctl(sccio_epoll, EPOLL_CTL_DEL, fd, &ev);
+  else
+    epoll_ctl(sccio_epoll, EPOLL_CTL_MOD, fd, &ev);
+#else
+  (void)fd;
+  (void)events;
+  (void)old;
+#endif
+}
+
+// Work out what each port wants to hear about: input when there's room for it, output when
+// there's something to send, a new connection when telnetd has no client.
+static int update_watches(int64 now)
+{
+  int port, timeout = -1;
+
+  for (port = 0; port < SCC_IO_PORTS; port++)
+  {
+    scc_io_port_t *p = sccio[port];
+    int fd, events = 0;
+
+    if (!p || p->kind == SCC_IO_NONE)
+      continue;
+
+    if (p->fd >= 0)
+    {
+      fd = p->fd;
+      if (p->hungup && now >= p->hungup)
+        p->hungup = 0; // try the pty again
+      if (p->hungup)
+      {
+        timeout = SCC_IO_RETRY_MS;
+        p->tx_tail = ring_load(&p->tx_head); // nobody's listening
+      }
+      else if (rx_room(p) >= SCC_IO_CHUNK)
+        events |= POLLIN;
+      else
+        timeout = SCC_IO_RETRY_MS; // wait for the Lisa to catch up
+      if (tx_pending(p) && !p->hungup)
+        events |= POLLOUT;
+    }
+    else
+    {
+      fd = p->listenfd;
+      events = POLLIN;
+      if (tx_pending(p)) // nobody's listening
+        p->tx_tail = ring_load(&p->tx_head);
+    }
+
+    if (events != p->watched)
+    {
+      watch(fd, events, p->watched);
+      p->watched = events;
+    }
+  }
+  return timeout;
+}
+
+static void port_input(scc_io_port_t *p)
+{
+  uint8 buf[SCC_IO_CHUNK];
+  ssize_t n;
+  uint32 room = rx_room(p);
+
+  n = read(p->fd, buf, MIN(room, (uint32)sizeof(buf)));
+  if (n > 0)
+  {
+    if (p->kind == SCC_IO_TELNETD)
+      telnet_input(p, buf, (int)n);
+    else
+    {
+      uint32 head = p->rx_head, i;
+
+      for (i = 0; i < (uint32)n; i++)
+        p->rx[(head + i) & (SCC_IO_RING - 1)] = buf[i];
+      ring_store(&p->rx_head, head + (uint32)n);
+    }
+    return;
+  }
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return;
+
+  if (p->kind == SCC_IO_TELNETD) // client went away, back to listening
+  {
+    ALERT_LOG(0, "telnet client disconnected");
+    watch(p->fd, 0, p->watched);
+    p->watched = 0;
+    close(p->fd);
+    p->fd = -1;
+    return;
+  }
+  // a pty master reads EIO while nothing has the slave open, don't spin on it
+  watch(p->fd, 0, p->watched);
+  p->watched = 0;
+  p->hungup = now_ms() + SCC_IO_RETRY_MS;
+}
+
+static void port_output(scc_io_port_t *p)
+{
+  uint32 tail = p->tx_tail, len = tx_pending(p);
+  ssize_t n;
+
+  len = MIN(len, SCC_IO_RING - (tail & (SCC_IO_RING - 1))); // up to the end of the ring
+  n = write(p->fd, &p->tx[tail & (SCC_IO_RING - 1)], len);
+  if (n > 0)
+    ring_store(&p->tx_tail, tail + (uint32)n);
+}
+
+static void port_accept(scc_io_port_t *p, int port)
+{
+  struct sockaddr_in client;
+  socklen_t clientlen = sizeof(client);
+  int fd = accept(p->listenfd, (struct sockaddr *)&client, &clientlen);
+
+  if (fd < 0)
+    return;
+  ALERT_LOG(0, "Serial Port #%d Client connected:%s\n", port, inet_ntoa(client.sin_addr));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  if (send(fd, telnethax, sizeof(telnethax), 0) < 0)
+    ALERT_LOG(0, "could not send telnet options to client on port %d", port);
+
+  watch(p->listenfd, 0, p->watched);
+  p->watched = 0;
+  p->telnet = TN_DATA;
+  p->fd = fd;
+}
+
+static void service(int fd, int events)
+{
+  int port;
+
+  for (port = 0; port < SCC_IO_PORTS; port++)
+  {
+    scc_io_port_t *p = sccio[port];
+
+    if (!p || p->kind == SCC_IO_NONE)
+      continue;
+    if (p->fd < 0 && fd == p->listenfd)
+      port_accept(p, port);
+    else if (fd == p->fd)
+    {
+      if (events & (POLLIN | POLLHUP | POLLERR))
+        port_input(p);
+      if ((events & POLLOUT) && p->fd >= 0 && !p->hungup)
+        port_output(p);
+    }
+  }
+}
+
+static void *sccio_main(void *arg)
+{
+  int64 lastbusy = now_ms();
+  (void)arg;
+
+  for (;;)
+  {
+    int timeout, n, i, port, busy = 0;
+    int64 now = now_ms();
+    uint8 junk[64];
+
+    pthread_mutex_lock(&sccio_lock);
+    for (port = 0; port < SCC_IO_PORTS; port++)
+      if (sccio[port] && tx_pending(sccio[port]))
+        busy = 1;
+    timeout = update_watches(now);
+    pthread_mutex_unlock(&sccio_lock);
+
+    // While the Lisa is sending, poll the tx ring every ms rather than have it wake us up for
+    // every byte.  Once it's been quiet for a while go to sleep and let scc_io_putc() wake us.
+    if (busy)
+      lastbusy = now;
+    if (now - lastbusy < SCC_IO_LINGER_MS)
+      timeout = (timeout < 0 || timeout > 1) ? 1 : timeout;
+    else if (__atomic_load_n(&sccio_awake, __ATOMIC_SEQ_CST))
+    {
+      __atomic_store_n(&sccio_awake, 0, __ATOMIC_SEQ_CST);
+      for (port = 0; port < SCC_IO_PORTS; port++) // raced with a putc that saw us awake?
+        if (sccio[port] && tx_pending(sccio[port]))
+          __atomic_store_n(&sccio_awake, 1, __ATOMIC_SEQ_CST);
+      if (__atomic_load_n(&sccio_awake, __ATOMIC_SEQ_CST))
+        continue;
+    }
+
+#ifdef __linux__
+    {
+      struct epoll_event ev[8];
+
+      n = epoll_wait(sccio_epoll, ev, 8, timeout);
+      pthread_mutex_lock(&sccio_lock);
+      for (i = 0; i < n; i++)
+        if (ev[i].data.fd == sccio_wake[0])
+        {
+          while (read(sccio_wake[0], junk, sizeof(junk)) > 0)
+            ;
+          lastbusy = now_ms();
+        }
+        else
+          service(ev[i].data.fd, ev[i].events);
+      pthread_mutex_unlock(&sccio_lock);
+    }
+#else
+    {
+      struct pollfd pfd[SCC_IO_PORTS + 1];
+      int nfds = 1;
+
+      pfd[0].fd = sccio_wake[0];
+      pfd[0].events = POLLIN;
+      pthread_mutex_lock(&sccio_lock);
+      for (port = 0; port < SCC_IO_PORTS; port++)
+        if (sccio[port] && sccio[port]->watched)
+        {
+          pfd[nfds].fd = (sccio[port]->fd >= 0) ? sccio[port]->fd : sccio[port]->listenfd;
+          pfd[nfds].events = sccio[port]->watched;
+          nfds++;
+        }
+      pthread_mutex_unlock(&sccio_lock);
+
+      n = poll(pfd, nfds, timeout);
+      pthread_mutex_lock(&sccio_lock);
+      if (n > 0 && pfd[0].revents)
+      {
+        while (read(sccio_wake[0], junk, sizeof(junk)) > 0)
+          ;
+        lastbusy = now_ms();
+      }
+      for (i = 1; n > 0 && i < nfds; i++)
+        if (pfd[i].revents)
+          service(pfd[i].fd, pfd[i].revents);
+      pthread_mutex_unlock(&sccio_lock);
+    }
+#endif
+  }
+  return NULL;
+}
+
+static int sccio_start(void)
+{
+  if (sccio_running)
+    return 0;
+
+  if (pipe(sccio_wake) < 0)
+    return -1;
+  fcntl(sccio_wake[0], F_SETFL, O_NONBLOCK);
+  fcntl(sccio_wake[1], F_SETFL, O_NONBLOCK);
+#ifdef __linux__
+  sccio_epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (sccio_epoll < 0)
+    return -1;
+  watch(sccio_wake[0], POLLIN, 0);
+#endif
+
+  sccio_awake = 1;
+  if (pthread_create(&sccio_thread, NULL, sccio_main, NULL))
+  {
+    ALERT_LOG(0, "Could not start the serial I/O thread: %s", strerror(errno));
+    return -1;
+  }
+  pthread_detach(sccio_thread);
+  sccio_running = 1;
+  return 0;
+}
+
+// Hand a host descriptor over to the I/O thread.  For SCC_IO_TELNETD fd is the listening socket.
+int scc_io_attach(int port, int fd, int kind)
+{
+  scc_io_port_t *p;
+
+  if (port < 0 || port >= SCC_IO_PORTS || fd < 0)
+    return -1;
+  scc_io_detach(port);
+
+  p = sccio[port];
+  if (!p && !(p = (scc_io_port_t *)calloc(1, sizeof(scc_io_port_t))))
+    return -1;
+
+  pthread_mutex_lock(&sccio_lock);
+  p->rx_head = p->rx_tail = p->tx_head = p->tx_tail = 0;
+  p->watched = p->hungup = 0;
+  p->tx_dropped = 0;
+  p->telnet = TN_DATA;
+  p->kind = kind;
+  p->fd = (kind == SCC_IO_TELNETD) ? -1 : fd;
+  p->listenfd = (kind == SCC_IO_TELNETD) ? fd : -1;
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  sccio[port] = p;
+  pthread_mutex_unlock(&sccio_lock);
+
+  if (sccio_start() < 0)
+  {
+    p->kind = SCC_IO_NONE;
+    return -1;
+  }
+  scc_io_kick();
+  return 0;
+}
+
+// Take the port's descriptors away from the thread, the caller still owns and closes them,
+// except for a connected telnet client which is ours.
+void scc_io_detach(int port)
+{
+  scc_io_port_t *p;
+
+  if (port < 0 || port >= SCC_IO_PORTS || !(p = sccio[port]) || p->kind == SCC_IO_NONE)
+    return;
+
+  if (p->tx_dropped)
+    ALERT_LOG(0, "serial port %d lost %u bytes the host didn't read", port, p->tx_dropped);
+
+  pthread_mutex_lock(&sccio_lock);
+  if (p->watched)
+    watch((p->fd >= 0) ? p->fd : p->listenfd, 0, p->watched);
+  if (p->kind == SCC_IO_TELNETD && p->fd >= 0)
+    close(p->fd);
+  p->kind = SCC_IO_NONE;
+  p->fd = p->listenfd = -1;
+  p->watched = 0;
+  pthread_mutex_unlock(&sccio_lock);
+}
+
+int scc_io_attached(int port) { return port >= 0 && port < SCC_IO_PORTS && sccio[port] && sccio[port]->kind != SCC_IO_NONE; }
+
+int scc_io_connected(int port) { return scc_io_attached(port) && sccio[port]->fd >= 0 && !sccio[port]->hungup; }
+
+// Next received byte, or -1 if nothing has come in.
+int scc_io_getc(int port)
+{
+  scc_io_port_t *p;
+  uint32 tail;
+  int c;
+
+  if (!scc_io_attached(port))
+    return -1;
+  p = sccio[port];
+  tail = p->rx_tail;
+  if (ring_load(&p->rx_head) == tail)
+    return -1;
+  c = p->rx[tail & (SCC_IO_RING - 1)];
+  ring_store(&p->rx_tail, tail + 1);
+  return c;
+}
+
+int scc_io_rx_pending(int port)
+{
+  if (!scc_io_attached(port))
+    return 0;
+  return (int)(ring_load(&sccio[port]->rx_head) - sccio[port]->rx_tail);
+}
+
+void scc_io_kick(void)
+{
+  if (sccio_running && !__atomic_exchange_n(&sccio_awake, 1, __ATOMIC_SEQ_CST))
+    if (write(sccio_wake[1], "", 1) < 0)
+      DEBUG_LOG(0, "could not wake the serial I/O thread");
+}
+
+// Is the tx ring full?  RR0 shows the transmit buffer as busy until it isn't, so a driver that
+// polls for it holds off rather than losing anything.
+int scc_io_tx_full(int port)
+{
+  scc_io_port_t *p;
+
+  if (!scc_io_attached(port))
+    return 0;
+  p = sccio[port];
+  return p->tx_head - ring_load(&p->tx_tail) >= SCC_IO_RING;
+}
+
+// Queue a byte to go out.  This never waits on the host: when the ring is full (nobody's reading)
+// the byte is dropped and counted.  Returns 1 if it was queued.
+int scc_io_putc(int port, uint8 data)
+{
+  scc_io_port_t *p;
+  uint32 head;
+
+  if (!scc_io_attached(port))
+    return 0;
+  p = sccio[port];
+  head = p->tx_head;
+
+  if (head - ring_load(&p->tx_tail) >= SCC_IO_RING)
+  {
+    if (!p->tx_dropped++)
+      ALERT_LOG(0, "serial port %d: the host isn't reading, dropping output", port);
+    scc_io_kick();
+    return 0;
+  }
+  p->tx[head & (SCC_IO_RING - 1)] = data;
+  ring_store(&p->tx_head, head + 1);
+  scc_io_kick();
+  return 1;
+}
+
+#else
+
+int scc_io_attach(int port, int fd, int kind) { return -1; }
+void scc_io_detach(int port) {}
+int scc_io_attached(int port) { return 0; }
+int scc_io_connected(int port) { return 0; }
+int scc_io_getc(int port) { return -1; }
+int scc_io_rx_pending(int port) { return 0; }
+void scc_io_kick(void) {}
+int scc_io_tx_full(int port) { return 0; }
+int scc_io_putc(int port, uint8 data) { return 0; }
+
+#endif
@@ -0,0 +1,789 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*                     Z8530 SCC serial port multiplexer ("Mux")                        *
+*                                                                                      *
+*  Shares one Lisa serial port between several host endpoints, so e.g. a test harness  *
+*  can drive a Xenix console through a pty while a log tap and a recording capture     *
+*  everything the Lisa says.  Everything the Lisa sends goes to every endpoint, what   *
+*  any endpoint sends is merged into what the Lisa receives.  It's all local, there    *
+*  are no network sockets.                                                             *
+*                                                                                      *
+*  The port's settings are a list of endpoints separated by semicolons:                *
+*                                                                                      *
+*     listen:/tmp/lisa-b.sock   Unix socket, any number of clients can connect         *
+*     connect:/tmp/dev.sock     Unix socket some other program is listening on, it's   *
+*                               retried every second until it's there                  *
+*     pty:/tmp/lisa-b           pseudo tty, optionally symlinked as for PseudoTTY      *
+*     log:/tmp/lisa-b.log       raw copy of everything the Lisa sends                  *
+*     record:/tmp/lisa-b.cap    timestamped capture of both directions, one per port   *
+*     replay:/tmp/old.cap       feeds the received ('>') side of a capture back to the *
+*                               Lisa with its original timing, one per port            *
+*                                                                                      *
+*  Captures are text, one line per chunk: 68K cycles since the port was opened, '<'    *
+*  for bytes the Lisa sent or '>' for bytes it received, then the bytes in hex.        *
+*                                                                                      *
+*      # LisaEm serial capture, port B                                                 *
+*      7601655 < 6c6f67696e3a20                                                        *
+*      10009360 > 726f6f740d                                                           *
+*                                                                                      *
+*  Captures are stamped and replayed on the Lisa's clock by the emulation thread, as   *
+*  the bytes go in and out of the SCC, so a replay feeds the Lisa the same bytes at    *
+*  the same point of its run whatever the host's speed, turbo included.                *
+*                                                                                      *
+*  The Lisa side of the mux is one end of a socketpair that's handed to the serial I/O *
+*  thread like any other stream (z8530-iothread.c), the mux thread services the other  *
+*  end and all the endpoints.  Each endpoint has its own output buffer, one that stops *
+*  reading just loses what doesn't fit rather than stalling the Lisa or the others.    *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_Z8530_MUX_C
+#ifndef __MSVCRT__
+#define _GNU_SOURCE
+#define _XOPEN_SOURCE 600
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE
+#endif
+#endif
+
+#include <vars.h>
+#include <z8530_structs.h>
+
+#ifndef __MSVCRT__
+
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <termios.h>
+#include <ctype.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SCC_MUX_PORTS 2
+#define SCC_MUX_ENDPOINTS 16
+#define SCC_MUX_BUF 65536
+#define SCC_MUX_CHUNK 4096
+#define SCC_MUX_RETRY_MS 1000 // reconnect, or look at a pty nobody has open again
+#define SCC_MUX_PATH 108      // sizeof(sun_path) on most systems
+
+enum
+{
+  MUX_FREE,
+  MUX_LISTEN,  // listening socket, accepted connections become MUX_CLIENT
+  MUX_CLIENT,
+  MUX_CONNECT,
+  MUX_PTY,
+  MUX_LOG,
+  MUX_RECORD,
+  MUX_REPLAY
+};
+
+typedef struct
+{
+  int type;
+  int fd;
+  char path[SCC_MUX_PATH];
+  FILE *file;    // log
+  uint8 *out;    // waiting to be written to fd
+  uint32 outlen;
+  int64 retry;   // connect, pty: leave it alone until then
+  int dropped;   // output lost because the endpoint wasn't reading, reported once
+} mux_ep_t;
+
+typedef struct
+{
+  int port;
+  int fd;   // our end of the socketpair to the I/O thread
+  int iofd; // the I/O thread's end, still ours to close once the port is detached
+  mux_ep_t ep[SCC_MUX_ENDPOINTS];
+  uint8 tolisa[SCC_MUX_BUF];
+  uint32 tolisalen;
+  int stop;
+  int wake[2];
+  pthread_t thread;
+
+  // only the emulation thread touches these, the mux thread just flushes rec now and then
+  XTIMER start; // cpu68k_clocks when the port was opened, captures count from here
+  FILE *rec;
+  char recdir;  // direction of the line being written, 0 before the first
+  XTIMER rect;  // and when it started
+  uint32 reclen;
+  FILE *replay;
+  XTIMER due;   // when the next replayed chunk goes in, since start, -1 when there's no more
+  uint8 chunk[SCC_MUX_CHUNK];
+  uint32 chunklen, chunkpos;
+} scc_mux_t;
+
+static scc_mux_t *mux[SCC_MUX_PORTS];
+
+static int64 now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void nonblock(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+static void ep_close(mux_ep_t *e)
+{
+  if (e->fd >= 0)
+    close(e->fd);
+  if (e->file)
+    fclose(e->file);
+  if (e->type == MUX_LISTEN || (e->type == MUX_PTY && e->path[0])) // socket, or link to the slave
+    unlink(e->path);
+  free(e->out);
+  memset(e, 0, sizeof(mux_ep_t));
+  e->fd = -1;
+  e->type = MUX_FREE;
+}
+
+static mux_ep_t *ep_new(scc_mux_t *m, int type)
+{
+  int i;
+
+  for (i = 0; i < SCC_MUX_ENDPOINTS; i++)
+    if (m->ep[i].type == MUX_FREE)
+    {
+      memset(&m->ep[i], 0, sizeof(mux_ep_t));
+      m->ep[i].type = type;
+      m->ep[i].fd = -1;
+      return &m->ep[i];
+    }
+  return NULL;
+}
+
+static int unix_addr(struct sockaddr_un *sa, char *path)
+{
+  memset(sa, 0, sizeof(struct sockaddr_un));
+  sa->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(sa->sun_path))
+    return -1;
+  strncpy(sa->sun_path, path, sizeof(sa->sun_path) - 1);
+  return 0;
+}
+
+static int open_listen(mux_ep_t *e)
+{
+  struct sockaddr_un sa;
+
+  if (unix_addr(&sa, e->path) < 0 || (e->fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    return -1;
+  unlink(e->path); // stale socket from a previous run
+  if (bind(e->fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(e->fd, 4) < 0)
+    return -1;
+  nonblock(e->fd);
+  return 0;
+}
+
+static void try_connect(mux_ep_t *e, int64 now)
+{
+  struct sockaddr_un sa;
+
+  if (e->fd >= 0 || now < e->retry)
+    return;
+  e->retry = now + SCC_MUX_RETRY_MS * 1000;
+  if (unix_addr(&sa, e->path) < 0 || (e->fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    return;
+  if (connect(e->fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+  {
+    close(e->fd);
+    e->fd = -1;
+    return;
+  }
+  nonblock(e->fd);
+  ALERT_LOG(0, "serial mux connected to %s", e->path);
+}
+
+// Same setup as the PseudoTTY backend: raw on both sides, optional symlink to the slave.
+static int open_pty(mux_ep_t *e)
+{
+  struct termios t;
+  char slave[64];
+  int sfd;
+
+  if ((e->fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(e->fd) || unlockpt(e->fd))
+    return -1;
+
+  memset(slave, 0, sizeof(slave));
+#ifdef __APPLE__
+  if (ptsname(e->fd))
+    strncpy(slave, ptsname(e->fd), sizeof(slave) - 1);
+#else
+  ptsname_r(e->fd, slave, sizeof(slave) - 1);
+#endif
+
+  if ((sfd = open(slave, O_RDWR | O_NOCTTY)) >= 0)
+  {
+    if (!tcgetattr(sfd, &t))
+    {
+      cfmakeraw(&t);
+      t.c_iflag &= ~(IXON | IXOFF);
+      tcsetattr(sfd, TCSANOW, &t);
+    }
+    close(sfd);
+  }
+  if (!tcgetattr(e->fd, &t))
+  {
+    cfmakeraw(&t);
+    tcsetattr(e->fd, TCSANOW, &t);
+  }
+  nonblock(e->fd);
+
+  if (e->path[0])
+  {
+    unlink(e->path);
+    if (symlink(slave, e->path) < 0)
+      ALERT_LOG(0, "could not link %s to %s: %s", e->path, slave, strerror(errno));
+  }
+  ALERT_LOG(0, "serial mux pty is %s", slave);
+  return 0;
+}
+
+// Read the next '>' line of a capture being replayed.
+static void replay_next(scc_mux_t *m)
+{
+  char line[SCC_MUX_CHUNK * 2 + 64], *hex;
+  long long t;
+  char dir;
+  int n;
+
+  m->due = -1;
+  m->chunklen = m->chunkpos = 0;
+  while (fgets(line, sizeof(line), m->replay))
+  {
+    if (sscanf(line, "%lld %c %n", &t, &dir, &n) < 2 || dir != '>')
+      continue;
+    for (hex = line + n; isxdigit((uint8)hex[0]) && isxdigit((uint8)hex[1]) && m->chunklen < SCC_MUX_CHUNK; hex += 2)
+    {
+      unsigned int c;
+      sscanf(hex, "%2x", &c);
+      m->chunk[m->chunklen++] = (uint8)c;
+    }
+    if (m->chunklen)
+    {
+      m->due = (XTIMER)t;
+      return;
+    }
+  }
+}
+
+// Add a byte to the capture.  Bytes the Lisa receives at the same cycle share a line, so a replay
+// hands them over together again; what it sends is only for reading, so that's a line a tenth.
+static void rec_byte(scc_mux_t *m, char dir, uint8 c)
+{
+  XTIMER t = cpu68k_clocks - m->start;
+
+  if (m->recdir != dir || t - m->rect > (dir == '>' ? 0 : TENTH_OF_A_SECOND) || m->reclen >= SCC_MUX_CHUNK)
+  {
+    if (m->recdir)
+      fputc('\n', m->rec);
+    fprintf(m->rec, "%lld %c ", (long long)t, dir);
+    m->recdir = dir;
+    m->rect = t;
+    m->reclen = 0;
+  }
+  fprintf(m->rec, "%02x", c);
+  m->reclen++;
+}
+
+static void ep_queue(mux_ep_t *e, uint8 *buf, uint32 len)
+{
+  if (!e->out && !(e->out = (uint8 *)malloc(SCC_MUX_BUF)))
+    return;
+  if (len > SCC_MUX_BUF - e->outlen)
+  {
+    if (!e->dropped)
+      ALERT_LOG(0, "serial mux endpoint %s isn't reading, dropping output", e->path);
+    e->dropped = 1;
+    len = SCC_MUX_BUF - e->outlen;
+  }
+  memcpy(e->out + e->outlen, buf, len);
+  e->outlen += len;
+}
+
+static void ep_flush(mux_ep_t *e)
+{
+  ssize_t n = write(e->fd, e->out, e->outlen);
+
+  if (n <= 0)
+    return;
+  memmove(e->out, e->out + n, e->outlen - n);
+  e->outlen -= (uint32)n;
+  e->dropped = 0;
+}
+
+static void to_lisa(scc_mux_t *m, uint8 *buf, uint32 len)
+{
+  memcpy(m->tolisa + m->tolisalen, buf, len); // callers never read more than there's room for
+  m->tolisalen += len;
+}
+
+// The Lisa sent something, fan it out.
+static void from_lisa(scc_mux_t *m)
+{
+  uint8 buf[SCC_MUX_CHUNK];
+  ssize_t n = read(m->fd, buf, sizeof(buf));
+  int i;
+
+  if (n <= 0)
+    return;
+  for (i = 0; i < SCC_MUX_ENDPOINTS; i++)
+  {
+    mux_ep_t *e = &m->ep[i];
+
+    if (e->type == MUX_LOG)
+    {
+      fwrite(buf, 1, (size_t)n, e->file);
+      fflush(e->file);
+      continue;
+    }
+    if (e->fd < 0 || (e->type == MUX_PTY && e->retry)) // nobody there to see it
+      continue;
+    if (e->type == MUX_CLIENT || e->type == MUX_CONNECT || e->type == MUX_PTY)
+      ep_queue(e, buf, (uint32)n);
+  }
+}
+
+static void ep_input(scc_mux_t *m, mux_ep_t *e)
+{
+  uint8 buf[SCC_MUX_CHUNK];
+  ssize_t n;
+
+  if (e->type == MUX_LISTEN)
+  {
+    int fd = accept(e->fd, NULL, NULL);
+    mux_ep_t *c;
+
+    if (fd < 0)
+      return;
+    if (!(c = ep_new(m, MUX_CLIENT)))
+    {
+      ALERT_LOG(0, "serial mux on port %d has no room for another client", m->port);
+      close(fd);
+      return;
+    }
+    nonblock(fd);
+    c->fd = fd;
+    snprintf(c->path, SCC_MUX_PATH, "%s", e->path);
+    ALERT_LOG(0, "serial mux client connected to %s", e->path);
+    return;
+  }
+
+  n = read(e->fd, buf, MIN((uint32)sizeof(buf), SCC_MUX_BUF - m->tolisalen));
+  if (n > 0)
+  {
+    to_lisa(m, buf, (uint32)n);
+    return;
+  }
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return;
+
+  switch (e->type)
+  {
+  case MUX_CLIENT:
+    ALERT_LOG(0, "serial mux client of %s went away", e->path);
+    ep_close(e);
+    break;
+  case MUX_CONNECT:
+    close(e->fd);
+    e->fd = -1;
+    e->outlen = 0;
+    break;
+  case MUX_PTY: // nobody has the slave open, read gives EIO until somebody does
+    e->retry = now_us() + SCC_MUX_RETRY_MS * 1000;
+    e->outlen = 0;
+    break;
+  }
+}
+
+static void *mux_main(void *arg)
+{
+  scc_mux_t *m = (scc_mux_t *)arg;
+  struct pollfd pfd[SCC_MUX_ENDPOINTS + 2];
+  mux_ep_t *who[SCC_MUX_ENDPOINTS + 2];
+  int64 flushed = now_us();
+
+  while (!__atomic_load_n(&m->stop, __ATOMIC_ACQUIRE))
+  {
+    int64 now = now_us(), wait = -1;
+    int i, n, nfds = 0, room = (m->tolisalen + SCC_MUX_CHUNK <= SCC_MUX_BUF);
+
+    pfd[nfds].fd = m->wake[0];
+    pfd[nfds].events = POLLIN;
+    who[nfds++] = NULL;
+    pfd[nfds].fd = m->fd; // events are filled in below, once we know if there is room
+    who[nfds++] = NULL;
+
+    for (i = 0; i < SCC_MUX_ENDPOINTS; i++)
+    {
+      mux_ep_t *e = &m->ep[i];
+      int64 t = -1;
+
+      if (e->type == MUX_CONNECT)
+      {
+        try_connect(e, now);
+        if (e->fd < 0)
+          t = e->retry;
+      }
+      if (e->type == MUX_PTY && e->retry)
+      {
+        if (now >= e->retry)
+          e->retry = 0;
+        else
+          t = e->retry;
+      }
+      if (t >= 0)
+        wait = (wait < 0 || t < wait) ? t : wait;
+
+      if (e->fd < 0 || (e->type == MUX_PTY && e->retry))
+        continue;
+      if (e->type == MUX_LISTEN || e->type == MUX_CLIENT || e->type == MUX_CONNECT || e->type == MUX_PTY)
+      {
+        pfd[nfds].fd = e->fd;
+        pfd[nfds].events = ((room || e->type == MUX_LISTEN) ? POLLIN : 0) | (e->outlen ? POLLOUT : 0);
+        who[nfds++] = e;
+      }
+    }
+
+    pfd[1].events = POLLIN | (m->tolisalen ? POLLOUT : 0);
+
+    if (m->rec) // stdio locks the FILE against the emulation thread writing to it
+    {
+      if (now - flushed >= SCC_MUX_RETRY_MS * 1000)
+      {
+        fflush(m->rec);
+        flushed = now;
+      }
+      if (wait < 0 || wait > flushed + SCC_MUX_RETRY_MS * 1000)
+        wait = flushed + SCC_MUX_RETRY_MS * 1000;
+    }
+
+    if (wait >= 0)
+      wait = (wait > now) ? (wait - now + 999) / 1000 : 0;
+    if (!room && (wait < 0 || wait > 10))
+      wait = 10; // the Lisa is behind, look again soon
+
+    n = poll(pfd, nfds, (int)wait);
+    if (n <= 0)
+      continue;
+
+    if (pfd[0].revents)
+    {
+      uint8 junk[16];
+      while (read(m->wake[0], junk, sizeof(junk)) > 0)
+        ;
+    }
+    if (pfd[1].revents & POLLIN)
+      from_lisa(m);
+    if ((pfd[1].revents & POLLOUT) && m->tolisalen)
+    {
+      ssize_t w = write(m->fd, m->tolisa, m->tolisalen);
+      if (w > 0)
+      {
+        memmove(m->tolisa, m->tolisa + w, m->tolisalen - w);
+        m->tolisalen -= (uint32)w;
+      }
+    }
+    for (i = 2; i < nfds; i++)
+    {
+      mux_ep_t *e = who[i];
+
+      if (e->type == MUX_FREE || e->fd != pfd[i].fd)
+        continue;
+      if ((pfd[i].revents & POLLOUT) && e->outlen)
+        ep_flush(e);
+      if (pfd[i].revents & (POLLIN | POLLHUP | POLLERR))
+      {
+        if (e->type == MUX_LISTEN || m->tolisalen + SCC_MUX_CHUNK <= SCC_MUX_BUF)
+          ep_input(m, e);
+        else if (!(pfd[i].revents & POLLIN))
+          ep_input(m, e); // hung up, no data to lose
+      }
+    }
+  }
+  return NULL;
+}
+
+static int add_endpoint(scc_mux_t *m, char *spec)
+{
+  static const struct
+  {
+    const char *name;
+    int type;
+  } kinds[] = {{"listen", MUX_LISTEN}, {"connect", MUX_CONNECT}, {"pty", MUX_PTY}, {"log", MUX_LOG}, {"record", MUX_RECORD}, {"replay", MUX_REPLAY}};
+  char *path = strchr(spec, ':');
+  size_t len = path ? (size_t)(path - spec) : strlen(spec);
+  mux_ep_t *e;
+  int i, type = MUX_FREE;
+
+  for (i = 0; i < (int)(sizeof(kinds) / sizeof(kinds[0])); i++)
+    if (strlen(kinds[i].name) == len && !strncasecmp(spec, kinds[i].name, len))
+      type = kinds[i].type;
+
+  if (type == MUX_FREE)
+  {
+    ALERT_LOG(0, "serial mux: don't know what '%s' is", spec);
+    return -1;
+  }
+  path = path ? path + 1 : "";
+  if (!*path && type != MUX_PTY)
+  {
+    ALERT_LOG(0, "serial mux: %s needs a path", spec);
+    return -1;
+  }
+
+  if (type == MUX_RECORD || type == MUX_REPLAY) // the emulation thread's, not endpoints
+  {
+    FILE **f = (type == MUX_RECORD) ? &m->rec : &m->replay;
+
+    if (*f)
+    {
+      ALERT_LOG(0, "serial mux: only one %s per port", type == MUX_RECORD ? "record" : "replay");
+      return -1;
+    }
+    if (!(*f = fopen(path, type == MUX_RECORD ? "w" : "r")))
+    {
+      ALERT_LOG(0, "serial mux: could not open %s: %s", spec, strerror(errno));
+      return -1;
+    }
+    if (type == MUX_RECORD)
+      fprintf(m->rec, "# LisaEm serial capture, port %c\n", m->port ? 'A' : 'B');
+    else
+      replay_next(m);
+    return 0;
+  }
+
+  if (!(e = ep_new(m, type)))
+    return -1;
+  snprintf(e->path, SCC_MUX_PATH, "%s", path);
+
+  switch (type)
+  {
+  case MUX_LISTEN:
+    if (open_listen(e) < 0)
+      break;
+    return 0;
+  case MUX_CONNECT:
+    return 0; // the thread connects, and keeps trying
+  case MUX_PTY:
+    if (open_pty(e) < 0)
+      break;
+    return 0;
+  case MUX_LOG:
+    if (!(e->file = fopen(path, "ab")))
+      break;
+    return 0;
+  }
+  ALERT_LOG(0, "serial mux: could not open %s: %s", spec, strerror(errno));
+  ep_close(e);
+  return -1;
+}
+
+static void close_captures(scc_mux_t *m)
+{
+  if (m->rec)
+  {
+    if (m->recdir)
+      fputc('\n', m->rec);
+    fclose(m->rec);
+  }
+  if (m->replay)
+    fclose(m->replay);
+  m->rec = m->replay = NULL;
+}
+
+void close_mux_serial_port(int port)
+{
+  scc_mux_t *m;
+  int i;
+
+  if (port < 0 || port >= SCC_MUX_PORTS || !(m = mux[port]))
+    return;
+
+  scc_io_detach(port);
+  if (m->iofd >= 0)
+    close(m->iofd);
+  __atomic_store_n(&m->stop, 1, __ATOMIC_RELEASE);
+  if (write(m->wake[1], "", 1) < 0)
+    DEBUG_LOG(0, "could not wake the serial mux thread");
+  pthread_join(m->thread, NULL);
+
+  for (i = 0; i < SCC_MUX_ENDPOINTS; i++)
+    if (m->ep[i].type != MUX_FREE)
+      ep_close(&m->ep[i]);
+  close_captures(m);
+  close(m->fd);
+  close(m->wake[0]);
+  close(m->wake[1]);
+  free(m);
+  mux[port] = NULL;
+}
+
+// invoked from lisaem_wx.cpp, spec is the port's settings, see the top of this file.
+int init_mux_serial_port(int port, char *spec)
+{
+  char buf[1024], *s, *save = NULL;
+  scc_mux_t *m;
+  int sv[2], i;
+
+  if (port < 0 || port >= SCC_MUX_PORTS)
+    return -1;
+  close_mux_serial_port(port);
+
+  if (!(m = (scc_mux_t *)calloc(1, sizeof(scc_mux_t))))
+    return -1;
+  m->port = port;
+  m->iofd = -1;
+  m->start = cpu68k_clocks;
+  m->due = -1;
+  for (i = 0; i < SCC_MUX_ENDPOINTS; i++)
+    m->ep[i].fd = -1;
+
+  snprintf(buf, sizeof(buf), "%s", spec ? spec : "");
+  for (s = strtok_r(buf, ";", &save); s; s = strtok_r(NULL, ";", &save))
+  {
+    while (*s == ' ' || *s == '\t')
+      s++;
+    if (*s && add_endpoint(m, s) < 0)
+      ALERT_LOG(0, "serial mux on port %d: skipping %s", port, s);
+  }
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0 || pipe(m->wake) < 0)
+  {
+    ALERT_LOG(0, "serial mux: %s", strerror(errno));
+    for (i = 0; i < SCC_MUX_ENDPOINTS; i++)
+      if (m->ep[i].type != MUX_FREE)
+        ep_close(&m->ep[i]);
+    close_captures(m);
+    free(m);
+    return -1;
+  }
+  nonblock(sv[1]);
+  nonblock(m->wake[0]);
+  m->fd = sv[1];
+
+  if (pthread_create(&m->thread, NULL, mux_main, m))
+  {
+    ALERT_LOG(0, "could not start the serial mux thread: %s", strerror(errno));
+    close(sv[0]);
+    close(sv[1]);
+    close(m->wake[0]);
+    close(m->wake[1]);
+    for (i = 0; i < SCC_MUX_ENDPOINTS; i++)
+      if (m->ep[i].type != MUX_FREE)
+        ep_close(&m->ep[i]);
+    close_captures(m);
+    free(m);
+    return -1;
+  }
+  mux[port] = m;
+  m->iofd = sv[0];
+
+  if (scc_io_attach(port, sv[0], SCC_IO_STREAM) < 0)
+  {
+    ALERT_LOG(0, "could not hand serial mux on port %d to the I/O thread", port);
+    close_mux_serial_port(port); // closes sv[0] too
+    return -1;
+  }
+
+  scc_r[port].s.rr0.r.tx_buffer_empty = 1;
+  scc_r[port].s.rr0.r.dcd = 1;
+  scc_r[port].s.rr0.r.cts = 1;
+  return 0;
+}
+
+// Invoked from z8530.c.  The mux thread always drains the socketpair, dropping per endpoint
+// if it has to, so the I/O thread's ring rarely fills.
+void write_serial_port_mux(unsigned int port, char data)
+{
+  if (port < SCC_MUX_PORTS && mux[port] && mux[port]->rec)
+    rec_byte(mux[port], '<', (uint8)data);
+  scc_io_putc(port, (uint8)data);
+}
+
+// The next byte for the Lisa, from z8530.c's read_port_if_ready_mux().  A replayed chunk goes in
+// once the Lisa's clock reaches its stamp, ahead of anything the live endpoints sent.
+int scc_mux_getc(int port)
+{
+  scc_mux_t *m;
+  int c;
+
+  if (port < 0 || port >= SCC_MUX_PORTS || !(m = mux[port]))
+    return -1;
+  if (m->due >= 0 && cpu68k_clocks - m->start >= m->due)
+  {
+    c = m->chunk[m->chunkpos++];
+    if (m->chunkpos == m->chunklen)
+      replay_next(m);
+  }
+  else if ((c = scc_io_getc(port)) < 0)
+    return -1;
+
+  if (m->rec)
+    rec_byte(m, '>', (uint8)c);
+  return c;
+}
+
+// How many bytes could go to the Lisa right now.
+int scc_mux_rx_pending(int port)
+{
+  scc_mux_t *m;
+  int n = scc_io_rx_pending(port);
+
+  if (port >= 0 && port < SCC_MUX_PORTS && (m = mux[port]) && m->due >= 0 && cpu68k_clocks - m->start >= m->due)
+    n += (int)(m->chunklen - m->chunkpos);
+  return n;
+}
+
+// When the next replayed chunk is due on the Lisa's clock, or -1.
+XTIMER scc_mux_replay_due(int port)
+{
+  scc_mux_t *m;
+
+  if (port < 0 || port >= SCC_MUX_PORTS || !(m = mux[port]) || m->due < 0)
+    return -1;
+  return m->start + m->due;
+}
+
+// No modem lines on a socket, DTR is looped back to DCD as for the PseudoTTY backend.
+void set_dtr_mux(unsigned int port, uint8 value) { scc_r[port].s.rr0.r.dcd = value; }
+
+#else
+
+int init_mux_serial_port(int port, char *spec) { return -1; }
+void close_mux_serial_port(int port) {}
+void write_serial_port_mux(unsigned int port, char data) {}
+int scc_mux_getc(int port) { return -1; }
+int scc_mux_rx_pending(int port) { return 0; }
+XTIMER scc_mux_replay_due(int port) { return -1; }
+void set_dtr_mux(unsigned int port, uint8 value) {}
+
+#endif
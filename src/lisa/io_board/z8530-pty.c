@@ -59,12 +59,12 @@
 * to LisaEm, you will observe that it sends data in chunks of about 20k, then waits for*
 * Lisa to fully comsume it, then sends another chunk, etc. This buffer is part of the  *
 * Pseudo TTY port implementation, and cannot be changed or disabled.                   *
-* Implementation detail: the host->LisaEm communicationpath does polling for data when *
-* Lisa is ready to recive another byte, so that the emulator will not freeze if the    *
-* host is not sending any data. However, the LisaEm->host communication path does not  *
-* support polling, so if the host is not reading data from the Pseudo TTY port, LisaEm *
-* may eventually block and freeze. If data loss is acceptable, the code can be modified*
-* to do so instead of blocking.                                                        *
+* Implementation detail: the pty is read and written by the serial I/O thread          *
+* (z8530-iothread.c), so the emulator never waits on the host for input.  Output goes  *
+* through a 64K ring; if the host is not reading data from the Pseudo TTY port and the *
+* ring fills up, the SCC shows its transmit buffer as full until there is room again,  *
+* so a driver that polls RR0 waits.  Anything written regardless is dropped, LisaEm    *
+* never stalls on the host.                                                            *
 \***************************************************************************************/
 
 #ifndef __MSVCRT__
@@ -224,8 +224,10 @@ void init_pty_serial_port(int port, char *desired_pty_port_symlink_name)
   {
     fprintf(stderr, "Warning: tcgetattr failed on master PTY fd %d: %s\n", fd[port], strerror(errno));
   }
-  // Make the master side non-blocking for reads and writes.
+  // Make the master side non-blocking for reads and writes, the I/O thread does both from now on.
   fcntl(fd[port], F_SETFL, O_NONBLOCK | O_NDELAY);
+  if (scc_io_attach(port, fd[port], SCC_IO_STREAM) < 0)
+    fprintf(stderr, "Warning: could not start the serial I/O thread for port %d\n", port);
 
   // Create a symbolic link to the PTY with the user-provided alias
   if (strlen(desired_pty_port_symlink_name) > 0)
@@ -250,54 +252,12 @@ void init_pty_serial_port(int port, char *desired_pty_port_symlink_name)
   }
 }
 
-int poll_pty_serial_read(int port)
-{
-  int rc;
-  fd_set fd_in;
-
-  FD_ZERO(&fd_in);
-  FD_SET(fd[port], &fd_in);
-  struct timeval tmo;
-  tmo.tv_sec = 0;
-  tmo.tv_usec = 1;
-  // tmo.tv_nsec=1;
-  rc = select(fd[port] + 1, &fd_in, NULL, NULL, &tmo);
-  if (rc < 0)
-  {
-    DEBUG_LOG(0, "got rc %d error from poll on port %d", rc, port); //[cite: 1]
-    return 0;
-  }
+int poll_pty_serial_read(int port) { return scc_io_rx_pending(port); }
 
-  // Ensure we only return true if the specific PTY fd is ready
-  return FD_ISSET(fd[port], &fd_in);
-}
-
-// Invoked from z8530.c
+// Invoked from z8530.c - the I/O thread has already read whatever the host sent.
 char read_serial_port_pty(int port)
 {
-  // Without this poll() check, the read() call below can block if no data is available, which would freeze LisaEm.
-  if (poll_pty_serial_read(port) > 0)
-  {
-    char data;
-    int num_bytes_read = read(fd[port], &data, 1);
-    if (num_bytes_read == 1)
-    {
-      DEBUG_LOG(0, "Received %c (%d) on serial port %d", data, data, port);
-      return data;
-    }
-    else if (num_bytes_read == 0)
-    {
-      DEBUG_LOG(0, "Received EOF on serial port %d", port);
-      return -1;
-    }
-    else
-    {
-      DEBUG_LOG(0, "Got %d error reading from serial port %d", num_bytes_read, port);
-      return -1;
-    }
-  }
-
-  return -1;
+  return (char)scc_io_getc(port);
 }
 
 // Invoked from z8530.c
@@ -305,36 +265,10 @@ int write_serial_port_pty(int port, uint8 data)
 {
   DEBUG_LOG(0, "Sending out %c (%d) to serial port %d", data, data, port);
 
-  // The master fd is O_NONBLOCK, and a PTY's kernel-side buffer is small.
-  // If the reader on the other end (e.g. "picocom") isn't draining fast
-  // enough, write() returns -1/EAGAIN. Rather than dropping the byte
-  // or queueing it in software, we just wait here until the
-  // kernel says the fd is writable again, then write. This stalls the
-  // emulator loop while the host side catches up, but guarantees nothing
-  // written by the Lisa is ever lost.
-  for (;;)
-  {
-    ssize_t n = write(fd[port], &data, 1);
-    if (n == 1)
-    {
-      return 1;
-    }
-
-    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
-    {
-      fd_set fd_out;
-      FD_ZERO(&fd_out);
-      FD_SET(fd[port], &fd_out);
-      // No timeout: block here until the host side has drained enough
-      // room for another byte.
-      select(fd[port] + 1, NULL, &fd_out, NULL, NULL);
-      continue;
-    }
-
-    // A real error (not just "try again later").
-    fprintf(stdout, "Got %zd error writing to serial port %d (errno %d)\n", n, port, errno);
-    return n;
-  }
+  // A PTY's kernel-side buffer is small, so the I/O thread keeps a much larger ring in front of
+  // it.  If the reader on the other end (e.g. "picocom") still can't keep up and the ring fills,
+  // RR0 holds the Lisa off, see the top of this file.
+  return scc_io_putc(port, data);
 }
 
 // Invoked from z8530.c
@@ -279,6 +279,8 @@ static int init_parent(int port)
 
   ALERT_LOG(0, "initialize parent, closing slave side");
   close(fds[port]);
+  if (scc_io_attach(port, fdm[port], SCC_IO_STREAM) < 0)
+    ALERT_LOG(0, "could not start the serial I/O thread for port %d", port);
 
   //  ALERT_LOG(0,"FD_ZERO");  FD_ZERO(    &fd_in);
   //  ALERT_LOG(0,"FD_SET");   FD_SET(0,   &fd_in);
@@ -345,59 +347,23 @@ void init_shell_serial_port(int port)
   return;
 } // main
 
-// int poll_shell_serial_read(int port) { return (FD_ISSET(fdm[port], &fd_in[port])); }
-
-int poll_shell_serial_read(int port)
-{
-  int rc;
-  fd_set fd_in;
-
-  FD_ZERO(&fd_in);
-  FD_SET(0, &fd_in);
-  FD_SET(fdm[port], &fd_in);
-  struct timeval tmo;
-  tmo.tv_sec = 0;
-  tmo.tv_usec = 1;
-  // tmo.tv_nsec=1;
-  //           num fd's       fd in   fdout, fdexcept, timeout
-  rc = select(fdm[port] + 1, &fd_in, NULL, NULL, &tmo); // was fdm[port] + 1, &fd_in, NULL, NULL, &tmo)
-  if (rc < 0)
-  {
-    ALERT_LOG(0, "got rc %d error from poll on port %d", rc, port);
-    return 0;
-  }
-  // if (rc) rc=FD_ISSET(fdm[port]+1,&fd_in);  //2020.11.27
-  return rc; // return (FD_ISSET(0, &fd_in));
-}
+// the serial I/O thread reads the shell's output as it comes, these just look at what it got.
+int poll_shell_serial_read(int port) { return scc_io_rx_pending(port); }
 
 char read_serial_port_shell(int port)
 {
-  int rc = 0;
-
-  if (poll_shell_serial_read(port) > 0)
-  {
-    rc = read(fdm[port], input[port], 1);
-    if (rc > 0)
-    {
-      ALERT_LOG(0, "read: char %c, %02x port:%d", input[port][0], input[port][0], port);
-      return (int)(input[port][0]);
-    }
-    if (rc < 0)
-      ALERT_LOG(0, "got rc %d error from poll on port %d", rc, port);
-  }
-
-  return -1;
+  return (char)scc_io_getc(port);
 }
 
 int write_serial_port_shell(int port, uint8 data)
 {
-  input[port][0] = data;
   ALERT_LOG(0, "Writing %c(%d) to port %d", data, data, port);
-  return write(fdm[port], input, 1);
+  return scc_io_putc(port, data);
 }
 
 void close_shell(int port)
 {
+  scc_io_detach(port);
   close(fdm[port]);
   fdm[port] = -1;
   kill(child_pid[port], SIGTERM);
@@ -312,6 +312,9 @@ void init_tty_serial_port(int port, char *config)
   options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG); // raw input
 
   tcsetattr(fd[port], TCSANOW, &options);
+
+  if (port < 2) // SCC ports are serviced by the serial I/O thread
+    scc_io_attach(port, fd[port], SCC_IO_STREAM);
 }
 
 int poll_tty_serial_read(int port)
@@ -319,6 +322,9 @@ int poll_tty_serial_read(int port)
   int rc;
   fd_set fd_in;
 
+  if (scc_io_attached(port))
+    return scc_io_rx_pending(port);
+
   FD_ZERO(&fd_in);
   FD_SET(0, &fd_in);
   FD_SET(fd[port], &fd_in);
@@ -337,10 +343,15 @@ int poll_tty_serial_read(int port)
   return rc; // return (FD_ISSET(0, &fd_in));
 }
 
+// The SCC ports go through the serial I/O thread, anything else (the BLU terminal) is still
+// read and written directly.
 char read_serial_port_tty(int port)
 {
   int rc = 0;
 
+  if (scc_io_attached(port))
+    return (char)scc_io_getc(port);
+
   if (poll_tty_serial_read(port) > 0)
   {
     rc = read(fd[port], input[port], 1);
@@ -358,13 +369,16 @@ char read_serial_port_tty(int port)
 
 int write_serial_port_tty(int port, uint8 data)
 {
-  input[port][0] = data;
   ALERT_LOG(0, "Sending character %c(%d 0x%2x) to tty port %d", data, data, data, port);
+  if (scc_io_attached(port))
+    return scc_io_putc(port, data);
+  input[port][0] = data;
   return write(fd[port], input, 1);
 }
 
 void close_tty(int port)
 {
+  scc_io_detach(port);
   close(fd[port]);
   fd[port] = -1;
 }
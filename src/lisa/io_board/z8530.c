@@ -53,10 +53,13 @@
  * -> Lisa issues Reset Highest IUS to re-arm the interrupt chain 
  * -> Ready for the next byte. 
  * 
- * So we offer to the Lisa 1 byte per IRQ, 
- * by clearing (setting to 0) scc_r[0].s.rr0.r.rx_char_available, once Lisa reads the byte from RR8.
- * A more sophisticated implementation would allow multiple bytes to be queued 
- * and read by the Lisa in one interrupt.
+ * How fast bytes arrive depends on scc_rx_mode[port]:
+ * SCC_RX_ONEBYTE   - the original behaviour, we offer the Lisa 1 byte per IRQ on port B, and wait
+ *                    SCC_MIN_CYCLES_BETWEEN_READS after it's read before offering the next.
+ * SCC_RX_BAUD      - bytes are clocked into the 3 byte receive FIFO one character time apart, as
+ *                    the Lisa programmed the baud rate, data/stop/parity bits. (z8530_rx?_event)
+ * SCC_RX_UNLIMITED - the receive FIFO is refilled as soon as the Lisa reads a byte from RR8, so a
+ *                    receive interrupt handler that loops on RR0 drains the host as fast as it can.
  * 
  * The SCC registers can be accessed in two ways. Example:
  * - scc_r[1].s.rr3.r.ch_a_rx_irq_pending can be used to manipulate just bit ch_a_rx_irq_pending (the 6th bit)
@@ -90,6 +93,10 @@ uint8 scc_bits_per_char_mask[2];
 
 // FIFO queues for reading and writing data from/to the serial ports.
 FLIFLO_QUEUE_t SCC_READ[2], SCC_WRITE[2]; // if changing this also change the extern in z8530-terminal.cpp!
+FLIFLO_QUEUE_t SCC_LINE[2];               // terminal window input that hasn't been clocked into SCC_READ yet
+
+static XTIMER scc_rx_next[2];      // SCC_RX_BAUD: when the character now on the line will have been received
+static XTIMER scc_rx_char_time[2]; // cycles per character at the programmed rate, 0=recalculate
 
 // The SCC registers for reading and writing data from/to the serial ports.
 scc_r_t scc_r[2]; // 0 is port B, 1 is port A
@@ -275,6 +282,9 @@ extern char read_serial_port_tty(unsigned int port);
 extern void write_serial_port_tty(unsigned int port, char c);
 extern void set_port_baud_tty(int port, uint32 baud);
 
+extern void write_serial_port_mux(unsigned int port, char c);
+extern void set_dtr_mux(unsigned int port, uint8 value);
+
 
 #else
 // temp disable for windows until we flesh these guys out
@@ -461,126 +471,152 @@ void read_port_if_ready_nothing(unsigned int port)
 
 void rx_char_available(int port) { RX_CHAR_AVAILABLE(port); }
 
-void read_port_if_ready_shell(unsigned int port)
+// cycles it takes to receive one character: start bit, data bits, parity, stop bits at the rate
+// the Lisa programmed into wr3/wr4/wr12-14.  Cached until the next register write.
+static XTIMER rx_char_time(unsigned int port)
+{
+  static const uint8 databits[4] = {5, 7, 6, 8};
+  static const uint8 stoptenths[4] = {10, 10, 15, 20}; // 0 is sync mode, treat it as 1 stop bit
+  uint32 baud, tenths;
+
+  if (scc_rx_char_time[port])
+    return scc_rx_char_time[port];
+
+  baud = get_baud_rate(port);
+  if (!baud)
+    baud = 9600;
+
+  tenths = 10 + databits[scc_w[port].s.wr3.r.rxbitsperchar] * 10 + stoptenths[scc_w[port].s.wr4.r.stopbits] +
+           (scc_w[port].s.wr4.r.parityenable ? 10 : 0);
+
+  scc_rx_char_time[port] = (XTIMER)tenths * (ONE_SECOND / 10) / baud;
+  if (scc_rx_char_time[port] < 1)
+    scc_rx_char_time[port] = 1;
+
+  DEBUG_LOG(0, "port:%d %d baud, %d.%d bits/char, %lld cycles/char", port, baud, tenths / 10, tenths % 10,
+            (long long)scc_rx_char_time[port]);
+  return scc_rx_char_time[port];
+}
+
+// can another character be clocked into the receive FIFO right now?
+static int rx_fifo_ready(unsigned int port)
 {
   if (fliflo_buff_is_full(&SCC_READ[port]))
-    return;
-  if (port == 0 && waiting_for_lisa_to_read_port_b)
-    return;
-  if (port == 0 && (cpu68k_clocks - port_b_last_lisa_read_clock_timestamp < SCC_MIN_CYCLES_BETWEEN_READS))
-    return;
-  char data = read_serial_port_shell(port);
-  if (data != -1)
+    return 0;
+
+  switch (scc_rx_mode[port])
   {
-    if (port == 0)
-    {
-      waiting_for_lisa_to_read_port_b = 1;
-    }
-    // ALERT_LOG(0,"---vvv---------------------------------------------------------------------------------------------------------------");
-    // fliflo_dump(stderr,&SCC_READ[0],"BEFORE get from queue");
-    fliflo_buff_add(&SCC_READ[port], (uint8)(data)&scc_bits_per_char_mask[port]);
-    RX_CHAR_AVAILABLE(port);
-    DEBUG_LOG(0, "Received 0x%02x (%d) %c from scc port:%d (mask:%02x) serial_b fliflo size is:%d",
-              (uint8)(data), data,
-              ((data > 31) ? ((uint8)(data)) : '.'),
-              port, scc_bits_per_char_mask[0],
-              fliflo_buff_size(&SCC_READ[0]));
-    // fliflo_dump(stderr,&SCC_READ[0],"AFTER buff_add to queue");
-    // ALERT_LOG(0,"----^^^-------------------------------------------------------------------------------------------------------------");
+  case SCC_RX_UNLIMITED:
+    return 1;
+  case SCC_RX_BAUD:
+    return cpu68k_clocks >= scc_rx_next[port];
+  default:
+    if (port == 0 && waiting_for_lisa_to_read_port_b)
+      return 0;
+    if (port == 0 && (cpu68k_clocks - port_b_last_lisa_read_clock_timestamp < SCC_MIN_CYCLES_BETWEEN_READS))
+      return 0;
+    return 1;
   }
 }
 
-void read_port_if_ready_pty(unsigned int port)
+static void rx_fifo_add(unsigned int port, uint8 data)
 {
-  if (fliflo_buff_is_full(&SCC_READ[port]))
-    return;
-  if (port == 0 && waiting_for_lisa_to_read_port_b)
-    return;
-  if (port == 0 && (cpu68k_clocks - port_b_last_lisa_read_clock_timestamp < SCC_MIN_CYCLES_BETWEEN_READS))
-    return;
-  char data = read_serial_port_pty(port);
-  if (data != -1)
+  if (scc_rx_mode[port] == SCC_RX_BAUD)
   {
-    if (port == 0)
-    {
-      waiting_for_lisa_to_read_port_b = 1;
-    }
-    // ALERT_LOG(0,"---vvv---------------------------------------------------------------------------------------------------------------");
-    // fliflo_dump(stderr,&SCC_READ[0],"BEFORE get from queue");
-    fliflo_buff_add(&SCC_READ[port], (uint8)(data)&scc_bits_per_char_mask[port]);
-    rx_char_available(port);
-    ALERT_LOG(0, "Received %c (%d) on scc port:%d (mask:%02x) ; new fliflo size is:%d",
-              data, data,
-              port, scc_bits_per_char_mask[0],
-              fliflo_buff_size(&SCC_READ[0]));
-    // fliflo_dump(stderr,&SCC_READ[0],"AFTER buff_add to queue");
-    // ALERT_LOG(0,"----^^^-------------------------------------------------------------------------------------------------------------");
+    // if the line went idle, the next character starts now, otherwise it follows the previous
+    // one, so a late poll catches up until the FIFO fills rather than losing time.
+    if (scc_rx_next[port] + rx_char_time(port) < cpu68k_clocks)
+      scc_rx_next[port] = cpu68k_clocks;
+    scc_rx_next[port] += rx_char_time(port);
   }
+  else if (scc_rx_mode[port] == SCC_RX_ONEBYTE && port == 0)
+    waiting_for_lisa_to_read_port_b = 1;
+
+  fliflo_buff_add(&SCC_READ[port], data & scc_bits_per_char_mask[port]);
+  RX_CHAR_AVAILABLE(port);
+  DEBUG_LOG(0, "Received 0x%02x %c from scc port:%d (mask:%02x) serial fliflo size is:%d",
+            data, ((data > 31) ? data : '.'),
+            port, scc_bits_per_char_mask[port],
+            fliflo_buff_size(&SCC_READ[port]));
 }
 
-void read_port_if_ready_terminal(unsigned int port)
+// SCC_RX_BAUD: if there's more on the line, wake up when the next character is due.
+static void rx_schedule(unsigned int port, int pending)
 {
-  if (fliflo_buff_is_full(&SCC_READ[port]))
-    return;
-  if (port == 0 && waiting_for_lisa_to_read_port_b)
-    return;
-  if (port == 0 && (cpu68k_clocks - port_b_last_lisa_read_clock_timestamp < SCC_MIN_CYCLES_BETWEEN_READS))
+  XTIMER *event = port ? &z8530_rxa_event : &z8530_rxb_event;
+
+  if (scc_rx_mode[port] != SCC_RX_BAUD || !pending || fliflo_buff_is_full(&SCC_READ[port]))
     return;
-  if (fliflo_buff_has_data(&SCC_READ[port]))
-    RX_CHAR_AVAILABLE(port);
+  if (*event == -1 || scc_rx_next[port] < *event)
+    *event = MAX(scc_rx_next[port], cpu68k_clocks + 1);
 }
 
-void read_port_if_ready_tty(unsigned int port)
+// telnetd, shell, pty and tty: the serial I/O thread has already read what the host sent into
+// its ring, so this just moves it into the rx fliflo as fast as scc_rx_mode allows.
+void read_port_if_ready_host(unsigned int port)
 {
-  if (fliflo_buff_is_full(&SCC_READ[port]))
-    return;
-  if (port == 0 && waiting_for_lisa_to_read_port_b)
-    return;
-  if (port == 0 && (cpu68k_clocks - port_b_last_lisa_read_clock_timestamp < SCC_MIN_CYCLES_BETWEEN_READS))
-    return;
-  char data = read_serial_port_tty(port);
-  if (data != -1)
-  {
-    if (port == 0)
-    {
-      waiting_for_lisa_to_read_port_b = 1;
-    }
-    fliflo_buff_add(&SCC_READ[port], (uint8)(data)&scc_bits_per_char_mask[port]);
-    RX_CHAR_AVAILABLE(port);
-    ALERT_LOG(0, "Received 0x%02x (%d) %c from scc port:%d (mask:%02x) serial_b fliflo size is:%d",
-              (uint8)(data), data,
-              ((data > 31) ? ((uint8)(data)) : '.'),
-              port, scc_bits_per_char_mask[0],
-              fliflo_buff_size(&SCC_READ[0]));
-    ALERT_LOG(0, "----^^^-------------------------------------------------------------------------------------------------------------");
-  }
+  int data;
+
+  while (rx_fifo_ready(port) && (data = scc_io_getc(port)) >= 0)
+    rx_fifo_add(port, (uint8)data);
+
+  rx_schedule(port, scc_io_rx_pending(port));
 }
 
-void read_port_if_ready_telnetd(unsigned int port)
+// serial mux: the same, but a capture being replayed feeds bytes in as the Lisa's clock reaches
+// them, so wake up then too.
+void read_port_if_ready_mux(unsigned int port)
 {
-  if (fliflo_buff_is_full(&SCC_READ[port]))
-    return;
-  if (port == 0 && waiting_for_lisa_to_read_port_b)
-    return;
-  if (port == 0 && (cpu68k_clocks - port_b_last_lisa_read_clock_timestamp < SCC_MIN_CYCLES_BETWEEN_READS))
+  XTIMER *event = port ? &z8530_rxa_event : &z8530_rxb_event;
+  XTIMER due;
+  int data;
+
+  while (rx_fifo_ready(port) && (data = scc_mux_getc(port)) >= 0)
+    rx_fifo_add(port, (uint8)data);
+
+  rx_schedule(port, scc_mux_rx_pending(port));
+  due = scc_mux_replay_due(port);
+  if (due > cpu68k_clocks && (*event == -1 || due < *event))
+    *event = due;
+}
+
+// terminal window: what was typed or uploaded waits in SCC_LINE.
+void read_port_if_ready_terminal(unsigned int port)
+{
+  while (rx_fifo_ready(port) && fliflo_buff_has_data(&SCC_LINE[port]))
+    rx_fifo_add(port, fliflo_buff_get(&SCC_LINE[port]));
+
+  rx_schedule(port, fliflo_buff_has_data(&SCC_LINE[port]));
+}
+
+// for z8530-terminal.cpp, the other end of the terminal window's line.  Only ports A and B are
+// Z8530 channels.
+int scc_line_is_full(int port)
+{
+  if (port < 0 || port > 1 || !scc_fifos_allocated)
+    return 1;
+  return fliflo_buff_is_full(&SCC_LINE[port]);
+}
+
+void scc_line_add(int port, uint8 data)
+{
+  if (scc_line_is_full(port))
     return;
-  char data = poll_telnet_serial_read(port);
-  if (data != -1)
-  {
-    if (port == 0)
-    {
-      waiting_for_lisa_to_read_port_b = 1;
-    }
-    fliflo_buff_add(&SCC_READ[port], (uint8)(data)&scc_bits_per_char_mask[port]);
-    RX_CHAR_AVAILABLE(port);
-    DEBUG_LOG(0, "Received %02x %c from scc port:%d (mask:%02x) serial fliflo size is:%d",
-              (uint8)(data),
-              ((data > 31) ? ((uint8)(data)) : '.'),
-              port, scc_bits_per_char_mask[port],
-              fliflo_buff_size(&SCC_READ[port]));
-    // fliflo_dump(stderr,&SCC_READ[0],"added to queue");
-    // ALERT_LOG(0,"-----------------------------------------------");
-  }
+  fliflo_buff_add(&SCC_LINE[port], data);
+}
+
+// z8530_rx?_event expired: clock in whatever's due.  If that gave the FIFO a character, come back
+// right away so the receive IRQ is seen now rather than at the next unrelated timer.
+void scc_rx_timer(unsigned int port)
+{
+  XTIMER *event = port ? &z8530_rxa_event : &z8530_rxb_event;
+  uint32 before = fliflo_buff_size(&SCC_READ[port]);
+
+  scc_fn[port].read_port_if_ready(port);
+
+  if (fliflo_buff_size(&SCC_READ[port]) > before && scc_w[port].s.wr1.r.rxintmode)
+    if (*event == -1 || *event > cpu68k_clocks + 1)
+      *event = cpu68k_clocks + 1;
 }
 
 // can't allow actual scc connection to a live device such as pty which might send output
@@ -599,7 +635,7 @@ void initialize_scc(int actual)
     DEBUG_LOG(0, "Allocating FIFO's");
     // TO DO: The serial receiving code in this file is written so that we "feed" 1 byte at a time to the Lisa software, and then wait for Lisa to "get it".
     // Hence this buffer is an overkill. The code could be simplified to use a single byte variable for each port. Same for sending.
-    if (fliflo_buff_create(&SCC_READ[0], SCC_BUFFER_SIZE))
+    if (fliflo_buff_create(&SCC_READ[0], SCC_RX_FIFO_SIZE))
     {
       EXIT(404, 0, "Out of memory!");
     }
@@ -607,7 +643,7 @@ void initialize_scc(int actual)
     {
       EXIT(405, 0, "Out of memory!");
     }
-    if (fliflo_buff_create(&SCC_READ[1], SCC_BUFFER_SIZE))
+    if (fliflo_buff_create(&SCC_READ[1], SCC_RX_FIFO_SIZE))
     {
       EXIT(406, 0, "Out of memory!");
     }
@@ -615,6 +651,10 @@ void initialize_scc(int actual)
     {
       EXIT(407, 0, "Out of memory!");
     }
+    if (fliflo_buff_create(&SCC_LINE[0], SCC_LINE_BUFFER_SIZE) || fliflo_buff_create(&SCC_LINE[1], SCC_LINE_BUFFER_SIZE))
+    {
+      EXIT(408, 0, "Out of memory!");
+    }
     scc_fifos_allocated = 1;
 
     for (i = 0; i < 18; i++)
@@ -628,6 +668,9 @@ void initialize_scc(int actual)
     waiting_for_lisa_to_read_port_b = 0;
     port_b_last_lisa_read_clock_timestamp = 0;
     total_scc_received_chars = 0;
+    scc_rx_next[0] = scc_rx_next[1] = 0;
+    scc_rx_char_time[0] = scc_rx_char_time[1] = 0;
+    z8530_rxb_event = z8530_rxa_event = -1;
 
     // set handlers to default methods
     scc_fn[0].set_dtr = set_dtr;                         //   void (*set_dtr)(unsigned int port, uint8 value);
@@ -711,30 +754,36 @@ void initialize_scc(int actual)
     case SCC_TELNETD:
       scc_fn[port].read_serial_port = read_serial_port_telnetd;
       scc_fn[port].write_serial_port = write_serial_port_telnetd;
-      scc_fn[port].read_port_if_ready = read_port_if_ready_telnetd;
+      scc_fn[port].read_port_if_ready = read_port_if_ready_host;
       break;
 
     case SCC_SHELL:
       scc_fn[port].read_serial_port = read_serial_port_shell;
       scc_fn[port].write_serial_port = write_serial_port_shell;
-      scc_fn[port].read_port_if_ready = read_port_if_ready_shell;
+      scc_fn[port].read_port_if_ready = read_port_if_ready_host;
       break;
 
     case SCC_PTY:
       // "read_serial_port" is never invoked. TO DO: clean up this unused code:
       //scc_fn[port].read_serial_port = read_serial_port_pty;
       scc_fn[port].write_serial_port = write_serial_port_pty;
-      scc_fn[port].read_port_if_ready = read_port_if_ready_pty;
+      scc_fn[port].read_port_if_ready = read_port_if_ready_host;
       scc_fn[port].set_dtr = set_dtr_pty;
       break;
 
     case SCC_TTY:
       scc_fn[port].read_serial_port = read_serial_port_tty;
       scc_fn[port].write_serial_port = write_serial_port_tty;
-      scc_fn[port].read_port_if_ready = read_port_if_ready_tty;
+      scc_fn[port].read_port_if_ready = read_port_if_ready_host;
       scc_fn[port].set_baud_rate = set_port_baud_tty;
 
       break;
+
+    case SCC_MUX:
+      scc_fn[port].write_serial_port = write_serial_port_mux;
+      scc_fn[port].read_port_if_ready = read_port_if_ready_mux;
+      scc_fn[port].set_dtr = set_dtr_mux;
+      break;
     case SCC_TERMINAL:
       scc_fn[port].read_serial_port = read_serial_port_terminal;
       scc_fn[port].write_serial_port = write_serial_port_terminal;
@@ -1259,6 +1308,8 @@ void lisa_wb_Oxd200_sccz8530(uint32 address, uint8 data)
   scc_w[0].s.wr0.r.reg = 0; // reset register pointer back to zero for next round.
   scc_w[1].s.wr0.r.reg = 0; // reset register pointer back to zero for next round.
 
+  scc_rx_char_time[port] = 0; // framing or baud rate may be changing
+
   switch (regnum)
   {
   case 0:
@@ -1702,6 +1753,8 @@ uint8 lisa_rb_Oxd200_sccz8530(uint32 address)
           waiting_for_lisa_to_read_port_b = 0; // reset this flag, since Lisa just read a char from the fliflo buffer.
           port_b_last_lisa_read_clock_timestamp = cpu68k_clocks;
         }
+        if (scc_rx_mode[port] != SCC_RX_ONEBYTE)
+          scc_fn[port].read_port_if_ready(port); // refill the FIFO, or schedule the next character
       }
       else
       {
@@ -1758,22 +1811,14 @@ uint8 lisa_rb_Oxd200_sccz8530(uint32 address)
     // need to insert other pollers here for polled I/O
     // poll_telnet_serial_read(port);
 #ifndef __MSVCRT__
-      if (serial_b == SCC_TELNETD)
-        read_port_if_ready_telnetd(0);
-      if (serial_a == SCC_TELNETD)
-        read_port_if_ready_telnetd(1);
-      if (serial_b == SCC_SHELL)
-        read_port_if_ready_shell(0);
-      if (serial_a == SCC_SHELL)
-        read_port_if_ready_shell(1);
-      if (serial_b == SCC_PTY)
-        read_port_if_ready_pty(0);
-      if (serial_a == SCC_PTY)
-        read_port_if_ready_pty(1);
-      if (serial_b == SCC_TTY)
-        read_port_if_ready_tty(0);
-      if (serial_a == SCC_TTY)
-        read_port_if_ready_tty(1);
+      if (serial_b == SCC_TELNETD || serial_b == SCC_SHELL || serial_b == SCC_PTY || serial_b == SCC_TTY)
+        read_port_if_ready_host(0);
+      if (serial_a == SCC_TELNETD || serial_a == SCC_SHELL || serial_a == SCC_PTY || serial_a == SCC_TTY)
+        read_port_if_ready_host(1);
+      if (serial_b == SCC_MUX)
+        read_port_if_ready_mux(0);
+      if (serial_a == SCC_MUX)
+        read_port_if_ready_mux(1);
 #endif
       if (serial_b == SCC_TERMINAL)
         read_port_if_ready_terminal(0);
@@ -1781,7 +1826,7 @@ uint8 lisa_rb_Oxd200_sccz8530(uint32 address)
         read_port_if_ready_terminal(1);
 
       scc_r[port].s.rr0.r.rx_char_available = HAS_DATA(port);
-      scc_r[port].s.rr0.r.tx_buffer_empty = fliflo_buff_is_empty(&SCC_WRITE[port]);
+      scc_r[port].s.rr0.r.tx_buffer_empty = fliflo_buff_is_empty(&SCC_WRITE[port]) && !scc_io_tx_full(port);
       scc_r[port].s.rr0.r.dcd = get_dcd(port);
       scc_r[port].s.rr0.r.cts = get_cts(port);
       scc_r[port].s.rr0.r.break_abort = get_break(port);
@@ -2315,6 +2360,8 @@ void disconnect_serial(int port)
     break;
   }
 
+  close_mux_serial_port(port);
+  scc_io_detach(port);
   scc_fn[port].read_serial_port = NULL;
   scc_fn[port].write_serial_port = NULL;
   scc_fn[port].read_port_if_ready = NULL;
@@ -310,6 +310,7 @@ int check_running_lisa_os(void)
   mouse_y_tolerance = 1;
   mouse_x_halfing_tolerance = 1;
   mouse_y_halfing_tolerance = 1;
+  mouse_abs_step = 127;
   v1 = lisa_ram_safe_getlong((uint8)1, (uint32)0x0064);
   v2 = lisa_ram_safe_getlong((uint8)1, (uint32)0x0068);
 
@@ -333,6 +334,7 @@ int check_running_lisa_os(void)
     lisa_os_mouse_y_ptr = 0x00cc00ec;
     mouse_x_tolerance = 4;
     mouse_y_tolerance = 4;
+    mouse_abs_step = 3; // accelerates larger deltas
     running_lisa_os = LISA_OFFICE_RUNNING;   
     DEBUG_LOG(0, "Lisa Office System version 1.0 or 1.2 : v1:%08x v2:%08x", v1, v2);
     return running_lisa_os;
@@ -345,6 +347,7 @@ int check_running_lisa_os(void)
     lisa_os_mouse_y_ptr = 0x00cc00f2; 
     mouse_x_tolerance = 4;
     mouse_y_tolerance = 4;
+    mouse_abs_step = 3; // accelerates larger deltas
     running_lisa_os = LISA_OFFICE_RUNNING;
     DEBUG_LOG(0, "Lisa Office System versions 2.x or 3.x : v1:%08x v2:%08x", v1, v2);
     return running_lisa_os;
@@ -419,6 +422,7 @@ int check_running_lisa_os(void)
     lisa_os_mouse_y_ptr = 0x00000082c;
     mouse_x_tolerance = 4;
     mouse_y_tolerance = 4;
+    mouse_abs_step = 3; // accelerates larger deltas
     DEBUG_LOG(0, "MacWorks v1:%08x v2:%08x", v1, v2);
     running_lisa_os = LISA_MACWORKS_RUNNING;
     return running_lisa_os;
@@ -642,7 +646,7 @@ void debugger(void)
         {
           cursor &= 0x00ffffff;
           page = cursor >> 9;
-          mt = &mmu_trans[page];
+          mt = GET_MMU_TRANS(page);
           if (mt->readfn == bad_page)
           {
             fprintf(buglog, "\n\nCurrent opcode lives inside a bad_page @ %08x\n\n", cursor);
@@ -0,0 +1,295 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*  Host input record/replay.                                                           *
+*                                                                                      *
+*  Every host input that reaches the emulated Lisa (keys, mouse, floppy insert/eject,  *
+*  the power switch, and the COPS 1/10th second clock tick) is written to a text log,  *
+*  stamped with cpu68k_clocks.  On replay, live host input is ignored and the logged   *
+*  events are injected at the exact same 68K cycle, so a run can be reproduced.        *
+*                                                                                      *
+\**************************************************************************************/
+
+/*
+ * Log format, one event per line, all numbers are hex:
+ *
+ *   LisaEm-InputLog 1
+ *   <clocks> B <10 bytes of lisa_clock>      power on - new epoch, cpu68k_clocks restarts at 0
+ *   <clocks> K <char>                        keystroke_cops
+ *   <clocks> C <keycode>                     send_cops_keycode
+ *   <clocks> A <keycode> <shift|cmd<<1|opt<<2> apple_combo_key
+ *   <clocks> D <down>                        apple_dot_down/up
+ *   <clocks> M <x> <y> <button>              add_mouse_event
+ *   <clocks> P                               presspowerswitch
+ *   <clocks> T                               decisecond_clk_tick
+ *   <clocks> I <drive> <path>                floppy_insert
+ *   <clocks> L <drive> <path>                floppy_insert_readonly
+ *   <clocks> E <drive>                       floppy_eject_button_pressed
+ *
+ * The RTC is virtualised on replay: the lisa_clock value captured at each power on is
+ * restored instead of reading the host time, and the decisecond ticks come from the log.
+ */
+
+#define IN_INPUTLOG_C
+#include <vars.h>
+
+#define INPUTLOG_MAGIC "LisaEm-InputLog 1"
+#define INPUTLOG_MAXPATH 1024
+
+static FILE *inputlog_file = NULL;
+static uint8 inputlog_mode = INPUTLOG_OFF;
+static uint8 inputlog_armed = INPUTLOG_OFF;
+static uint8 inputlog_injecting = 0;
+static char inputlog_filename[INPUTLOG_MAXPATH];
+
+// next pending event on replay
+static XTIMER next_clk = -1;
+static char next_type = 0;
+static int32 next_v[10];
+static char next_s[INPUTLOG_MAXPATH];
+
+static void inputlog_read_next(void)
+{
+  char line[INPUTLOG_MAXPATH + 64];
+  unsigned long long clk;
+  char *p, *e;
+  int n = 0, i;
+
+  next_clk = -1;
+  next_type = 0;
+
+  while (inputlog_file && fgets(line, sizeof(line), inputlog_file))
+  {
+    p = strchr(line, '\n');
+    if (p)
+      *p = 0;
+
+    if (sscanf(line, "%llx %c %n", &clk, &next_type, &n) < 2)
+      continue; // blank or garbled line
+
+    p = line + n;
+    memset(next_v, 0, sizeof(next_v));
+    for (i = 0; i < 10; i++)
+    {
+      next_v[i] = (int32)strtol(p, &e, 16);
+      if (e == p)
+        break;
+      p = e;
+      if (next_type == 'I' || next_type == 'L') // drive number, then the path is the rest of the line
+      {
+        while (*p == ' ')
+          p++;
+        strncpy(next_s, p, INPUTLOG_MAXPATH - 1);
+        next_s[INPUTLOG_MAXPATH - 1] = 0;
+        break;
+      }
+    }
+
+    next_clk = (XTIMER)clk;
+    return;
+  }
+
+  ALERT_LOG(0, "End of input log %s, back to live input.", inputlog_filename);
+  inputlog_stop();
+}
+
+static void inputlog_write(char type, int32 a, int32 b, int32 c, char *s)
+{
+  if (!inputlog_file)
+    return;
+
+  if (type == 'I' || type == 'L')
+    fprintf(inputlog_file, "%016llx %c %x %s\n", (unsigned long long)cpu68k_clocks, type, a, s ? s : "");
+  else
+    fprintf(inputlog_file, "%016llx %c %x %x %x\n", (unsigned long long)cpu68k_clocks, type, a, b, c);
+
+  fflush(inputlog_file);
+}
+
+int inputlog_record(char *filename)
+{
+  inputlog_stop();
+
+  inputlog_file = fopen(filename, "w");
+  if (!inputlog_file)
+  {
+    ALERT_LOG(0, "Could not create input log %s", filename);
+    return -1;
+  }
+
+  strncpy(inputlog_filename, filename, INPUTLOG_MAXPATH - 1);
+  fprintf(inputlog_file, "%s\n", INPUTLOG_MAGIC);
+  inputlog_armed = INPUTLOG_RECORD;
+  return 0;
+}
+
+int inputlog_replay(char *filename)
+{
+  char line[64];
+
+  inputlog_stop();
+
+  inputlog_file = fopen(filename, "r");
+  if (!inputlog_file)
+  {
+    ALERT_LOG(0, "Could not open input log %s", filename);
+    return -1;
+  }
+
+  if (!fgets(line, sizeof(line), inputlog_file) || strncmp(line, INPUTLOG_MAGIC, strlen(INPUTLOG_MAGIC)) != 0)
+  {
+    ALERT_LOG(0, "%s is not a LisaEm input log", filename);
+    fclose(inputlog_file);
+    inputlog_file = NULL;
+    return -1;
+  }
+
+  strncpy(inputlog_filename, filename, INPUTLOG_MAXPATH - 1);
+  inputlog_armed = INPUTLOG_REPLAY;
+  return 0;
+}
+
+// called once all the subsystems are initialized on power on (and on reboot), cpu68k_clocks is 0 here.
+void inputlog_poweron(void)
+{
+  uint8 *clk = (uint8 *)&lisa_clock;
+  int i;
+
+  if (inputlog_armed == INPUTLOG_OFF)
+    return;
+  inputlog_mode = inputlog_armed;
+
+  if (inputlog_mode == INPUTLOG_RECORD)
+  {
+    fprintf(inputlog_file, "%016llx B", (unsigned long long)cpu68k_clocks);
+    for (i = 0; i < 10; i++)
+      fprintf(inputlog_file, " %02x", clk[i]);
+    fprintf(inputlog_file, "\n");
+    fflush(inputlog_file);
+    return;
+  }
+
+  // replay: anything left over from the previous epoch was never reached, drop it
+  if (!next_type)
+    inputlog_read_next();
+  while (inputlog_mode == INPUTLOG_REPLAY && next_type != 'B')
+  {
+    ALERT_LOG(0, "Skipping unreached %c event at %016llx", next_type, (long long)next_clk);
+    inputlog_read_next();
+  }
+  if (inputlog_mode != INPUTLOG_REPLAY)
+    return;
+
+  for (i = 0; i < 10; i++) // restore the RTC as it was when recorded, not the host time
+    clk[i] = (uint8)next_v[i];
+
+  inputlog_read_next();
+}
+
+void inputlog_stop(void)
+{
+  if (inputlog_file)
+    fclose(inputlog_file);
+  inputlog_file = NULL;
+  inputlog_mode = INPUTLOG_OFF;
+  inputlog_armed = INPUTLOG_OFF;
+  next_clk = -1;
+  next_type = 0;
+}
+
+int inputlog_active(void) { return inputlog_mode != INPUTLOG_OFF; }
+int inputlog_replaying(void) { return inputlog_mode == INPUTLOG_REPLAY; }
+
+XTIMER inputlog_next_event(void) { return (inputlog_mode == INPUTLOG_REPLAY) ? next_clk : -1; }
+
+// Called from each host input entry point.  Returns 1 if the caller must drop the input
+// (live input while replaying), 0 if it should go ahead.
+int inputlog_event(char type, int32 a, int32 b, int32 c, char *s)
+{
+  if (inputlog_mode == INPUTLOG_OFF || inputlog_injecting)
+    return 0;
+
+  if (inputlog_mode == INPUTLOG_RECORD)
+  {
+    inputlog_write(type, a, b, c, s);
+    return 0;
+  }
+
+  return 1;
+}
+
+// inject every logged event whose time has come, the emulation loop stops executing at
+// inputlog_next_event() so these land on the same instruction boundary they were recorded on.
+void inputlog_replay_due(void)
+{
+  while (inputlog_mode == INPUTLOG_REPLAY && next_type && next_type != 'B' && next_clk <= cpu68k_clocks)
+  {
+    if (next_clk != cpu68k_clocks)
+      ALERT_LOG(0, "Replay drift: %c event due at %016llx injected at %016llx", next_type, (long long)next_clk, (long long)cpu68k_clocks);
+
+    inputlog_injecting = 1;
+    switch (next_type)
+    {
+    case 'K':
+      keystroke_cops((unsigned char)next_v[0]);
+      break;
+    case 'C':
+      send_cops_keycode(next_v[0]);
+      break;
+    case 'A':
+      apple_combo_key((uint8)next_v[0], next_v[1] & 1, (next_v[1] >> 1) & 1, (next_v[1] >> 2) & 1, "replay");
+      break;
+    case 'D':
+      if (next_v[0])
+        apple_dot_down();
+      else
+        apple_dot_up();
+      break;
+    case 'M':
+      add_mouse_event((int16)next_v[0], (int16)next_v[1], (int8)next_v[2]);
+      break;
+    case 'P':
+      presspowerswitch();
+      break;
+    case 'T':
+      decisecond_clk_tick();
+      break;
+    case 'I':
+      floppy_insert(next_s, (uint8)next_v[0]);
+      break;
+    case 'L':
+      floppy_insert_readonly(next_s, (uint8)next_v[0]);
+      break;
+    case 'E':
+      floppy_eject_button_pressed((uint8)next_v[0]);
+      break;
+    default:
+      ALERT_LOG(0, "Unknown input log event %c", next_type);
+    }
+    inputlog_injecting = 0;
+
+    inputlog_read_next();
+  }
+}
@@ -0,0 +1,309 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*  Screen hashes and screen waits for automation.                                      *
+*                                                                                      *
+*  Exact region hashes are built from per-scanline hashes which are only recomputed    *
+*  for lines the vidram write handlers marked dirty.  There is also an 8x8 average    *
+*  ("perceptual") hash for fuzzy matches and 1bpp template matching against PBMs.      *
+*  --type scripts wait on these with {waitscreen}, {waitlike} and {waitimage}, see     *
+*  keyinject.c, so test runs can sync on the screen rather than sleep, even in turbo.  *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_SCREENHASH_C
+#include <vars.h>
+
+#define FNV_OFFSET 0x811c9dc5
+#define FNV_PRIME 0x01000193
+
+static uint32 line_hash[SCREEN_MAX_LINES];
+static uint32 hashed_latch = 0xffffffff; // latch address/width the line hashes were made for
+static int hashed_xbytes = 0;
+
+static uint8 popcount8[256];
+
+static void init_popcount(void)
+{
+  int i;
+
+  if (popcount8[255])
+    return;
+  for (i = 0; i < 256; i++)
+    popcount8[i] = (i & 1) + popcount8[i >> 1];
+}
+
+static inline uint32 fnv_byte(uint32 h, uint8 b) { return (h ^ b) * FNV_PRIME; }
+
+static inline uint32 fnv_long(uint32 h, uint32 l)
+{
+  h = fnv_byte(h, (uint8)(l >> 24));
+  h = fnv_byte(h, (uint8)(l >> 16));
+  h = fnv_byte(h, (uint8)(l >> 8));
+  return fnv_byte(h, (uint8)l);
+}
+
+// return the 8 pixels starting at pixel x of line y, msb is leftmost, bits as in video ram, off screen pixels are 0
+static inline uint8 get_screen_pixels8(int x, int y)
+{
+  uint8 *line = &lisaram[videolatchaddress + y * lisa_vid_size_xbytes];
+  int bx = x >> 3, sh = x & 7;
+  uint16 w;
+
+  if (x < 0 || bx >= lisa_vid_size_xbytes)
+    return 0;
+  w = line[bx] << 8;
+  if (bx + 1 < lisa_vid_size_xbytes)
+    w |= line[bx + 1];
+  return (uint8)((w << sh) >> 8);
+}
+
+static int clip_region(int *x, int *y, int *w, int *h)
+{
+  if (!lisaram)
+    return -1;
+  if (*x < 0)
+  {
+    *w += *x;
+    *x = 0;
+  }
+  if (*y < 0)
+  {
+    *h += *y;
+    *y = 0;
+  }
+  if (*x + *w > lisa_vid_size_x)
+    *w = lisa_vid_size_x - *x;
+  if (*y + *h > lisa_vid_size_y)
+    *h = lisa_vid_size_y - *y;
+  return (*w > 0 && *h > 0) ? 0 : -1;
+}
+
+// bring the per-scanline hashes up to date, only touching lines written since the last call.
+void screen_hash_update(void)
+{
+  int y, x;
+
+  if (!lisaram)
+    return;
+
+  if (hashed_latch != videolatchaddress || hashed_xbytes != lisa_vid_size_xbytes)
+  {
+    for (y = 0; y < SCREEN_MAX_LINES; y++)
+      screen_line_dirty[y] |= SCREEN_DIRTY_HASH;
+    hashed_latch = videolatchaddress;
+    hashed_xbytes = lisa_vid_size_xbytes;
+  }
+
+  for (y = 0; y < lisa_vid_size_y; y++)
+  {
+    if (!(screen_line_dirty[y] & SCREEN_DIRTY_HASH))
+      continue;
+
+    uint8 *line = &lisaram[videolatchaddress + y * lisa_vid_size_xbytes];
+    uint32 h = FNV_OFFSET;
+    for (x = 0; x < lisa_vid_size_xbytes; x++)
+      h = fnv_byte(h, line[x]);
+    line_hash[y] = h;
+    screen_line_dirty[y] &= ~SCREEN_DIRTY_HASH;
+  }
+}
+
+uint32 screen_line_hash(int y)
+{
+  if (y < 0 || y >= lisa_vid_size_y)
+    return 0;
+  screen_hash_update();
+  return line_hash[y];
+}
+
+// Exact hash of a pixel rectangle.  Each row is hashed on its own and the row hashes are then
+// hashed together, so full width regions come straight from the cached scanline hashes.
+uint32 screen_region_hash(int x, int y, int w, int h)
+{
+  uint32 hash = FNV_OFFSET, rh;
+  int row, px;
+
+  if (clip_region(&x, &y, &w, &h))
+    return 0;
+
+  screen_hash_update();
+
+  for (row = y; row < y + h; row++)
+  {
+    if (x == 0 && w == lisa_vid_size_x)
+      rh = line_hash[row];
+    else
+    {
+      rh = FNV_OFFSET;
+      for (px = 0; px < w; px += 8)
+      {
+        uint8 b = get_screen_pixels8(x + px, row);
+        if (w - px < 8)
+          b &= (uint8)(0xff00 >> (w - px)); // mask off pixels right of the region
+        rh = fnv_byte(rh, b);
+      }
+    }
+    hash = fnv_long(hash, rh);
+  }
+
+  return hash;
+}
+
+uint32 screen_hash(void) { return screen_region_hash(0, 0, lisa_vid_size_x, lisa_vid_size_y); }
+
+// Average hash: the region is split into an 8x8 grid, each bit is set if its cell has more set
+// pixels than the average cell.  Small changes (a blinking cursor, a moved pointer) flip few bits,
+// so compare two of these with screen_phash_distance() rather than for equality.
+uint64 screen_region_phash(int x, int y, int w, int h)
+{
+  uint32 cells[64], total = 0;
+  uint64 phash = 0;
+  int row, px, i;
+
+  init_popcount();
+  if (clip_region(&x, &y, &w, &h))
+    return 0;
+
+  memset(cells, 0, sizeof(cells));
+  for (row = 0; row < h; row++)
+  {
+    int cy = (row * 8) / h;
+    for (px = 0; px < w; px += 8)
+    {
+      uint8 b = get_screen_pixels8(x + px, y + row);
+      if (w - px < 8)
+        b &= (uint8)(0xff00 >> (w - px));
+      cells[cy * 8 + (px * 8) / w] += popcount8[b];
+    }
+  }
+
+  for (i = 0; i < 64; i++)
+    total += cells[i];
+  for (i = 0; i < 64; i++)
+    if (cells[i] * 64 > total)
+      phash |= ((uint64)1) << i;
+
+  return phash;
+}
+
+int screen_phash_distance(uint64 a, uint64 b)
+{
+  uint64 d = a ^ b;
+  int count = 0;
+
+  while (d)
+  {
+    d &= d - 1;
+    count++;
+  }
+  return count;
+}
+
+// Compare a 1bpp template (msb leftmost, same bit sense as video ram, stride bytes per row) against the screen at x,y.
+// Returns the number of differing pixels, or -1 if it doesn't fit on the screen.
+int screen_match_template(int x, int y, int tw, int th, uint8 *bits, int stride)
+{
+  int row, px, diff = 0;
+
+  if (!lisaram || !bits || x < 0 || y < 0 || x + tw > lisa_vid_size_x || y + th > lisa_vid_size_y)
+    return -1;
+
+  init_popcount();
+
+  for (row = 0; row < th; row++)
+    for (px = 0; px < tw; px += 8)
+    {
+      uint8 d = get_screen_pixels8(x + px, y + row) ^ bits[row * stride + (px >> 3)];
+      if (tw - px < 8)
+        d &= (uint8)(0xff00 >> (tw - px));
+      diff += popcount8[d];
+    }
+
+  return diff;
+}
+
+// Slide a template over a screen rectangle looking for the best match with no more than maxdiff
+// differing pixels.  Returns the pixel difference of the best match and its position, or -1.
+int screen_find_template(int rx, int ry, int rw, int rh, int tw, int th, uint8 *bits, int stride, int maxdiff,
+                         int *foundx, int *foundy)
+{
+  int x, y, d, best = -1;
+
+  if (clip_region(&rx, &ry, &rw, &rh))
+    return -1;
+
+  for (y = ry; y + th <= ry + rh; y++)
+    for (x = rx; x + tw <= rx + rw; x++)
+    {
+      d = screen_match_template(x, y, tw, th, bits, stride);
+      if (d < 0 || d > maxdiff || (best >= 0 && d >= best))
+        continue;
+      best = d;
+      if (foundx)
+        *foundx = x;
+      if (foundy)
+        *foundy = y;
+      if (!best)
+        return 0; // can't do better than exact
+    }
+
+  return best;
+}
+
+// Load a binary (P4) PBM as a template for the above, 1 is black and msb first as in video ram,
+// so a crop of a lisa-shm-view snapshot will do.  Returns the bits, free() them when done.
+uint8 *screen_load_template(const char *file, int *tw, int *th, int *stride)
+{
+  FILE *f = fopen(file, "rb");
+  uint8 *bits;
+  int w, h;
+
+  if (!f)
+  {
+    fprintf(stderr, "Can't open template %s\n", file);
+    return NULL;
+  }
+  if (fscanf(f, "P4 %d %d", &w, &h) != 2 || w <= 0 || h <= 0 || w > 4096 || h > 4096 ||
+      fgetc(f) == EOF)
+  {
+    fprintf(stderr, "%s isn't a binary PBM\n", file);
+    fclose(f);
+    return NULL;
+  }
+
+  *stride = (w + 7) / 8;
+  bits = (uint8 *)malloc(*stride * h);
+  if (bits && fread(bits, *stride, h, f) != (size_t)h)
+  {
+    fprintf(stderr, "%s is short\n", file);
+    free(bits);
+    bits = NULL;
+  }
+  fclose(f);
+  *tw = w;
+  *th = h;
+  return bits;
+}
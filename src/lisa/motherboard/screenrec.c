@@ -0,0 +1,273 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*  Screen recorder.                                                                    *
+*                                                                                      *
+*  Records the native 1bpp frame at each vertical retrace.  Only the lines the vidram  *
+*  write handlers flagged are looked at; they're XORed against the previous frame and  *
+*  the changed band is written as an LZ4 block, with a keyframe every few seconds.     *
+*  A static desktop costs nothing but the keyframes.  The format is in screenrec.h,    *
+*  src/tools/src/lisa-screenrec-to-gif.c turns recordings into GIFs or PBM streams.    *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_SCREENREC_C
+#include <vars.h>
+#include <screenrec.h>
+
+#define SCREENREC_KEY_INTERVAL (10 * (XTIMER)ONE_SECOND)
+
+#define LZ4_HASHLOG 12
+#define LZ4_MINMATCH 4
+#define LZ4_MFLIMIT 12    // a match may not start in the last 12 bytes of a block
+#define LZ4_LASTLITERALS 5 // and the last 5 bytes are always literals
+
+static FILE *rec_file = NULL;
+static char rec_filename[1024];
+
+static uint8 rec_prev[SCREENREC_MAX_FRAME]; // frame as of the last record
+static uint8 rec_band[SCREENREC_MAX_FRAME];
+static uint8 rec_lz4[SCREENREC_LZ4_BOUND(SCREENREC_MAX_FRAME)];
+static int32 lz4_table[1 << LZ4_HASHLOG];
+
+static int rec_width, rec_height, rec_xbytes;
+static uint32 rec_latch;
+static uint8 rec_needkey;
+static XTIMER rec_base, rec_lastclk, rec_lastkey;
+static uint64 rec_bytes, rec_records;
+
+static inline uint32 read32(const uint8 *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32)p[3] << 24); }
+
+static uint8 *lz4_length(uint8 *op, int len)
+{
+  for (len -= 15; len >= 255; len -= 255)
+    *op++ = 255;
+  *op++ = (uint8)len;
+  return op;
+}
+
+// Greedy LZ4 block compressor - enough for mostly blank XOR bands, which are long zero runs.
+// Blocks are at most 32K so every earlier position is a valid 16 bit offset.
+static int lz4_compress(const uint8 *src, int len, uint8 *dst)
+{
+  const uint8 *ip = src, *anchor = src, *end = src + len;
+  const uint8 *mflimit = end - LZ4_MFLIMIT, *matchlimit = end - LZ4_LASTLITERALS;
+  uint8 *op = dst, *token;
+  int i, litlen, mlen;
+
+  for (i = 0; i < (1 << LZ4_HASHLOG); i++)
+    lz4_table[i] = -1;
+
+  while (len > LZ4_MFLIMIT && ip < mflimit)
+  {
+    uint32 seq = read32(ip);
+    uint32 h = (seq * 2654435761U) >> (32 - LZ4_HASHLOG);
+    int32 ref = lz4_table[h];
+    const uint8 *match, *mp;
+
+    lz4_table[h] = (int32)(ip - src);
+    if (ref < 0 || read32(src + ref) != seq)
+    {
+      ip++;
+      continue;
+    }
+
+    match = src + ref;
+    for (mp = ip + LZ4_MINMATCH; mp < matchlimit && *mp == match[mp - ip];)
+      mp++;
+
+    litlen = (int)(ip - anchor);
+    mlen = (int)(mp - ip) - LZ4_MINMATCH;
+    token = op++;
+    *token = (uint8)((MIN(litlen, 15) << 4) | MIN(mlen, 15));
+    if (litlen >= 15)
+      op = lz4_length(op, litlen);
+    memcpy(op, anchor, litlen);
+    op += litlen;
+    *op++ = (uint8)((ip - match) & 0xff);
+    *op++ = (uint8)((ip - match) >> 8);
+    if (mlen >= 15)
+      op = lz4_length(op, mlen);
+
+    ip = anchor = mp;
+  }
+
+  litlen = (int)(end - anchor);
+  token = op++;
+  *token = (uint8)(MIN(litlen, 15) << 4);
+  if (litlen >= 15)
+    op = lz4_length(op, litlen);
+  memcpy(op, anchor, litlen);
+  op += litlen;
+
+  return (int)(op - dst);
+}
+
+static void put16(uint8 *p, uint32 v)
+{
+  p[0] = (uint8)(v >> 8);
+  p[1] = (uint8)v;
+}
+
+static void put32(uint8 *p, uint32 v)
+{
+  put16(p, v >> 16);
+  put16(p + 2, v);
+}
+
+static void write_record(char type, int first, int nlines, XTIMER clocks)
+{
+  uint8 hdr[SCREENREC_HEADER_SIZE];
+  int len = nlines * rec_xbytes, clen;
+  uint8 *data = rec_lz4;
+
+  clen = lz4_compress(rec_band, len, rec_lz4);
+  hdr[1] = 0;
+  if (clen >= len) // noise, don't bother
+  {
+    clen = len;
+    data = rec_band;
+    hdr[1] = SCREENREC_RAW;
+  }
+
+  hdr[0] = (uint8)type;
+  put16(&hdr[2], rec_width);
+  put16(&hdr[4], rec_height);
+  put16(&hdr[6], rec_xbytes);
+  put16(&hdr[8], first);
+  put16(&hdr[10], nlines);
+  put32(&hdr[12], (uint32)((uint64)clocks >> 32));
+  put32(&hdr[16], (uint32)clocks);
+  put32(&hdr[20], clen);
+
+  if (fwrite(hdr, SCREENREC_HEADER_SIZE, 1, rec_file) != 1 || fwrite(data, clen, 1, rec_file) != 1)
+  {
+    ALERT_LOG(0, "Error writing screen recording %s, stopping it.", rec_filename);
+    screenrec_stop();
+    return;
+  }
+  rec_bytes += SCREENREC_HEADER_SIZE + clen;
+  rec_records++;
+}
+
+int screenrec_start(char *filename)
+{
+  screenrec_stop();
+
+  rec_file = fopen(filename, "wb");
+  if (!rec_file)
+  {
+    ALERT_LOG(0, "Could not create screen recording %s", filename);
+    return -1;
+  }
+  fwrite(SCREENREC_MAGIC, strlen(SCREENREC_MAGIC), 1, rec_file);
+
+  strncpy(rec_filename, filename, sizeof(rec_filename) - 1);
+  rec_needkey = 1;
+  rec_lastclk = cpu68k_clocks;
+  rec_base = -cpu68k_clocks; // timestamps start at 0
+  rec_lastkey = 0;
+  rec_bytes = rec_records = 0;
+  return 0;
+}
+
+void screenrec_stop(void)
+{
+  if (!rec_file)
+    return;
+  fclose(rec_file);
+  rec_file = NULL;
+  ALERT_LOG(0, "Screen recording %s: %lld records, %lld bytes", rec_filename, (long long)rec_records, (long long)rec_bytes);
+}
+
+int screenrec_active(void) { return rec_file != NULL; }
+
+// Vertical retrace: record whatever changed since the last frame.
+void screenrec_retrace(void)
+{
+  XTIMER now;
+  uint8 *screen;
+  int y, i, first = -1, last = -1, size;
+
+  if (!rec_file || !lisaram)
+    return;
+
+  if (cpu68k_clocks < rec_lastclk) // power cycled or rebooted, the clock started over
+  {
+    rec_base += rec_lastclk;
+    rec_needkey = 1;
+  }
+  rec_lastclk = cpu68k_clocks;
+  now = rec_base + cpu68k_clocks;
+
+  screen = &lisaram[videolatchaddress];
+  size = lisa_vid_size_xbytes * lisa_vid_size_y;
+  if (size > SCREENREC_MAX_FRAME)
+    return;
+
+  if (rec_needkey || rec_latch != videolatchaddress || rec_width != lisa_vid_size_x || rec_height != lisa_vid_size_y ||
+      now - rec_lastkey >= SCREENREC_KEY_INTERVAL)
+  {
+    rec_width = lisa_vid_size_x;
+    rec_height = lisa_vid_size_y;
+    rec_xbytes = lisa_vid_size_xbytes;
+    rec_latch = videolatchaddress;
+    rec_needkey = 0;
+    rec_lastkey = now;
+
+    for (y = 0; y < SCREEN_MAX_LINES; y++)
+      screen_line_dirty[y] &= ~SCREEN_DIRTY_REC;
+    memcpy(rec_prev, screen, size);
+    memcpy(rec_band, screen, size);
+    write_record(SCREENREC_KEYFRAME, 0, rec_height, now);
+    return;
+  }
+
+  for (y = 0; y < rec_height; y++)
+    if (screen_line_dirty[y] & SCREEN_DIRTY_REC)
+    {
+      screen_line_dirty[y] &= ~SCREEN_DIRTY_REC;
+      if (first < 0)
+        first = y;
+      last = y;
+    }
+  if (first < 0)
+    return;
+
+  // lines get rewritten with what they already held all the time, trim the band to what really changed
+  while (first <= last && !memcmp(&rec_prev[first * rec_xbytes], &screen[first * rec_xbytes], rec_xbytes))
+    first++;
+  while (last >= first && !memcmp(&rec_prev[last * rec_xbytes], &screen[last * rec_xbytes], rec_xbytes))
+    last--;
+  if (first > last)
+    return;
+
+  for (i = first * rec_xbytes; i < (last + 1) * rec_xbytes; i++)
+  {
+    rec_band[i - first * rec_xbytes] = rec_prev[i] ^ screen[i];
+    rec_prev[i] = screen[i];
+  }
+  write_record(SCREENREC_DELTA, first, last - first + 1, now);
+}
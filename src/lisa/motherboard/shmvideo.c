@@ -0,0 +1,256 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+*                                                                                      *
+*  Shared memory framebuffer export.                                                   *
+*                                                                                      *
+*  Lisa RAM is allocated inside a POSIX shared memory segment behind a small header,   *
+*  so external viewers, recorders and dashboards can watch the screen of any number    *
+*  of (headless) instances without the emulator copying anything.  At each vertical    *
+*  retrace the header's sequence counter, video latch and per-line change map are      *
+*  published.  The layout is in shmvideo.h.                                            *
+*                                                                                      *
+*  Without an export name lisaram is a private anonymous mapping instead.  Either way  *
+*  the host only commits the 4K pages that get written to, so the reservation above    *
+*  the RAM the Lisa actually has costs nothing.                                        *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_SHMVIDEO_C
+#include <vars.h>
+#include <shmvideo.h>
+
+#ifndef __MSVCRT__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SHMVIDEO_MAXNAME 256
+
+static char shm_name[SHMVIDEO_MAXNAME];
+static shmvideo_header *shm_hdr = NULL;
+static size_t shm_size = 0;
+static uint32 published_latch = 0xffffffff;
+static uint8 *anon_ram = NULL;
+static size_t anon_size = 0;
+// Private, demand paged lisaram for when there's no export name.  MAP_NORESERVE so the part of
+// the reservation that's never written doesn't count against overcommit.
+static uint8 *alloc_anon_ram(uint32 size)
+{
+#ifndef __MSVCRT__
+  void *m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+  if (m != MAP_FAILED)
+  {
+    anon_ram = (uint8 *)m;
+    anon_size = size;
+    return anon_ram;
+  }
+  ALERT_LOG(0, "Could not map %d bytes for lisaram: %s, using malloc", (int)size, strerror(errno));
+#endif
+  return (uint8 *)calloc(1, size);
+}
+
+// Ask for lisaram to be exported under this name (i.e. /lisaem-1) the next time it's allocated.
+int shmvideo_open(char *name)
+{
+#ifdef __MSVCRT__
+  ALERT_LOG(0, "Shared memory video export is not available on this platform, ignoring %s", name);
+  return -1;
+#else
+  if (!name || !*name)
+    return -1;
+
+  if (name[0] == '/')
+    snprintf(shm_name, SHMVIDEO_MAXNAME, "%s", name);
+  else
+    snprintf(shm_name, SHMVIDEO_MAXNAME, "/%s", name);
+  return 0;
+#endif
+}
+
+int shmvideo_active(void) { return shm_hdr != NULL; }
+
+// Allocate lisaram.  Without an export name this is an anonymous mapping, otherwise the ram lives
+// in the shared segment, which is kept across reboots and only re-created if it needs to grow.
+// Either way it may hold anything, use shmvideo_power_up_ram() to get a powered up state.
+uint8 *shmvideo_alloc_ram(uint32 size)
+{
+#ifndef __MSVCRT__
+  int fd;
+  size_t want = SHMVIDEO_HEADER_SIZE + size;
+
+  if (!shm_name[0])
+    return alloc_anon_ram(size);
+
+  if (shm_hdr && shm_size >= want)
+  {
+    shm_hdr->flags |= SHMVIDEO_RUNNING;
+    return SHMVIDEO_RAM(shm_hdr);
+  }
+  shmvideo_close();
+
+  fd = shm_open(shm_name, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+  {
+    ALERT_LOG(0, "Could not create shared memory segment %s: %s", shm_name, strerror(errno));
+    shm_name[0] = 0;
+    return alloc_anon_ram(size);
+  }
+
+  if (ftruncate(fd, (off_t)want) < 0 ||
+      (shm_hdr = (shmvideo_header *)mmap(NULL, want, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    ALERT_LOG(0, "Could not map shared memory segment %s: %s", shm_name, strerror(errno));
+    close(fd);
+    shm_unlink(shm_name);
+    shm_hdr = NULL;
+    shm_name[0] = 0;
+    return alloc_anon_ram(size);
+  }
+  close(fd);
+
+  shm_size = want;
+  memset(shm_hdr, 0, SHMVIDEO_HEADER_SIZE);
+  shm_hdr->header_size = SHMVIDEO_HEADER_SIZE;
+  shm_hdr->ram_size = size;
+  shm_hdr->version = SHMVIDEO_VERSION;
+  shm_hdr->pid = (uint32)getpid();
+  shm_hdr->flags = SHMVIDEO_RUNNING;
+  published_latch = 0xffffffff;
+  __sync_synchronize();
+  shm_hdr->magic = SHMVIDEO_MAGIC; // last, so a viewer never sees a half built header
+
+  ALERT_LOG(0, "Exporting Lisa video in shared memory segment %s (%d bytes)", shm_name, (int)want);
+  return SHMVIDEO_RAM(shm_hdr);
+#else
+  return alloc_anon_ram(size);
+#endif
+}
+
+void shmvideo_free_ram(uint8 *mem)
+{
+  if (!mem)
+    return;
+  if (shm_hdr && mem == SHMVIDEO_RAM(shm_hdr))
+  {
+    shm_hdr->flags &= ~SHMVIDEO_RUNNING; // the segment stays put so viewers survive a reboot
+    return;
+  }
+#ifndef __MSVCRT__
+  if (mem == anon_ram)
+  {
+    munmap(anon_ram, anon_size);
+    anon_ram = NULL;
+    anon_size = 0;
+    return;
+  }
+#endif
+  free(mem);
+}
+
+// Put lisaram in its power up state, LISA_RAM_POWERUP_FF bytes of 0xff as it's always been and
+// zeros above that.  The pages are dropped rather than zeroed, so only the 0xff part gets
+// committed.  Only whole pages can be dropped, the odd bytes at either end are cleared by hand.
+void shmvideo_power_up_ram(uint8 *mem, uint32 size)
+{
+  uint32 ff = MIN(size, LISA_RAM_POWERUP_FF);
+#ifndef __MSVCRT__
+  uintptr_t pagesize = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t first = ((uintptr_t)mem + pagesize - 1) & ~(pagesize - 1);
+  uintptr_t last = ((uintptr_t)mem + size) & ~(pagesize - 1);
+  int advice = -1;
+
+  if (mem == anon_ram)
+    advice = MADV_DONTNEED; // private anonymous pages read back as zero
+#ifdef MADV_REMOVE
+  else if (shm_hdr && mem == SHMVIDEO_RAM(shm_hdr))
+    advice = MADV_REMOVE; // punches a hole in the tmpfs object
+#endif
+
+  if (advice >= 0 && first < last && !madvise((void *)first, last - first, advice))
+  {
+    memset(mem, 0, first - (uintptr_t)mem);
+    memset((void *)last, 0, (uintptr_t)mem + size - last);
+  }
+  else
+#endif
+    memset(mem, 0, size);
+  memset(mem, 0xff, ff);
+}
+
+// Called on exit - viewers that still have it mapped keep their view, the name goes away.
+void shmvideo_close(void)
+{
+#ifndef __MSVCRT__
+  if (!shm_hdr)
+    return;
+  shm_hdr->flags = 0;
+  munmap(shm_hdr, shm_size);
+  shm_unlink(shm_name);
+  shm_hdr = NULL;
+  shm_size = 0;
+#endif
+}
+
+// Vertical retrace: publish the frame.  Only the per-line flags the vidram handlers set are
+// looked at, so this is a few hundred byte tests per frame.
+void shmvideo_retrace(void)
+{
+  uint32 frame;
+  int y;
+
+  if (!shm_hdr || !lisaram)
+    return;
+
+  shm_hdr->seq++; // odd: header being updated
+  __sync_synchronize();
+
+  frame = shm_hdr->frame + 1;
+  if (published_latch != videolatchaddress || shm_hdr->xbytes != (uint32)lisa_vid_size_xbytes)
+  {
+    for (y = 0; y < SCREEN_MAX_LINES; y++)
+      screen_line_dirty[y] |= SCREEN_DIRTY_SHM;
+    published_latch = videolatchaddress;
+  }
+
+  for (y = 0; y < lisa_vid_size_y && y < SHMVIDEO_MAX_LINES; y++)
+    if (screen_line_dirty[y] & SCREEN_DIRTY_SHM)
+    {
+      shm_hdr->line_frame[y] = frame;
+      screen_line_dirty[y] &= ~SCREEN_DIRTY_SHM;
+    }
+
+  shm_hdr->video_offset = videolatchaddress;
+  shm_hdr->width = lisa_vid_size_x;
+  shm_hdr->height = lisa_vid_size_y;
+  shm_hdr->xbytes = lisa_vid_size_xbytes;
+  shm_hdr->clocks = (uint64)cpu68k_clocks;
+  shm_hdr->frame = frame;
+
+  __sync_synchronize();
+  shm_hdr->seq++; // even: consistent
+}
@@ -48,6 +48,8 @@ REASSIGN(int, mouse_x_tolerance, 0);
 REASSIGN(int, mouse_y_tolerance, 0);
 REASSIGN(int, mouse_x_halfing_tolerance, 1);
 REASSIGN(int, mouse_y_halfing_tolerance, 1);
+REASSIGN(uint8, mouse_absolute, 0);
+REASSIGN(int, mouse_abs_step, 127);
 REASSIGN(uint32, lisa_os_mouse_x_ptr, 0x486);
 REASSIGN(uint32, lisa_os_mouse_y_ptr, 0x488);
 REASSIGN(uint32, lisa_os_boot_mouse_x_ptr, 0x486);
@@ -128,6 +130,10 @@ REASSIGN(XTIMER, clktest, 0);
 REASSIGN(XTIMER, cops_event, -1);
 REASSIGN(XTIMER, tenth_sec_cycles, TENTH_OF_A_SECOND); // 10th of a second cycles.  5,000,000 cycles/sec so 500000 10ths/sec
 REASSIGN(XTIMER, z8530_event, -1);
+REASSIGN(XTIMER, z8530_rxb_event, -1);
+REASSIGN(XTIMER, z8530_rxa_event, -1);
+REASSIGN(XTIMER, keyinject_due, -1);
+REASSIGN(uint8, keyinject_draining, 0);
 REASSIGN(uint32, via_clock_diff, 2); // 2
 REASSIGN(float, via_throttle_factor, 1.0);
 REASSIGN(int, microsleep_tix, 0);
@@ -250,6 +250,13 @@ typedef int32 sint32;
 #define DIW_BYTES_PER_HLINE ((uint32)(DIW_MAX_OX / 2)) // + (3^((uint32)(DIW_MAX_OX/2)&3)) )
 #define DIW_BYTES_PER_PAGE ((iw_bytes_per_line) * DIW_MAX_OY)
 
+#define IW_BAND_ROWS 512 // rows of output kept for streamed pages, a print head pass covers about 40
+
+#define IW_GLYPH_CACHE 1024  // power of 2
+#define IW_GLYPH_XPHASES 8   // xlens repeats every 8 head columns, 160dpi to 300dpi is 8:15
+#define IW_GLYPH_MAXCOLS 76  // 19 font columns, double wide, headline
+#define IW_GLYPH_PINROWS 9   // 8 wires, one more for the low chars
+
 // These used to be defines, but they're better off as variables.
 
 #define IW_DEF_DPI (iw_def_dpi)
@@ -305,6 +312,12 @@ void ImageWriter::iw_clear_page(void)
         memset(page, 0, pagesize);
         isblank = 1;
     }
+    if (band)
+    {
+        memset(band, 0, IW_BAND_ROWS * band_bpl);
+        band_top = 0;
+        isblank = 1;
+    }
     return;
 }
 
@@ -352,7 +365,7 @@ uint8 ImageWriter::iw_pixel_iwcolor(uint16 x, uint16 y)
     uint16 color; // xbit, yline;
     uint32 pixbyte;
 
-    if (x >= DIW_MAX_OX || y >= DIW_MAX_OY)
+    if (x >= DIW_MAX_OX || y >= DIW_MAX_OY || page == NULL)
         return 255;
     if (scalex == 0.0 || xlens == NULL || ylens == NULL)
         return 255;
@@ -377,6 +390,24 @@ uint8 ImageWriter::iw_pixel_iwcolor(uint16 x, uint16 y)
     return color;
 }
 
+// add c to a 4 bit pixel, the ink saturates at 15
+static inline void iw_nibble_add(uint8 *p, int x, int c)
+{
+    int color;
+
+    p += x >> 1;
+    if (x & 1)
+    {
+        color = (*p & 0x0f) + c;
+        *p = (*p & 0xf0) | (color > 15 ? 15 : color);
+    }
+    else
+    {
+        color = (*p >> 4) + c;
+        *p = (*p & 0x0f) | ((color > 15 ? 15 : color) << 4);
+    }
+}
+
 /* This should be the most used method.  When called it increases the
    color level of a pixels. Since the IW prints bold by printing twice over the
    same pixel, this will do the trick.  */
@@ -386,6 +417,19 @@ void ImageWriter::iw_plot_pin(int16 x, int16 y, int c)
     uint16 color; // yline, color,xbit;
     int32 pixbyte;
 
+    if (band) // streamed output, rows are top down here so there's no mirroring
+    {
+        if (x < 0 || y < 0 || x >= owidth || y >= height || y < band_top)
+            return; // off the paper, or reverse fed above rows that have already gone out
+
+        if (y >= band_top + IW_BAND_ROWS)
+            iw_flush_band(y - IW_BAND_ROWS / 4, pagenum + 1);
+
+        isblank = 0;
+        iw_nibble_add(band + (y % IW_BAND_ROWS) * band_bpl, x, c);
+        return;
+    }
+
     if (x > width || y > height || page == NULL || x < 0 || y < 0)
     {
         if (debug)
@@ -715,54 +759,245 @@ void ImageWriter::iw_printchar(uint8 c)
     if (debug)
         fprintf(stdout, "Char width: %d\n", charwidth);
 
-    for (i = 0; i < livefntwidth[c]; i++)
+    if (!iw_blit_glyph(c)) // at the edge of the paper, do it the long way
     {
+        for (i = 0; i < livefntwidth[c]; i++)
+        {
 
-        j = livefont[c][i];
+            j = livefont[c][i];
+
+            if (underline)
+                j = j | 128; // handle underlines.
+            if (j > 256)
+            {
+                j = j >> 1;
+                k = 1;
+            } // low font chars (y,j,g,q,p, etc.)
+            else
+                k = 0;
+
+            if (!charwidth)
+                charwidth = 1;
+
+            for (l = 0; l < charwidth; l++)
+            {
+                iw_printbar(j, k); // plain
+                if (bold || headline)
+                {
+                    cursor--;
+                    iw_printbar(j, k);
+                } // print over the same spot if bold or headline.
+
+                // if headline, we print twice as wide.
+                if (headline)
+                {
+                    iw_printbar(j, k);
+                    cursor--;
+                    iw_printbar(j, k);
+                }
+            }
+        }
+    }
+
+    // handle spaces around proportional fonts.
+    if (fontnumber == 7)
+    {
+        for (l = 0; l <= elitespacing; l++)
+            iw_printbar(0, 0);
+    }
+    else if (propspacing)
+    {
+        for (l = 0; l <= propspacing; l++)
+            iw_printbar(0, 0);
+    }
+}
+
+/*-----------------------------------------------------------------------------------
+ * Glyph cache.  iw_printchar() strikes each font column through iw_printbar(), and
+ * every dot through iw_plot_inc()'s 5x5 kernel.  Instead, work out once how many times
+ * each pin hits each head column for a character in a given style, then run the
+ * kernel over that into two rows of output pixels per pin row: the kernel's center
+ * row, and the (identical) rows 1 and 2 above and below it.  Ink only adds up and
+ * saturates, so blitting those gives the same pixels as striking the dots one by one.
+ *
+ * Output x positions repeat every IW_GLYPH_XPHASES head columns, so a glyph is
+ * rendered per starting phase.  Output y positions don't repeat usefully, so each pin
+ * row is placed on its own ylens[] row when blitted.
+ * ---------------------------------------------------------------------------------*/
 
+iw_glyph *ImageWriter::iw_get_glyph(uint8 c)
+{
+    static const uint8 ka[5] = {1, 2, 3, 2, 1}; // iw_plot_inc()'s center row
+    static const uint8 kb[5] = {1, 1, 2, 1, 1}; // and the 2 rows either side of it
+    uint8 hits[IW_GLYPH_MAXCOLS][IW_GLYPH_PINROWS];
+    uint8 attrs, phase, *sa, *sb;
+    uint16 j;
+    uint32 h;
+    int i, k, l, b, pos, n, x, r, ow, ncols;
+    iw_glyph *g;
+
+    ncols = livefntwidth[c];
+    if (ncols < 0 || ncols > 19 || charwidth < 1 || charwidth > 2)
+        return NULL;
+
+    if (!glyphs)
+    {
+        glyphs = new iw_glyph[IW_GLYPH_CACHE];
+        memset(glyphs, 0, sizeof(iw_glyph) * IW_GLYPH_CACHE);
+    }
+
+    attrs = (underline ? 1 : 0) | (bold ? 2 : 0) | (headline ? 4 : 0);
+    phase = cursor % IW_GLYPH_XPHASES;
+
+    h = 2166136261u; // FNV-1a
+    for (i = 0; i < ncols; i++)
+        h = (h ^ (uint16)livefont[c][i]) * 16777619u;
+    h = (h ^ (ncols | (attrs << 5) | (charwidth << 8) | (phase << 10))) * 16777619u;
+    g = &glyphs[(h ^ (h >> 16)) & (IW_GLYPH_CACHE - 1)];
+
+    if (g->sa && g->ncols == ncols && g->attrs == attrs && g->charwidth == charwidth && g->phase == phase &&
+        !memcmp(g->cols, livefont[c], ncols * sizeof(int16)))
+        return g;
+
+    // strike it the way iw_printchar() does, counting hits instead of plotting them
+    memset(hits, 0, sizeof(hits));
+    pos = 0;
+    for (i = 0; i < ncols; i++)
+    {
+        j = livefont[c][i];
         if (underline)
-            j = j | 128; // handle underlines.
+            j = j | 128;
         if (j > 256)
         {
             j = j >> 1;
             k = 1;
-        } // low font chars (y,j,g,q,p, etc.)
+        }
         else
             k = 0;
-
-        if (!charwidth)
-            charwidth = 1;
+        j = (uint8)j; // iw_printbar() only takes 8 bits
 
         for (l = 0; l < charwidth; l++)
         {
-            iw_printbar(j, k); // plain
+            n = 1;
             if (bold || headline)
-            {
-                cursor--;
-                iw_printbar(j, k);
-            } // print over the same spot if bold or headline.
-
-            // if headline, we print twice as wide.
+                n++;
+            for (b = 0; b < 8; b++)
+                if (j & (1 << b))
+                    hits[pos][b + k] += n;
+            pos++;
             if (headline)
             {
-                iw_printbar(j, k);
-                cursor--;
-                iw_printbar(j, k);
+                for (b = 0; b < 8; b++)
+                    if (j & (1 << b))
+                        hits[pos][b + k] += 2;
+                pos++;
             }
         }
     }
 
-    // handle spaces around proportional fonts.
-    if (fontnumber == 7)
+    ow = pos ? xlens[phase + pos - 1] - xlens[phase] + 5 : 1;
+    sa = new uint8[IW_GLYPH_PINROWS * ow];
+    sb = new uint8[IW_GLYPH_PINROWS * ow];
+    memset(sa, 0, IW_GLYPH_PINROWS * ow);
+    memset(sb, 0, IW_GLYPH_PINROWS * ow);
+
+    delete[] g->sa;
+    delete[] g->sb;
+    g->sa = sa;
+    g->sb = sb;
+    g->rows = 0;
+    for (i = 0; i < pos; i++)
     {
-        for (l = 0; l <= elitespacing; l++)
-            iw_printbar(0, 0);
+        x = xlens[phase + i] - xlens[phase];
+        for (r = 0; r < IW_GLYPH_PINROWS; r++)
+        {
+            if (!(n = hits[i][r]))
+                continue;
+            g->rows |= 1 << r;
+            for (b = 0; b < 5; b++)
+            {
+                k = sa[r * ow + x + b] + n * ka[b];
+                sa[r * ow + x + b] = k > 15 ? 15 : k;
+                k = sb[r * ow + x + b] + n * kb[b];
+                sb[r * ow + x + b] = k > 15 ? 15 : k;
+            }
+        }
     }
-    else if (propspacing)
+
+    memcpy(g->cols, livefont[c], ncols * sizeof(int16));
+    g->ncols = ncols;
+    g->attrs = attrs;
+    g->charwidth = charwidth;
+    g->phase = phase;
+    g->advance = pos;
+    g->ow = ow;
+    return g;
+}
+
+// add a row of ink starting at output pixel x,y
+void ImageWriter::iw_blit_row(int x, int y, const uint8 *v, int n)
+{
+    uint8 *p;
+    int i;
+
+    if (!band) // the page buffer keeps its own (mirrored) addressing
     {
-        for (l = 0; l <= propspacing; l++)
-            iw_printbar(0, 0);
+        for (i = 0; i < n; i++)
+            if (v[i])
+                iw_plot_pin(x + i, y, v[i]);
+        return;
     }
+
+    if (y < 0 || y >= height || y < band_top)
+        return;
+    if (y >= band_top + IW_BAND_ROWS)
+        iw_flush_band(y - IW_BAND_ROWS / 4, pagenum + 1);
+
+    p = band + (y % IW_BAND_ROWS) * band_bpl;
+    for (i = 0; i < n; i++, x++)
+        if (v[i] && x >= 0 && x < owidth)
+        {
+            isblank = 0;
+            iw_nibble_add(p, x, v[i]);
+        }
+}
+
+// Print c from the glyph cache, returns 0 if it has to go through iw_printbar() instead.
+int ImageWriter::iw_blit_glyph(uint8 c)
+{
+    iw_glyph *g;
+    int r, x, y, ow;
+
+    if (xlens == NULL || ylens == NULL)
+        return 0;
+
+    // iw_printbar() and iw_plot_inc() wrap lines, feed pages and drop dots at the edges
+    if (cursor < 0 || linepixel < 0 || linepixel + IW_GLYPH_PINROWS - 1 > iwheight ||
+        linepixel + IW_GLYPH_PINROWS - 1 >= (int)IW_MAX_Y)
+        return 0;
+
+    if (livefntwidth[c] > 0 && !charwidth)
+        charwidth = 1;
+
+    g = iw_get_glyph(c);
+    if (!g || cursor + g->advance > (int)IW_MAX_X)
+        return 0;
+
+    x = xlens[cursor] - 2;
+    ow = g->ow;
+    for (r = 0; r < IW_GLYPH_PINROWS; r++)
+        if (g->rows & (1 << r))
+        {
+            y = ylens[linepixel + r];
+            iw_blit_row(x, y - 2, g->sb + r * ow, ow);
+            iw_blit_row(x, y - 1, g->sb + r * ow, ow);
+            iw_blit_row(x, y, g->sa + r * ow, ow);
+            iw_blit_row(x, y + 1, g->sb + r * ow, ow);
+            iw_blit_row(x, y + 2, g->sb + r * ow, ow);
+        }
+
+    cursor += g->advance;
+    return 1;
 }
 
 void ImageWriter::test(void)
@@ -810,6 +1045,26 @@ ImageWriter::~ImageWriter(void)
         delete page;
         page = NULL;
     }
+    if (band)
+    {
+        delete[] band;
+        band = NULL;
+    }
+    if (glyphs)
+    {
+        for (int i = 0; i < IW_GLYPH_CACHE; i++)
+        {
+            delete[] glyphs[i].sa;
+            delete[] glyphs[i].sb;
+        }
+        delete[] glyphs;
+        glyphs = NULL;
+    }
+    if (stream)
+    {
+        iw_stream_close(stream, 1);
+        stream = NULL;
+    }
     if (printerDC)
     {
         printerDC->EndDoc();
@@ -822,6 +1077,11 @@ void ImageWriter::EndDocument(void)
 {
 
     iw_formfeed();
+    if (stream) // finishes the PDF, the writer thread wraps up on its own
+    {
+        iw_stream_close(stream, 0);
+        stream = NULL;
+    }
     if (!printerDC)
         return;
     printerDC->EndDoc();
@@ -843,6 +1103,12 @@ ImageWriter::ImageWriter(wxWindow *parent, int outputtype, wxString outfname, in
     pagenum = 0;
     isblank = 1;
 
+    stream = NULL;
+    band = NULL;
+    glyphs = NULL;
+    band_top = 0;
+    band_inpage = 0;
+
     parentwindow = parent;
     printdialog = (wxPrintDialog *)NULL;
     printerDC = (wxDC *)NULL;
@@ -876,11 +1142,15 @@ ImageWriter::ImageWriter(wxWindow *parent, int outputtype, wxString outfname, in
         fprintf(stderr, "size:%d,%d pagesize:%d paperx,y:%f,%f\n", width, height, pagesize, paperx, papery);
     fflush(stderr);
 
-    page = new uint8[pagesize + 256]; //(uint8 *) malloc(pagesize+256);
-
     desttype = outputtype;
     destination = outfname;
 
+    band_bpl = (owidth + 1) / 2;
+    if (desttype == IW_PNG_OUT || desttype == IW_PDF_OUT)
+        band = new uint8[IW_BAND_ROWS * band_bpl]; // no page buffer, see iw_flush_band
+    else
+        page = new uint8[pagesize + 256]; //(uint8 *) malloc(pagesize+256);
+
     iw_initialize(1);
 }
 
@@ -2429,18 +2699,96 @@ void ImageWriter::ImageWriterLoop(uint8 c)
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #endif
 
-void ImageWriter::iw_spitout_wx(void)
+// Name for page n's output file, without an extension.
+wxString ImageWriter::iw_page_name(uint32 n)
 {
-#define IW_PRINT_OUT 0
-#define IW_PNG_OUT 1
-// future reserved types.
-#define IW_PDF_OUT 2
-#define IW_CALLBACK 3
-    // callback should pass pagenum as int and the wxBitmap
+    wxDateTime now = wxDateTime::Now();
 
+    // time contains : which is anathema to win32 (and classic mac os if we ever port there)
+    char time[40];
+    char date[40];
+    wxString T, D;
+    T = now.FormatISOTime();
+    D = now.FormatISODate();
+    char *t, *d;
+    t = (char *)(const char *)(T.c_str());
+    d = (char *)(const char *)(D.c_str());
+
+    int i, j;
+
+    for (i = 0, j = 0; i < 39 && d[i]; i++)
+    {
+        if (t[i] != ':' && t[i] != '/' && t[i] != '\\')
+        {
+            time[j] = t[i];
+            j++;
+        }
+        time[j] = 0;
+    }
+    for (i = 0, j = 0; i < 39 && d[i]; i++)
+    {
+        if (d[i] != ':' && d[i] != '/' && d[i] != '\\')
+        {
+            date[j] = d[i];
+            j++;
+        }
+        date[j] = 0;
+    }
+
+    wxString pagenumber;
+    pagenumber.Printf(_T("%04d"), ((int)(n)));
+    return destination + wxFileName::GetPathSeparator() +
+           _T("iw") +
+           // iwid +
+           wxString(date, wxConvLocal, 2048) + // wxSTRING_MAXLEN) +
+           wxString(time, wxConvLocal, 2048 /* wxSTRING_MAXLEN */) + pagenumber;
+}
+
+/* Streamed output keeps a ring of IW_BAND_ROWS rows rather than a whole page.  When the
+   head plots below the ring, everything above newtop is handed to the writer thread as
+   a band and cleared for reuse, so the page goes out a band at a time as it prints.
+   n is the page number to name the file after if this is the page's first band. */
+
+void ImageWriter::iw_flush_band(int newtop, uint32 n)
+{
+    int r, rows;
+
+    if (newtop > height)
+        newtop = height;
+    if (newtop <= band_top)
+        return;
+
+    if (!stream)
+        stream = iw_stream_open(desttype, owidth, height, (int)DIW_OUT_HDPI);
+    if (!band_inpage)
+    {
+        iw_stream_begin_page(stream, CSTR(iw_page_name(n)));
+        band_inpage = 1;
+    }
+
+    while (band_top < newtop) // the ring may wrap, so it goes over in up to two pieces
+    {
+        r = band_top % IW_BAND_ROWS;
+        rows = MIN(newtop - band_top, IW_BAND_ROWS - r);
+        iw_stream_band(stream, band + r * band_bpl, rows);
+        memset(band + r * band_bpl, 0, rows * band_bpl);
+        band_top += rows;
+    }
+}
+
+void ImageWriter::iw_spitout_wx(void)
+{
     if (isblank)
         return;
 
+    if (band) // the rest of the page, blank paper and all
+    {
+        iw_flush_band(height, pagenum);
+        iw_stream_end_page(stream);
+        band_inpage = 0;
+        return;
+    }
+
     uint8 bmphdr[] =
         {
             // these are low endian since this is a windows format
@@ -2538,46 +2886,7 @@ void ImageWriter::iw_spitout_wx(void)
     bmphdr[25] = ((height) >> 24) & 0xff;
 
     wxString savefilename;
-    wxDateTime now = wxDateTime::Now();
-
-    // time contains : which is anathema to win32 (and classic mac os if we ever port there)
-    char time[40];
-    char date[40];
-    wxString T, D;
-    T = now.FormatISOTime();
-    D = now.FormatISODate();
-    char *t, *d;
-    t = (char *)(const char *)(T.c_str());
-    d = (char *)(const char *)(D.c_str());
-
-    int i, j;
-
-    for (i = 0, j = 0; i < 39 && d[i]; i++)
-    {
-        if (t[i] != ':' && t[i] != '/' && t[i] != '\\')
-        {
-            time[j] = t[i];
-            j++;
-        }
-        time[j] = 0;
-    }
-    for (i = 0, j = 0; i < 39 && d[i]; i++)
-    {
-        if (d[i] != ':' && d[i] != '/' && d[i] != '\\')
-        {
-            date[j] = d[i];
-            j++;
-        }
-        date[j] = 0;
-    }
-
-    wxString pagenumber;
-    pagenumber.Printf(_T("%04d"), ((int)(pagenum)));
-    savefilename = destination + wxFileName::GetPathSeparator() +
-                   _T("iw") +
-                   // iwid +
-                   wxString(date, wxConvLocal, 2048) + // wxSTRING_MAXLEN) +
-                   wxString(time, wxConvLocal, 2048 /* wxSTRING_MAXLEN */) + pagenumber;
+    savefilename = iw_page_name(pagenum);
 
     wxString tempfilename;
     tempfilename = savefilename + _T(".bmp");
@@ -2643,10 +2952,6 @@ void ImageWriter::iw_spitout_wx(void)
         unlink(tmp);
         return;
     }
-    case IW_PDF_OUT:
-
-        // not yet implemented.
-
     case IW_PNG_OUT:
     default:
         wxImage image = bits->ConvertToImage();
@@ -60,10 +60,36 @@
 #define IW_REPEAT10 253  /* repeat 10's  place */
 #define IW_REPEAT1 252   /* repeat 1's   place */
 
+// output types, IW_PNG_OUT and IW_PDF_OUT are streamed a band at a time by iw-stream.c
+#define IW_PRINT_OUT 0
+#define IW_PNG_OUT 1
+#define IW_PDF_OUT 2
+// future reserved types.
+#define IW_CALLBACK 3
+// callback should pass pagenum as int and the wxBitmap
+
 #include <wx/metafile.h>
 #include <wx/print.h>
 #include <wx/printdlg.h>
 
+#include <iw-stream.h>
+
+// A character as it comes off the print head: which font columns, in which style, and
+// where it starts relative to the 8 column cycle of head to output pixel scaling.
+// Rendered once to output pixels, after that printing it is a few row blits.
+typedef struct
+{
+   int16 cols[19];    // font columns it was rendered from
+   int16 ncols;
+   uint8 attrs;       // bit 0 underline, bit 1 bold, bit 2 headline
+   uint8 charwidth;
+   uint8 phase;       // head column % IW_GLYPH_XPHASES
+   uint16 rows;       // bit r set if pin row r has any dots
+   int16 advance;     // head columns the cursor moves
+   int16 ow;          // output pixels per stamp row, from 2 left of the first column
+   uint8 *sa, *sb;    // per pin row, the kernel's center row and the 4 rows around it
+} iw_glyph;
+
 class ImageWriter
 {
 
@@ -75,6 +101,7 @@ public:
    int8 iw_malloc(void);
    void iw_initialize(int full = 1);
    void EndDocument(void);
+   uint32 PageCount(void) { return pagenum; }
    ImageWriter(wxWindow *parent, int outputtype = 0, wxString outfname = _T(""), int dip1 = 210, float paperx = 8.5, float papery = 11.0);
    ~ImageWriter(void);
 
@@ -185,6 +212,18 @@ private:
 
    int pagefd;
 
+   // streamed output: only a band of rows is kept, rows above band_top have gone to the writer
+   iw_stream *stream;
+   uint8 *band;
+   int band_top, band_bpl, band_inpage;
+   void iw_flush_band(int newtop, uint32 n);
+   wxString iw_page_name(uint32 n);
+
+   iw_glyph *glyphs; // direct mapped cache of rendered characters
+   iw_glyph *iw_get_glyph(uint8 c);
+   int iw_blit_glyph(uint8 c);
+   void iw_blit_row(int x, int y, const uint8 *v, int n);
+
    uint16 iw_get_ypix(uint16 line);
    uint8 iw_pixel_color(uint16 x, uint16 y);
    uint8 iw_pixel_iwcolor(uint16 x, uint16 y);
@@ -0,0 +1,66 @@
+/**************************************************************************************\
+*                                                                                      *
+*                           Apple ImageWriter I Emulator.                              *
+*                              Headless Printer Spooler                                *
+*                                                                                      *
+*                       A Part of the Lisa Emulator Project                            *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                  Copyright (C) 1998, 2007 Ray A. Arachelian                          *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+****************************************************************************************
+*                                                                                      *
+*   With lisaem --spool DIR the emulator doesn't rasterise anything, the bytes sent to *
+*   each printer port are saved as raw job files in DIR instead.  lisaem --spoold DIR  *
+*   turns them into PNG or PDF pages in the background and serves them over a Unix     *
+*   socket.  See iw-spool.c for the directory layout and the socket commands.          *
+*                                                                                      *
+\**************************************************************************************/
+
+#ifndef IW_SPOOL_H
+#define IW_SPOOL_H
+
+#define IW_SPOOL_PORTS 10 // same as the emulator's imagewriter[] table
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // emulator side. dir NULL or "" turns spooling off, returns 0 if dir is usable
+    int iw_spool_set_dir(const char *dir);
+    int iw_spooling(void);
+    void iw_spool_attach(int port, int dipsw);
+    void iw_spool_putc(int port, unsigned char c);
+    void iw_spool_end_job(int port);
+    void iw_spool_end_jobs(void);
+    void iw_spool_check_idle(void); // ends jobs that haven't seen a byte in 15 seconds of Lisa time
+
+    // rasteriser side.  Turns rawfile into pages in outdir, returns the page count or -1
+    typedef int (*iw_spool_raster_fn)(const char *rawfile, const char *outdir, int type, int dipsw);
+
+    // arg is dir[;png|pdf][;jobs=N], doesn't return until SIGINT/SIGTERM
+    int iw_spoold_main(const char *arg, iw_spool_raster_fn raster);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
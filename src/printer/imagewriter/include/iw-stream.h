@@ -0,0 +1,65 @@
+/**************************************************************************************\
+*                                                                                      *
+*                           Apple ImageWriter I Emulator.                              *
+*                              Streaming Page Writer                                   *
+*                                                                                      *
+*                       A Part of the Lisa Emulator Project                            *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                  Copyright (C) 1998, 2007 Ray A. Arachelian                          *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+****************************************************************************************
+*                                                                                      *
+*   Pages arrive here a band of rows at a time, top to bottom, 4 bits per pixel with   *
+*   0 as white and 15 as black, in the same layout as the ImageWriter's page buffer.   *
+*   A writer thread encodes each band as it comes in, either into one PNG per page or  *
+*   into a single PDF for the whole document, so no full page is ever held in memory.  *
+*                                                                                      *
+\**************************************************************************************/
+
+#ifndef IW_STREAM_H
+#define IW_STREAM_H
+
+#define IWS_PNG 1 // same values as IW_PNG_OUT and IW_PDF_OUT
+#define IWS_PDF 2
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct iw_stream iw_stream;
+
+    // width and height are in pixels, rows are (width+1)/2 bytes, dpi is for the page size
+    iw_stream *iw_stream_open(int type, int width, int height, int dpi);
+
+    // name has no extension.  Each PNG page gets its own file, a PDF is named after its first page.
+    void iw_stream_begin_page(iw_stream *s, const char *name);
+    void iw_stream_band(iw_stream *s, const unsigned char *rows, int nrows);
+    void iw_stream_end_page(iw_stream *s);
+
+    // finishes the document, if wait is 0 the writer thread cleans up after itself
+    void iw_stream_close(iw_stream *s, int wait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
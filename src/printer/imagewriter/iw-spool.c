@@ -0,0 +1,775 @@
+/**************************************************************************************\
+*                                                                                      *
+*                           Apple ImageWriter I Emulator.                              *
+*                              Headless Printer Spooler                                *
+*                                                                                      *
+*                       A Part of the Lisa Emulator Project                            *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                  Copyright (C) 1998, 2007 Ray A. Arachelian                          *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+****************************************************************************************
+*                                                                                      *
+*   A spool directory can be shared by any number of emulators and rasterisers. Every  *
+*   job is a directory of its own that moves from one state to the next by rename(),   *
+*   so nobody ever sees half a job and only one rasteriser can claim it:               *
+*                                                                                      *
+*     tmp/JOB      being printed to by an emulator                                     *
+*     new/JOB      finished, waiting for a rasteriser                                  *
+*     work/JOB     being rasterised                                                    *
+*     done/JOB     rasterised, the pages are in here next to the raw data              *
+*     failed/JOB   the rasteriser couldn't make anything of it                         *
+*                                                                                      *
+*   JOB is date-time-host-pid-pPORT-seq, so jobs sort oldest first.  Each one holds    *
+*   data.raw, the bytes exactly as the Lisa sent them, and job.info, key=value lines   *
+*   about where it came from, the printer's DIP switches, and how it went.             *
+*                                                                                      *
+*   A job ends when the Lisa shuts down, or when its port has been quiet for 15        *
+*   seconds of Lisa time, the same as the on screen printer's end of document.         *
+*                                                                                      *
+*   The rasteriser (lisaem --spoold DIR) forks a worker per job, up to one per CPU,    *
+*   and listens on DIR/spool.sock.  Commands are lines of text:                        *
+*                                                                                      *
+*     LIST               JOB STATE BYTES PAGES per line, then a line with just "."     *
+*     FILES JOB          NAME SIZE per line, then "."                                  *
+*     FETCH JOB NAME     "OK SIZE" and the file's contents, or "ERR why"               *
+*     WAIT JOB [SECS]    returns the job's state once it's done or failed, or timeout  *
+*     DELETE JOB         removes a done or failed job, "OK" or "ERR why"               *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_IW_SPOOL_C
+#ifndef __MSVCRT__
+#define _GNU_SOURCE
+#define _XOPEN_SOURCE 600
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE
+#endif
+#endif
+
+#include <vars.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <iw-stream.h>
+#include <iw-spool.h>
+
+#ifndef __MSVCRT__
+#include <unistd.h>
+#include <strings.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#else
+#include <process.h>
+#endif
+
+#define IW_SPOOL_PATH 1024
+#define IW_SPOOL_NAME 128
+#define IW_SPOOL_MAXJOBS 64
+
+typedef struct
+{
+    FILE *data;
+    char name[IW_SPOOL_NAME];
+    int dipsw;
+    long bytes;
+    time_t started;
+    XTIMER last; // cpu68k_clocks at the last byte
+    int failed;  // couldn't create the job, drop the rest of it
+} iw_spool_port_t;
+
+static char spool_dir[IW_SPOOL_PATH];
+static iw_spool_port_t spool_port[IW_SPOOL_PORTS];
+static int spool_seq;
+
+static const char *spool_states[] = {"new", "work", "done", "failed"};
+static const char *spool_state_names[] = {"queued", "printing", "done", "failed"};
+
+static int spool_mkdir(const char *path)
+{
+#ifndef __MSVCRT__
+    if (mkdir(path, 0755) && errno != EEXIST)
+#else
+    if (mkdir(path) && errno != EEXIST)
+#endif
+        return -1;
+    return 0;
+}
+
+static int spool_mkdirs(const char *dir)
+{
+    char path[IW_SPOOL_PATH];
+    int i;
+
+    if (spool_mkdir(dir))
+        return -1;
+    snprintf(path, IW_SPOOL_PATH, "%s/tmp", dir);
+    if (spool_mkdir(path))
+        return -1;
+    for (i = 0; i < 4; i++)
+    {
+        snprintf(path, IW_SPOOL_PATH, "%s/%s", dir, spool_states[i]);
+        if (spool_mkdir(path))
+            return -1;
+    }
+    return 0;
+}
+
+static void spool_hostname(char *host, int len)
+{
+    char *s;
+
+#ifndef __MSVCRT__
+    if (gethostname(host, len) || !*host)
+#endif
+        strncpy(host, "lisaem", len);
+    host[len - 1] = 0;
+
+    for (s = host; *s; s++) // it ends up in a file name, and '-' separates the fields
+        if (*s == '.')
+        {
+            *s = 0;
+            break;
+        }
+        else if (*s == '/' || *s == '\\' || *s == '-' || *s == ' ')
+            *s = '_';
+}
+
+/*--------------------------------------------------------------------------------------
+ * Emulator side
+ *------------------------------------------------------------------------------------*/
+
+int iw_spool_set_dir(const char *dir)
+{
+    iw_spool_end_jobs();
+    spool_dir[0] = 0;
+    if (!dir || !*dir)
+        return 0;
+
+    if (strlen(dir) > IW_SPOOL_PATH - IW_SPOOL_NAME - 32 || spool_mkdirs(dir))
+    {
+        ALERT_LOG(0, "Can't use %s as a print spool directory: %s", dir, strerror(errno));
+        return -1;
+    }
+    strncpy(spool_dir, dir, IW_SPOOL_PATH - 1);
+    ALERT_LOG(0, "Spooling print jobs to %s", spool_dir);
+    return 0;
+}
+
+int iw_spooling(void) { return spool_dir[0] != 0; }
+
+void iw_spool_attach(int port, int dipsw)
+{
+    if (port >= 0 && port < IW_SPOOL_PORTS)
+        spool_port[port].dipsw = dipsw;
+}
+
+static void spool_begin_job(int port)
+{
+    iw_spool_port_t *p = &spool_port[port];
+    char path[IW_SPOOL_PATH], host[64];
+    struct tm *tm;
+
+    p->started = time(NULL);
+    tm = localtime(&p->started);
+    spool_hostname(host, sizeof(host));
+    snprintf(p->name, IW_SPOOL_NAME, "%04d%02d%02d-%02d%02d%02d-%s-%ld-p%d-%d",
+             tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec,
+             host, (long)getpid(), port, ++spool_seq);
+
+    snprintf(path, IW_SPOOL_PATH, "%s/tmp/%s", spool_dir, p->name);
+    if (!spool_mkdir(path))
+    {
+        snprintf(path, IW_SPOOL_PATH, "%s/tmp/%s/data.raw", spool_dir, p->name);
+        p->data = fopen(path, "wb");
+    }
+    if (!p->data)
+        ALERT_LOG(0, "Can't create print job %s: %s", path, strerror(errno));
+    p->bytes = 0;
+}
+
+void iw_spool_putc(int port, unsigned char c)
+{
+    iw_spool_port_t *p;
+
+    if (!spool_dir[0] || port < 0 || port >= IW_SPOOL_PORTS)
+        return;
+
+    p = &spool_port[port];
+    p->last = cpu68k_clocks;
+    if (!p->data && !p->failed)
+    {
+        spool_begin_job(port);
+        p->failed = !p->data;
+    }
+    if (p->failed)
+        return;
+    putc(c, p->data);
+    p->bytes++;
+}
+
+void iw_spool_end_job(int port)
+{
+    iw_spool_port_t *p;
+    char path[IW_SPOOL_PATH], dest[IW_SPOOL_PATH], host[64];
+    FILE *info;
+    int err;
+
+    if (port < 0 || port >= IW_SPOOL_PORTS)
+        return;
+    p = &spool_port[port];
+    p->failed = 0;
+    if (!p->data)
+        return;
+
+    err = fclose(p->data);
+    p->data = NULL;
+
+    spool_hostname(host, sizeof(host));
+    snprintf(path, IW_SPOOL_PATH, "%s/tmp/%s/job.info", spool_dir, p->name);
+    if ((info = fopen(path, "w")) != NULL)
+    {
+        fprintf(info, "host=%s\npid=%ld\nport=%d\ndipsw=%d\nbytes=%ld\nstarted=%ld\nfinished=%ld\n",
+                host, (long)getpid(), port, p->dipsw, p->bytes, (long)p->started, (long)time(NULL));
+        err |= fclose(info);
+    }
+    else
+        err = 1;
+
+    snprintf(path, IW_SPOOL_PATH, "%s/tmp/%s", spool_dir, p->name);
+    snprintf(dest, IW_SPOOL_PATH, "%s/new/%s", spool_dir, p->name);
+    if (err || rename(path, dest))
+    {
+        ALERT_LOG(0, "Couldn't finish print job %s: %s", path, strerror(errno));
+        return;
+    }
+    ALERT_LOG(0, "Spooled print job %s, %ld bytes", p->name, p->bytes);
+}
+
+void iw_spool_end_jobs(void)
+{
+    int i;
+    for (i = 0; i < IW_SPOOL_PORTS; i++)
+        iw_spool_end_job(i);
+}
+
+void iw_spool_check_idle(void)
+{
+    int i;
+    for (i = 0; i < IW_SPOOL_PORTS; i++)
+        if ((spool_port[i].data || spool_port[i].failed) && cpu68k_clocks - spool_port[i].last > FIFTEEN_SECONDS)
+            iw_spool_end_job(i);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Rasteriser side
+ *------------------------------------------------------------------------------------*/
+
+#ifndef __MSVCRT__
+
+static volatile sig_atomic_t spoold_quit;
+
+static void spoold_signal(int sig)
+{
+    (void)sig;
+    spoold_quit = 1;
+}
+
+// job and file names come off the socket, keep them inside the spool directory
+static int spool_name_ok(const char *name)
+{
+    return name && *name && *name != '.' && !strchr(name, '/') && strlen(name) < IW_SPOOL_NAME;
+}
+
+// the value of the last key= line in a job's info file, or def
+static long spool_info(const char *jobdir, const char *key, long def)
+{
+    char path[IW_SPOOL_PATH], line[256];
+    size_t len = strlen(key);
+    FILE *f;
+
+    snprintf(path, IW_SPOOL_PATH, "%s/job.info", jobdir);
+    if (!(f = fopen(path, "r")))
+        return def;
+    while (fgets(line, sizeof(line), f))
+        if (!strncmp(line, key, len) && line[len] == '=')
+            def = atol(line + len + 1);
+    fclose(f);
+    return def;
+}
+
+static void spool_info_add(const char *jobdir, const char *fmt, ...)
+{
+    char path[IW_SPOOL_PATH];
+    va_list args;
+    FILE *f;
+
+    snprintf(path, IW_SPOOL_PATH, "%s/job.info", jobdir);
+    if (!(f = fopen(path, "a")))
+        return;
+    va_start(args, fmt);
+    vfprintf(f, fmt, args);
+    va_end(args);
+    fclose(f);
+}
+
+// which state a job is in, -1 if there's no such job.  Fills in its directory.
+static int spool_find(const char *dir, const char *job, char *jobdir)
+{
+    struct stat st;
+    int i;
+
+    if (!spool_name_ok(job))
+        return -1;
+    for (i = 0; i < 4; i++)
+    {
+        snprintf(jobdir, IW_SPOOL_PATH, "%s/%s/%s", dir, spool_states[i], job);
+        if (!stat(jobdir, &st) && S_ISDIR(st.st_mode))
+            return i;
+    }
+    return -1;
+}
+
+// the oldest job waiting in new/, returns 0 if there are none
+static int spool_oldest(const char *dir, char *job)
+{
+    char path[IW_SPOOL_PATH];
+    struct dirent *d;
+    DIR *dp;
+
+    *job = 0;
+    snprintf(path, IW_SPOOL_PATH, "%s/new", dir);
+    if (!(dp = opendir(path)))
+        return 0;
+    while ((d = readdir(dp)) != NULL)
+        if (spool_name_ok(d->d_name) && (!*job || strcmp(d->d_name, job) < 0))
+            strcpy(job, d->d_name);
+    closedir(dp);
+    return *job != 0;
+}
+
+// removes everything from a job's directory except what keep says to, then the directory if keep is 0
+static int spool_clean(const char *jobdir, int keep)
+{
+    char path[IW_SPOOL_PATH];
+    struct dirent *d;
+    DIR *dp;
+
+    if (!(dp = opendir(jobdir)))
+        return -1;
+    while ((d = readdir(dp)) != NULL)
+    {
+        if (!spool_name_ok(d->d_name))
+            continue;
+        if (keep && (!strcmp(d->d_name, "data.raw") || !strcmp(d->d_name, "job.info")))
+            continue;
+        snprintf(path, IW_SPOOL_PATH, "%s/%s", jobdir, d->d_name);
+        unlink(path);
+    }
+    closedir(dp);
+    return keep ? 0 : rmdir(jobdir);
+}
+
+// put back jobs whose rasteriser died on this host, so they get another go
+static void spool_requeue(const char *dir)
+{
+    char path[IW_SPOOL_PATH], jobdir[IW_SPOOL_PATH], host[64], line[256];
+    char owner[64];
+    struct dirent *d;
+    long pid;
+    FILE *f;
+    DIR *dp;
+
+    spool_hostname(host, sizeof(host));
+    snprintf(path, IW_SPOOL_PATH, "%s/work", dir);
+    if (!(dp = opendir(path)))
+        return;
+    while ((d = readdir(dp)) != NULL)
+    {
+        if (!spool_name_ok(d->d_name))
+            continue;
+        snprintf(jobdir, IW_SPOOL_PATH, "%s/work/%s", dir, d->d_name);
+        snprintf(path, IW_SPOOL_PATH, "%s/job.info", jobdir);
+        owner[0] = 0;
+        pid = 0;
+        if ((f = fopen(path, "r")) != NULL)
+        {
+            while (fgets(line, sizeof(line), f))
+                sscanf(line, "rasteriser=%63[^:]:%ld", owner, &pid);
+            fclose(f);
+        }
+        if (strcmp(owner, host) || pid <= 0 || !kill((pid_t)pid, 0) || errno != ESRCH)
+            continue;
+
+        spool_clean(jobdir, 1);
+        snprintf(path, IW_SPOOL_PATH, "%s/new/%s", dir, d->d_name);
+        if (!rename(jobdir, path))
+            fprintf(stderr, "lisaem-spoold: requeued %s\n", d->d_name);
+    }
+    closedir(dp);
+}
+
+static void spoold_rasterise(const char *dir, const char *job, int type, iw_spool_raster_fn raster)
+{
+    char jobdir[IW_SPOOL_PATH], raw[IW_SPOOL_PATH], dest[IW_SPOOL_PATH], host[64];
+    int pages;
+
+    spool_hostname(host, sizeof(host));
+    snprintf(jobdir, IW_SPOOL_PATH, "%s/work/%s", dir, job);
+    snprintf(raw, IW_SPOOL_PATH, "%s/data.raw", jobdir);
+    spool_info_add(jobdir, "rasteriser=%s:%ld\n", host, (long)getpid());
+
+    pages = raster(raw, jobdir, type, (int)spool_info(jobdir, "dipsw", 210));
+
+    if (pages >= 0)
+        spool_info_add(jobdir, "pages=%d\nrasterised=%ld\n", pages, (long)time(NULL));
+    else
+        spool_info_add(jobdir, "pages=0\nfailed=%ld\n", (long)time(NULL));
+
+    snprintf(dest, IW_SPOOL_PATH, "%s/%s/%s", dir, pages >= 0 ? "done" : "failed", job);
+    if (rename(jobdir, dest))
+        fprintf(stderr, "lisaem-spoold: couldn't move %s to %s: %s\n", jobdir, dest, strerror(errno));
+    else if (pages >= 0)
+        fprintf(stderr, "lisaem-spoold: %s done, %d pages\n", job, pages);
+    else
+        fprintf(stderr, "lisaem-spoold: %s failed\n", job);
+}
+
+static void spoold_list(const char *dir, FILE *out)
+{
+    char path[IW_SPOOL_PATH], jobdir[IW_SPOOL_PATH];
+    struct dirent *d;
+    DIR *dp;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        snprintf(path, IW_SPOOL_PATH, "%s/%s", dir, spool_states[i]);
+        if (!(dp = opendir(path)))
+            continue;
+        while ((d = readdir(dp)) != NULL)
+        {
+            if (!spool_name_ok(d->d_name))
+                continue;
+            snprintf(jobdir, IW_SPOOL_PATH, "%s/%s", path, d->d_name);
+            fprintf(out, "%s %s %ld %ld\n", d->d_name, spool_state_names[i],
+                    spool_info(jobdir, "bytes", 0), spool_info(jobdir, "pages", 0));
+        }
+        closedir(dp);
+    }
+    fprintf(out, ".\n");
+}
+
+static void spoold_files(const char *dir, const char *job, FILE *out)
+{
+    char jobdir[IW_SPOOL_PATH], path[IW_SPOOL_PATH];
+    struct dirent *d;
+    struct stat st;
+    DIR *dp;
+
+    if (spool_find(dir, job, jobdir) < 0 || !(dp = opendir(jobdir)))
+    {
+        fprintf(out, "ERR no such job\n");
+        return;
+    }
+    while ((d = readdir(dp)) != NULL)
+    {
+        if (!spool_name_ok(d->d_name))
+            continue;
+        snprintf(path, IW_SPOOL_PATH, "%s/%s", jobdir, d->d_name);
+        if (!stat(path, &st) && S_ISREG(st.st_mode))
+            fprintf(out, "%s %ld\n", d->d_name, (long)st.st_size);
+    }
+    closedir(dp);
+    fprintf(out, ".\n");
+}
+
+static void spoold_fetch(const char *dir, const char *job, const char *name, FILE *out)
+{
+    char jobdir[IW_SPOOL_PATH], path[IW_SPOOL_PATH], buf[65536];
+    struct stat st;
+    size_t n;
+    FILE *f;
+
+    if (spool_find(dir, job, jobdir) < 0)
+    {
+        fprintf(out, "ERR no such job\n");
+        return;
+    }
+    if (!spool_name_ok(name))
+    {
+        fprintf(out, "ERR no such file\n");
+        return;
+    }
+    snprintf(path, IW_SPOOL_PATH, "%s/%s", jobdir, name);
+    if (!(f = fopen(path, "rb")) || fstat(fileno(f), &st))
+    {
+        fprintf(out, "ERR %s\n", strerror(errno));
+        if (f)
+            fclose(f);
+        return;
+    }
+    fprintf(out, "OK %ld\n", (long)st.st_size);
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        if (fwrite(buf, 1, n, out) != n)
+            break;
+    fclose(f);
+}
+
+static void spoold_wait(const char *dir, const char *job, int secs, FILE *out)
+{
+    char jobdir[IW_SPOOL_PATH];
+    time_t until = time(NULL) + (secs > 0 ? secs : 3600);
+    int state;
+
+    while ((state = spool_find(dir, job, jobdir)) >= 0 && state < 2 && time(NULL) < until)
+        usleep(100000);
+
+    if (state < 0)
+        fprintf(out, "ERR no such job\n");
+    else if (state < 2)
+        fprintf(out, "timeout\n");
+    else
+        fprintf(out, "%s\n", spool_state_names[state]);
+}
+
+static void spoold_delete(const char *dir, const char *job, FILE *out)
+{
+    char jobdir[IW_SPOOL_PATH];
+    int state = spool_find(dir, job, jobdir);
+
+    if (state < 0)
+        fprintf(out, "ERR no such job\n");
+    else if (state < 2)
+        fprintf(out, "ERR job is still %s\n", spool_state_names[state]);
+    else if (spool_clean(jobdir, 0))
+        fprintf(out, "ERR %s\n", strerror(errno));
+    else
+        fprintf(out, "OK\n");
+}
+
+// runs in its own process, one per connection
+static void spoold_client(const char *dir, int fd)
+{
+    char line[512], cmd[16], job[IW_SPOOL_NAME], name[IW_SPOOL_NAME];
+    FILE *in = fdopen(fd, "r"), *out = fdopen(dup(fd), "w");
+    int n, secs;
+
+    if (!in || !out)
+        return;
+
+    while (fgets(line, sizeof(line), in))
+    {
+        job[0] = name[0] = 0;
+        secs = 0;
+        n = sscanf(line, "%15s %127s %127s", cmd, job, name);
+        if (n < 1)
+            continue;
+
+        if (!strcasecmp(cmd, "LIST"))
+            spoold_list(dir, out);
+        else if (!strcasecmp(cmd, "FILES") && n >= 2)
+            spoold_files(dir, job, out);
+        else if (!strcasecmp(cmd, "FETCH") && n == 3)
+            spoold_fetch(dir, job, name, out);
+        else if (!strcasecmp(cmd, "WAIT") && n >= 2)
+        {
+            if (n == 3)
+                secs = atoi(name);
+            spoold_wait(dir, job, secs, out);
+        }
+        else if (!strcasecmp(cmd, "DELETE") && n >= 2)
+            spoold_delete(dir, job, out);
+        else if (!strcasecmp(cmd, "QUIT"))
+            break;
+        else
+            fprintf(out, "ERR commands are LIST, FILES job, FETCH job file, WAIT job [secs], DELETE job, QUIT\n");
+
+        if (fflush(out))
+            break;
+    }
+    fclose(out);
+    fclose(in);
+}
+
+static int spoold_listen(const char *dir)
+{
+    struct sockaddr_un sa;
+    int fd;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if (snprintf(sa.sun_path, sizeof(sa.sun_path), "%s/spool.sock", dir) >= (int)sizeof(sa.sun_path))
+    {
+        fprintf(stderr, "lisaem-spoold: %s/spool.sock is too long a path for a socket\n", dir);
+        return -1;
+    }
+    unlink(sa.sun_path);
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+        bind(fd, (struct sockaddr *)&sa, sizeof(sa)) || listen(fd, 16))
+    {
+        fprintf(stderr, "lisaem-spoold: can't listen on %s: %s\n", sa.sun_path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int iw_spoold_main(const char *arg, iw_spool_raster_fn raster)
+{
+    char dir[IW_SPOOL_PATH], job[IW_SPOOL_NAME], from[IW_SPOOL_PATH], to[IW_SPOOL_PATH];
+    pid_t workers[IW_SPOOL_MAXJOBS], pid;
+    int type = IWS_PNG, jobs = 0, nworkers = 0, lfd, fd, i;
+    struct pollfd pfd;
+    char *s, *opt;
+
+    strncpy(dir, arg, IW_SPOOL_PATH - 1);
+    dir[IW_SPOOL_PATH - 1] = 0;
+    if ((s = strchr(dir, ';')) != NULL)
+    {
+        *s++ = 0;
+        for (opt = strtok(s, ";"); opt; opt = strtok(NULL, ";"))
+            if (!strcasecmp(opt, "png"))
+                type = IWS_PNG;
+            else if (!strcasecmp(opt, "pdf"))
+                type = IWS_PDF;
+            else if (!strncasecmp(opt, "jobs=", 5))
+                jobs = atoi(opt + 5);
+            else
+            {
+                fprintf(stderr, "lisaem-spoold: unknown option %s, use dir[;png|pdf][;jobs=N]\n", opt);
+                return 1;
+            }
+    }
+    if (jobs < 1)
+        jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1)
+        jobs = 1;
+    if (jobs > IW_SPOOL_MAXJOBS)
+        jobs = IW_SPOOL_MAXJOBS;
+
+    if (strlen(dir) > IW_SPOOL_PATH - IW_SPOOL_NAME - 32 || spool_mkdirs(dir))
+    {
+        fprintf(stderr, "lisaem-spoold: can't use %s as a spool directory: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    if ((lfd = spoold_listen(dir)) < 0)
+        return 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, spoold_signal);
+    signal(SIGTERM, spoold_signal);
+    spool_requeue(dir);
+    fprintf(stderr, "lisaem-spoold: spooling %s to %s with %d workers\n", dir, type == IWS_PDF ? "PDF" : "PNG", jobs);
+
+    while (!spoold_quit)
+    {
+        // reap workers and clients, only workers count against jobs
+        while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+            for (i = 0; i < nworkers; i++)
+                if (workers[i] == pid)
+                {
+                    workers[i] = workers[--nworkers];
+                    break;
+                }
+
+        while (nworkers < jobs && spool_oldest(dir, job))
+        {
+            snprintf(from, IW_SPOOL_PATH, "%s/new/%s", dir, job);
+            snprintf(to, IW_SPOOL_PATH, "%s/work/%s", dir, job);
+            if (rename(from, to))
+            {
+                if (errno == ENOENT) // another rasteriser got it first
+                    continue;
+                fprintf(stderr, "lisaem-spoold: can't claim %s: %s\n", from, strerror(errno));
+                break;
+            }
+
+            if ((pid = fork()) == 0)
+            {
+                close(lfd);
+                signal(SIGINT, SIG_DFL);
+                signal(SIGTERM, SIG_DFL);
+                spoold_rasterise(dir, job, type, raster);
+                fflush(NULL);
+                _exit(0);
+            }
+            if (pid < 0)
+            {
+                fprintf(stderr, "lisaem-spoold: fork: %s\n", strerror(errno));
+                rename(to, from);
+                break;
+            }
+            workers[nworkers++] = pid;
+        }
+
+        pfd.fd = lfd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 250) <= 0 || !(pfd.revents & POLLIN))
+            continue;
+        if ((fd = accept(lfd, NULL, NULL)) < 0)
+            continue;
+
+        if ((pid = fork()) == 0)
+        {
+            close(lfd);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            spoold_client(dir, fd);
+            _exit(0);
+        }
+        close(fd);
+    }
+
+    close(lfd);
+    snprintf(from, IW_SPOOL_PATH, "%s/spool.sock", dir);
+    unlink(from);
+    fprintf(stderr, "lisaem-spoold: waiting for %d workers\n", nworkers);
+    while (nworkers > 0 && (pid = wait(NULL)) > 0)
+        for (i = 0; i < nworkers; i++)
+            if (workers[i] == pid)
+            {
+                workers[i] = workers[--nworkers];
+                break;
+            }
+    return 0;
+}
+
+#else
+
+int iw_spoold_main(const char *arg, iw_spool_raster_fn raster)
+{
+    (void)arg;
+    (void)raster;
+    fprintf(stderr, "lisaem-spoold needs Unix sockets and fork(), it isn't available on Windows\n");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,710 @@
+/**************************************************************************************\
+*                                                                                      *
+*                           Apple ImageWriter I Emulator.                              *
+*                              Streaming Page Writer                                   *
+*                                                                                      *
+*                       A Part of the Lisa Emulator Project                            *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                  Copyright (C) 1998, 2007 Ray A. Arachelian                          *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+****************************************************************************************
+*                                                                                      *
+*   Bands of printed rows are queued to a writer thread which encodes them as they     *
+*   arrive.  Both PNG and PDF want a zlib stream, so each row goes through the PNG     *
+*   "Up" filter (PDF gets the same bytes via /Predictor 15) and a small deflater that  *
+*   only looks for runs of the last byte.  That's all a printed page needs: blank      *
+*   paper and rows that repeat the one above both filter down to long runs of zeros,   *
+*   and it keeps the encoder to a single fixed Huffman block with no window to search. *
+*                                                                                      *
+*   No wx in here, so it can be used from a headless build as well.                    *
+*                                                                                      *
+\**************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef __MSVCRT__
+#include <pthread.h>
+#endif
+
+#include <iw-stream.h>
+
+#define IWS_CHUNK 65536               // IDAT chunk size, also the PDF write buffer
+#define IWS_MAX_QUEUED (32L << 20)    // bytes of bands waiting before the printer has to wait for us
+#define IWS_ADLER_BASE 65521
+#define IWS_ADLER_NMAX 5552
+
+#define IWS_JOB_PAGE 1
+#define IWS_JOB_BAND 2
+#define IWS_JOB_ENDPAGE 3
+#define IWS_JOB_CLOSE 4
+
+typedef struct iws_job
+{
+    int kind;
+    int nrows;
+    char *name;
+    unsigned char *data;
+    struct iws_job *next;
+} iws_job;
+
+struct iw_stream
+{
+    int type, width, height, dpi, rowbytes;
+
+    // job queue, filled by the emulator, drained by the writer
+    iws_job *head, *tail;
+    long queued;
+    int detach;
+#ifndef __MSVCRT__
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t more, room;
+#endif
+
+    // writer side
+    FILE *f;
+    int inpage, row;
+    unsigned char *prev, *line, *paper;
+
+    // deflate state
+    uint32_t bits;
+    int nbits;
+    uint32_t adler_a, adler_b;
+    int last, run;
+    unsigned char out[IWS_CHUNK];
+    int outlen;
+    long streamlen;
+
+    // PDF objects, 1 is the catalog and 2 the page tree, both written at the end
+    long *xref;
+    int nobj, maxobj;
+    int *kids;
+    int nkids, maxkids;
+    int imgobj;
+};
+
+// Same gray levels as the BMP palette in iw_spitout_wx(): 0 is paper, anything past 2 is black.
+static const unsigned char iws_gray[16] = {0xff, 0x10, 0x08, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static uint32_t iws_crc_table[256];
+
+static void iws_crc_init(void)
+{
+    uint32_t c;
+    int n, k;
+
+    if (iws_crc_table[1])
+        return;
+    for (n = 0; n < 256; n++)
+    {
+        c = (uint32_t)n;
+        for (k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+        iws_crc_table[n] = c;
+    }
+}
+
+static uint32_t iws_crc(uint32_t crc, const unsigned char *p, int len)
+{
+    while (len--)
+        crc = iws_crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static void iws_be32(unsigned char *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void png_chunk(iw_stream *s, const char *type, const unsigned char *data, int len)
+{
+    unsigned char hdr[8], crc[4];
+    uint32_t c;
+
+    if (!s->f)
+        return;
+    iws_be32(hdr, len);
+    memcpy(hdr + 4, type, 4);
+    c = iws_crc(0xffffffffUL, hdr + 4, 4);
+    c = iws_crc(c, data, len) ^ 0xffffffffUL;
+    iws_be32(crc, c);
+    fwrite(hdr, 8, 1, s->f);
+    if (len)
+        fwrite(data, len, 1, s->f);
+    fwrite(crc, 4, 1, s->f);
+}
+
+/*------------------------------------- deflate ---------------------------------------*/
+
+static const int iws_lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int iws_lext[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+static void iws_flush_out(iw_stream *s)
+{
+    if (!s->outlen)
+        return;
+    if (s->type == IWS_PNG)
+        png_chunk(s, "IDAT", s->out, s->outlen);
+    else if (s->f)
+        fwrite(s->out, s->outlen, 1, s->f);
+    s->streamlen += s->outlen;
+    s->outlen = 0;
+}
+
+static void iws_out(iw_stream *s, unsigned char c)
+{
+    s->out[s->outlen++] = c;
+    if (s->outlen == IWS_CHUNK)
+        iws_flush_out(s);
+}
+
+static void iws_bits(iw_stream *s, uint32_t v, int n)
+{
+    s->bits |= v << s->nbits;
+    s->nbits += n;
+    while (s->nbits >= 8)
+    {
+        iws_out(s, s->bits & 0xff);
+        s->bits >>= 8;
+        s->nbits -= 8;
+    }
+}
+
+static void iws_code(iw_stream *s, uint32_t code, int len) // Huffman codes go out MSB first
+{
+    uint32_t r = 0;
+    int i;
+
+    for (i = 0; i < len; i++, code >>= 1)
+        r = (r << 1) | (code & 1);
+    iws_bits(s, r, len);
+}
+
+static void iws_sym(iw_stream *s, int sym) // fixed Huffman literal/length table
+{
+    if (sym < 144)
+        iws_code(s, 0x30 + sym, 8);
+    else if (sym < 256)
+        iws_code(s, 0x190 + sym - 144, 9);
+    else if (sym < 280)
+        iws_code(s, sym - 256, 7);
+    else
+        iws_code(s, 0xc0 + sym - 280, 8);
+}
+
+static void iws_flush_run(iw_stream *s)
+{
+    int i;
+
+    if (s->run >= 3)
+    {
+        for (i = 28; iws_lbase[i] > s->run; i--)
+            ;
+        iws_sym(s, 257 + i);
+        if (iws_lext[i])
+            iws_bits(s, s->run - iws_lbase[i], iws_lext[i]);
+        iws_code(s, 0, 5); // distance 1
+    }
+    else
+        for (i = 0; i < s->run; i++)
+            iws_sym(s, s->last);
+    s->run = 0;
+}
+
+static void iws_deflate_start(iw_stream *s)
+{
+    s->bits = 0;
+    s->nbits = 0;
+    s->adler_a = 1;
+    s->adler_b = 0;
+    s->last = -1;
+    s->run = 0;
+    s->outlen = 0;
+    s->streamlen = 0;
+    iws_out(s, 0x78); // zlib header, 32K window, fastest
+    iws_out(s, 0x01);
+    iws_bits(s, 0, 1); // not the last block
+    iws_bits(s, 1, 2); // fixed Huffman
+}
+
+static void iws_deflate(iw_stream *s, const unsigned char *p, int len)
+{
+    int i, n;
+
+    for (i = 0; i < len; i += n) // adler32 of the raw bytes
+    {
+        const unsigned char *q = p + i;
+        int j;
+        n = len - i < IWS_ADLER_NMAX ? len - i : IWS_ADLER_NMAX;
+        for (j = 0; j < n; j++)
+        {
+            s->adler_a += q[j];
+            s->adler_b += s->adler_a;
+        }
+        s->adler_a %= IWS_ADLER_BASE;
+        s->adler_b %= IWS_ADLER_BASE;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        if (p[i] == s->last)
+        {
+            if (++s->run == 258)
+                iws_flush_run(s);
+            continue;
+        }
+        iws_flush_run(s);
+        iws_sym(s, p[i]);
+        s->last = p[i];
+    }
+}
+
+static void iws_deflate_finish(iw_stream *s)
+{
+    unsigned char a[4];
+    int i;
+
+    iws_flush_run(s);
+    iws_sym(s, 256);   // end of block
+    iws_bits(s, 1, 1); // an empty last block to close the stream
+    iws_bits(s, 1, 2);
+    iws_sym(s, 256);
+    if (s->nbits)
+        iws_bits(s, 0, 8 - s->nbits);
+    iws_be32(a, (s->adler_b << 16) | s->adler_a);
+    for (i = 0; i < 4; i++)
+        iws_out(s, a[i]);
+    iws_flush_out(s);
+}
+
+/*------------------------------------- writer ----------------------------------------*/
+
+static void iws_row(iw_stream *s, const unsigned char *p)
+{
+    int i;
+
+    s->line[0] = 2; // Up
+    for (i = 0; i < s->rowbytes; i++)
+        s->line[i + 1] = p[i] - s->prev[i];
+    memcpy(s->prev, p, s->rowbytes);
+    iws_deflate(s, s->line, s->rowbytes + 1);
+    s->row++;
+}
+
+static int pdf_alloc(iw_stream *s)
+{
+    if (s->nobj + 1 >= s->maxobj)
+    {
+        s->maxobj = s->maxobj ? s->maxobj * 2 : 64;
+        s->xref = (long *)realloc(s->xref, s->maxobj * sizeof(long));
+    }
+    s->nobj++;
+    s->xref[s->nobj] = 0;
+    return s->nobj;
+}
+
+static void pdf_begin(iw_stream *s, int n)
+{
+    s->xref[n] = ftell(s->f);
+    fprintf(s->f, "%d 0 obj\n", n);
+}
+
+static void iws_page_begin(iw_stream *s, const char *name)
+{
+    char fname[1024];
+    unsigned char hdr[13], plte[48];
+    int i;
+
+    memset(s->prev, 0, s->rowbytes);
+    s->row = 0;
+    s->inpage = 1;
+
+    if (s->type == IWS_PNG)
+    {
+        snprintf(fname, sizeof(fname), "%s.png", name);
+        s->f = fopen(fname, "wb");
+        if (!s->f)
+            fprintf(stderr, "iw_stream: could not create %s\n", fname);
+        else
+            fwrite("\x89PNG\r\n\x1a\n", 8, 1, s->f);
+
+        iws_be32(hdr, s->width);
+        iws_be32(hdr + 4, s->height);
+        hdr[8] = 4;  // bits per pixel
+        hdr[9] = 3;  // palette
+        hdr[10] = 0; // deflate
+        hdr[11] = 0; // adaptive filtering
+        hdr[12] = 0; // not interlaced
+        png_chunk(s, "IHDR", hdr, 13);
+
+        iws_be32(hdr, (uint32_t)(s->dpi / 0.0254 + 0.5)); // pixels per meter
+        iws_be32(hdr + 4, (uint32_t)(s->dpi / 0.0254 + 0.5));
+        hdr[8] = 1;
+        png_chunk(s, "pHYs", hdr, 9);
+
+        for (i = 0; i < 16; i++)
+            plte[i * 3] = plte[i * 3 + 1] = plte[i * 3 + 2] = iws_gray[i];
+        png_chunk(s, "PLTE", plte, 48);
+    }
+    else
+    {
+        if (!s->f)
+        {
+            snprintf(fname, sizeof(fname), "%s.pdf", name);
+            s->f = fopen(fname, "wb");
+            if (!s->f)
+            {
+                fprintf(stderr, "iw_stream: could not create %s\n", fname);
+                s->inpage = 0;
+                return;
+            }
+            fprintf(s->f, "%%PDF-1.4\n%%\xe2\xe3\xcf\xd3\n");
+            s->nobj = 0;
+            pdf_alloc(s); // catalog
+            pdf_alloc(s); // pages
+        }
+
+        s->imgobj = pdf_alloc(s);
+        pdf_alloc(s); // its length, which isn't known until the end
+        pdf_begin(s, s->imgobj);
+        fprintf(s->f, "<< /Type /XObject /Subtype /Image /Width %d /Height %d\n"
+                      "   /ColorSpace [/Indexed /DeviceGray 15 <",
+                s->width, s->height);
+        for (i = 0; i < 16; i++)
+            fprintf(s->f, "%02x", iws_gray[i]);
+        fprintf(s->f, ">] /BitsPerComponent 4\n"
+                      "   /Filter /FlateDecode /DecodeParms << /Predictor 15 /Colors 1 /BitsPerComponent 4 /Columns %d >>\n"
+                      "   /Length %d 0 R >>\nstream\n",
+                s->width, s->imgobj + 1);
+    }
+
+    iws_deflate_start(s);
+}
+
+static void iws_page_end(iw_stream *s)
+{
+    char content[128];
+    double pw, ph;
+    int cobj, pobj;
+
+    if (!s->inpage)
+        return;
+
+    while (s->row < s->height) // pad out a short page with paper
+        iws_row(s, s->paper);
+    iws_deflate_finish(s);
+    s->inpage = 0;
+
+    if (s->type == IWS_PNG)
+    {
+        png_chunk(s, "IEND", NULL, 0);
+        if (s->f)
+            fclose(s->f);
+        s->f = NULL;
+        return;
+    }
+
+    if (!s->f)
+        return;
+
+    fprintf(s->f, "\nendstream\nendobj\n");
+    pdf_begin(s, s->imgobj + 1);
+    fprintf(s->f, "%ld\nendobj\n", s->streamlen);
+
+    pw = s->width * 72.0 / s->dpi;
+    ph = s->height * 72.0 / s->dpi;
+    snprintf(content, sizeof(content), "q %.2f 0 0 %.2f 0 0 cm /Im0 Do Q\n", pw, ph);
+    cobj = pdf_alloc(s);
+    pdf_begin(s, cobj);
+    fprintf(s->f, "<< /Length %d >>\nstream\n%sendstream\nendobj\n", (int)strlen(content), content);
+
+    pobj = pdf_alloc(s);
+    pdf_begin(s, pobj);
+    fprintf(s->f, "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %.2f %.2f]\n"
+                  "   /Resources << /XObject << /Im0 %d 0 R >> >> /Contents %d 0 R >>\nendobj\n",
+            pw, ph, s->imgobj, cobj);
+
+    if (s->nkids == s->maxkids)
+    {
+        s->maxkids = s->maxkids ? s->maxkids * 2 : 16;
+        s->kids = (int *)realloc(s->kids, s->maxkids * sizeof(int));
+    }
+    s->kids[s->nkids++] = pobj;
+}
+
+static void iws_doc_end(iw_stream *s)
+{
+    long xref;
+    int i;
+
+    iws_page_end(s);
+    if (s->type != IWS_PDF || !s->f)
+        return;
+
+    pdf_begin(s, 2);
+    fprintf(s->f, "<< /Type /Pages /Count %d /Kids [", s->nkids);
+    for (i = 0; i < s->nkids; i++)
+        fprintf(s->f, "%s%d 0 R", i ? " " : "", s->kids[i]);
+    fprintf(s->f, "] >>\nendobj\n");
+
+    pdf_begin(s, 1);
+    fprintf(s->f, "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+
+    xref = ftell(s->f);
+    fprintf(s->f, "xref\n0 %d\n0000000000 65535 f \n", s->nobj + 1);
+    for (i = 1; i <= s->nobj; i++)
+        fprintf(s->f, "%010ld 00000 n \n", s->xref[i]);
+    fprintf(s->f, "trailer\n<< /Size %d /Root 1 0 R >>\nstartxref\n%ld\n%%%%EOF\n", s->nobj + 1, xref);
+    fclose(s->f);
+    s->f = NULL;
+}
+
+static void iws_run(iw_stream *s, iws_job *j)
+{
+    int i;
+
+    switch (j->kind)
+    {
+    case IWS_JOB_PAGE:
+        iws_page_end(s); // in case the last one wasn't finished
+        iws_page_begin(s, j->name);
+        break;
+    case IWS_JOB_BAND:
+        if (!s->inpage)
+            break;
+        for (i = 0; i < j->nrows && s->row < s->height; i++)
+            iws_row(s, j->data + i * s->rowbytes);
+        break;
+    case IWS_JOB_ENDPAGE:
+        iws_page_end(s);
+        break;
+    case IWS_JOB_CLOSE:
+        iws_doc_end(s);
+        break;
+    }
+}
+
+static void iws_free_job(iws_job *j)
+{
+    free(j->name);
+    free(j->data);
+    free(j);
+}
+
+static void iws_free(iw_stream *s)
+{
+#ifndef __MSVCRT__
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->more);
+    pthread_cond_destroy(&s->room);
+#endif
+    free(s->prev);
+    free(s->line);
+    free(s->paper);
+    free(s->xref);
+    free(s->kids);
+    free(s);
+}
+
+#ifndef __MSVCRT__
+
+static void *iws_main(void *arg)
+{
+    iw_stream *s = (iw_stream *)arg;
+    iws_job *j;
+    int kind;
+
+    do
+    {
+        pthread_mutex_lock(&s->lock);
+        while (!s->head)
+            pthread_cond_wait(&s->more, &s->lock);
+        j = s->head;
+        s->head = j->next;
+        if (!s->head)
+            s->tail = NULL;
+        if (j->data)
+            s->queued -= (long)j->nrows * s->rowbytes;
+        pthread_cond_signal(&s->room);
+        pthread_mutex_unlock(&s->lock);
+
+        iws_run(s, j);
+        kind = j->kind;
+        iws_free_job(j);
+    } while (kind != IWS_JOB_CLOSE);
+
+    if (s->detach) // set before the close job was queued
+        iws_free(s);
+    return NULL;
+}
+
+static void iws_queue(iw_stream *s, iws_job *j)
+{
+    long size = j->data ? (long)j->nrows * s->rowbytes : 0;
+
+    pthread_mutex_lock(&s->lock);
+    while (size && s->queued > IWS_MAX_QUEUED) // the writer has fallen a long way behind
+        pthread_cond_wait(&s->room, &s->lock);
+    j->next = NULL;
+    if (s->tail)
+        s->tail->next = j;
+    else
+        s->head = j;
+    s->tail = j;
+    s->queued += size;
+    pthread_cond_signal(&s->more);
+    pthread_mutex_unlock(&s->lock);
+}
+
+#else
+
+// no threads here, the bands are encoded as they're handed over
+static void iws_queue(iw_stream *s, iws_job *j)
+{
+    iws_run(s, j);
+    iws_free_job(j);
+}
+
+#endif
+
+static iws_job *iws_job_new(int kind)
+{
+    iws_job *j = (iws_job *)calloc(1, sizeof(iws_job));
+
+    if (j)
+        j->kind = kind;
+    return j;
+}
+
+iw_stream *iw_stream_open(int type, int width, int height, int dpi)
+{
+    iw_stream *s = (iw_stream *)calloc(1, sizeof(iw_stream));
+
+    if (!s)
+        return NULL;
+
+    iws_crc_init();
+    s->type = type;
+    s->width = width;
+    s->height = height;
+    s->dpi = dpi;
+    s->rowbytes = (width + 1) / 2;
+    s->prev = (unsigned char *)calloc(1, s->rowbytes);
+    s->line = (unsigned char *)calloc(1, s->rowbytes + 1);
+    s->paper = (unsigned char *)calloc(1, s->rowbytes);
+    if (!s->prev || !s->line || !s->paper)
+    {
+        iws_free(s);
+        return NULL;
+    }
+
+#ifndef __MSVCRT__
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->more, NULL);
+    pthread_cond_init(&s->room, NULL);
+    if (pthread_create(&s->thread, NULL, iws_main, s))
+    {
+        fprintf(stderr, "iw_stream: could not start the writer thread\n");
+        iws_free(s);
+        return NULL;
+    }
+#endif
+    return s;
+}
+
+void iw_stream_begin_page(iw_stream *s, const char *name)
+{
+    iws_job *j;
+
+    if (!s || !(j = iws_job_new(IWS_JOB_PAGE)))
+        return;
+    j->name = strdup(name);
+    if (!j->name)
+    {
+        iws_free_job(j);
+        return;
+    }
+    iws_queue(s, j);
+}
+
+void iw_stream_band(iw_stream *s, const unsigned char *rows, int nrows)
+{
+    iws_job *j;
+
+    if (!s || nrows <= 0 || !(j = iws_job_new(IWS_JOB_BAND)))
+        return;
+    j->data = (unsigned char *)malloc((size_t)nrows * s->rowbytes);
+    if (!j->data)
+    {
+        iws_free_job(j);
+        return;
+    }
+    memcpy(j->data, rows, (size_t)nrows * s->rowbytes);
+    j->nrows = nrows;
+    iws_queue(s, j);
+}
+
+void iw_stream_end_page(iw_stream *s)
+{
+    iws_job *j;
+
+    if (!s || !(j = iws_job_new(IWS_JOB_ENDPAGE)))
+        return;
+    iws_queue(s, j);
+}
+
+void iw_stream_close(iw_stream *s, int wait)
+{
+    iws_job *j;
+
+    if (!s)
+        return;
+
+    j = iws_job_new(IWS_JOB_CLOSE);
+    if (!j) // can't tell the writer, so the document can't be finished
+        return;
+
+#ifndef __MSVCRT__
+    {
+        pthread_t t = s->thread;
+
+        s->detach = !wait;
+        iws_queue(s, j); // after this s belongs to the writer if detached
+        if (!wait)
+        {
+            pthread_detach(t);
+            return;
+        }
+        pthread_join(t, NULL);
+    }
+#else
+    iws_queue(s, j);
+#endif
+    iws_free(s);
+}
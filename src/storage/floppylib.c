@@ -0,0 +1,274 @@
+/**************************************************************************************\
+*                                                                                      *
+*              The Lisa Emulator Project  V1.2.7      DEV 2020.10.15                   *
+*                             http://lisaem.sunder.net                                 *
+*                                                                                      *
+*                Copyright (C) MCMXCVIII, MMXX Ray A. Arachelian                       *
+*                                All Rights Reserved                                   *
+*                                                                                      *
+*           This program is free software; you can redistribute it and/or              *
+*           modify it under the terms of the GNU General Public License                *
+*           as published by the Free Software Foundation; either version 2             *
+*           of the License, or (at your option) any later version.                     *
+*                                                                                      *
+*           This program is distributed in the hope that it will be useful,            *
+*           but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+*           MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+*           GNU General Public License for more details.                               *
+*                                                                                      *
+*           You should have received a copy of the GNU General Public License          *
+*           along with this program;  if not, write to the Free Software               *
+*           Foundation, Inc., 59 Temple Place #330, Boston, MA 02111-1307, USA.        *
+*                                                                                      *
+*                   or visit: http://www.gnu.org/licenses/gpl.html                     *
+*                                                                                      *
+****************************************************************************************
+*                                                                                      *
+*  Floppy library and disk sets.                                                       *
+*                                                                                      *
+*  --floppylib DIR keeps one canonical DC42 copy of every image that goes through it,  *
+*  named after a hash of the original file's contents.  MacBinary, DART and checksum   *
+*  checks happen once, when the copy is made, and the copy is written to a temp name   *
+*  and renamed into place so several emulators can share the same library.  Library    *
+*  images are inserted read-only with private writes, so they're mapped straight from  *
+*  the page cache and every instance shares the same pages.                            *
+*                                                                                      *
+*  --disks a;b;c is the set an installer asks for, {disk N} in a --type script puts    *
+*  disk N of it in the drive.  Without a library the set's images are inserted as-is.  *
+*                                                                                      *
+\**************************************************************************************/
+
+#define IN_FLOPPYLIB_C
+#include <vars.h>
+#include <sys/stat.h>
+
+#define FLOPPYLIB_MAXSET 64
+#define FNV64_OFFSET 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x00000100000001b3ULL
+
+typedef struct
+{
+  char src[FILENAME_MAX];  // image as given on the command line
+  char dc42[FILENAME_MAX]; // its copy in the library, or "" to insert src itself
+} floppylib_disk_t;
+
+static char lib_dir[FILENAME_MAX] = "";
+static floppylib_disk_t *set = NULL;
+static int set_len = 0;
+
+int floppylib_set_dir(const char *dir)
+{
+  struct stat st;
+
+  lib_dir[0] = 0;
+  if (!dir || !*dir)
+    return 0;
+
+#ifndef __MSVCRT__
+  if (mkdir(dir, 0755) && errno != EEXIST)
+#else
+  if (mkdir(dir) && errno != EEXIST)
+#endif
+    return -1;
+  if (stat(dir, &st) || !S_ISDIR(st.st_mode))
+    return -1;
+
+  strncpy(lib_dir, dir, FILENAME_MAX - 1);
+  lib_dir[FILENAME_MAX - 1] = 0;
+  return 0;
+}
+
+// hash the whole file, returns -1 if it can't be read
+static int floppylib_hash(const char *image, uint64 *hash, long *size)
+{
+  uint8 buf[65536];
+  uint64 h = FNV64_OFFSET;
+  long total = 0;
+  size_t n, i;
+  FILE *f = fopen(image, "rb");
+
+  if (!f)
+    return -1;
+
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+  {
+    for (i = 0; i < n; i++)
+      h = (h ^ buf[i]) * FNV64_PRIME;
+    total += (long)n;
+  }
+  fclose(f);
+
+  *hash = h;
+  *size = total;
+  return 0;
+}
+
+// copy size bytes of src starting at offset into dst
+static int floppylib_copy(const char *src, long offset, long size, const char *dst)
+{
+  uint8 buf[65536];
+  FILE *in = fopen(src, "rb"), *out;
+  int ret = 0;
+
+  if (!in)
+    return -1;
+  out = fopen(dst, "wb");
+  if (!out)
+  {
+    fclose(in);
+    return -1;
+  }
+
+  fseek(in, offset, SEEK_SET);
+  while (size > 0 && !ret)
+  {
+    size_t n = fread(buf, 1, (size_t)MIN(size, (long)sizeof(buf)), in);
+
+    if (!n || fwrite(buf, 1, n, out) != n)
+      ret = -1;
+    size -= (long)n;
+  }
+
+  fclose(in);
+  if (fclose(out))
+    ret = -1;
+  if (ret)
+    remove(dst);
+  return ret;
+}
+
+// Find or make the library copy of image, puts its path in dc42.  Returns -1 if there's no
+// library, or if the image can't be opened or fails its checksums - those are left for
+// floppy_insert() to complain about as usual.
+int floppylib_canonical(const char *image, char *dc42, int len)
+{
+  char tmp[FILENAME_MAX];
+  DC42ImageType F;
+  uint64 hash;
+  long size;
+  int err;
+
+  if (!lib_dir[0] || floppylib_hash(image, &hash, &size))
+    return -1;
+
+  snprintf(dc42, len, "%s/%016llx-%lx.dc42", lib_dir, (unsigned long long)hash, size);
+  if (!access(dc42, R_OK))
+    return 0; // converted and checked on some earlier run
+
+  memset(&F, 0, sizeof(DC42ImageType));
+  err = dc42_auto_open(&F, (char *)image, "pb");
+  if (err)
+  {
+    ALERT_LOG(0, "Not adding %s to the floppy library, could not open it: %s", image, F.errormsg);
+    return -1;
+  }
+
+  err = dc42_check_checksums(&F);
+  if (!err)
+  {
+    // F.fname is the DC42 auto_open ended up with, after any MacBinary/DART conversion
+    snprintf(tmp, FILENAME_MAX, "%s/.tmp-%d-%016llx", lib_dir, (int)getpid(), (unsigned long long)hash);
+    err = floppylib_copy(F.fname, F.dc42seekstart, (long)F.size, tmp);
+    if (!err && rename(tmp, dc42))
+    {
+      // lost a race with another instance on a system where rename won't replace it
+      remove(tmp);
+      err = access(dc42, R_OK);
+    }
+  }
+  else
+    ALERT_LOG(0, "Not adding %s to the floppy library, its checksums don't match", image);
+
+  F.close_image(&F);
+  if (err)
+    return -1;
+
+  ALERT_LOG(0, "Added %s to the floppy library as %s", image, dc42);
+  return 0;
+}
+
+// list is ;-separated, returns the number of disks in the set or -1
+int floppylib_set_disks(const char *list)
+{
+  const char *s = list, *e;
+  int n;
+
+  free(set);
+  set = NULL;
+  set_len = 0;
+  if (!list || !*list)
+    return 0;
+
+  set = (floppylib_disk_t *)calloc(FLOPPYLIB_MAXSET, sizeof(floppylib_disk_t));
+  if (!set)
+    return -1;
+
+  while (*s && set_len < FLOPPYLIB_MAXSET)
+  {
+    floppylib_disk_t *d = &set[set_len];
+
+    e = strchr(s, ';');
+    n = (int)(e ? e - s : (long)strlen(s));
+    if (n)
+    {
+      n = MIN(n, FILENAME_MAX - 1);
+      memcpy(d->src, s, n);
+      d->src[n] = 0;
+      if (access(d->src, R_OK))
+      {
+        ALERT_LOG(0, "Can't read disk %d of the set, %s", set_len + 1, d->src);
+        return -1;
+      }
+      // convert the whole set up front, so swapping disks later on is just an open
+      if (floppylib_canonical(d->src, d->dc42, FILENAME_MAX))
+        d->dc42[0] = 0;
+      set_len++;
+    }
+    if (!e)
+      break;
+    s = e + 1;
+  }
+  return set_len;
+}
+
+int floppylib_disks(void) { return set_len; }
+
+// Set disks go in the upper drive on a Lisa 1, the only one on a Lisa 2.  Has the Lisa ejected
+// whatever was in it?
+int floppylib_drive_empty(void)
+{
+  if (floppy_iorom == 0x40)
+    return !is_upper_floppy_currently_inserted();
+  return !is_lower_floppy_currently_inserted();
+}
+
+// Put disk n (from 1) of the set in the drive.  Like Insert Diskette, this won't swap a disk
+// out from under the Lisa, so it fails if the drive isn't empty.
+int floppylib_insert_disk(int n)
+{
+  uint8 upper = (floppy_iorom == 0x40);
+  floppylib_disk_t *d;
+  int err;
+
+  if (n < 1 || n > set_len)
+  {
+    ALERT_LOG(0, "There's no disk %d in the set of %d", n, set_len);
+    return -1;
+  }
+  if (!floppylib_drive_empty())
+  {
+    ALERT_LOG(0, "Not inserting disk %d of the set, the drive still has a disk in it", n);
+    return -1;
+  }
+  d = &set[n - 1];
+
+  ALERT_LOG(0, "Inserting disk %d of the set, %s", n, d->src);
+  if (d->dc42[0])
+    err = floppy_insert_readonly(d->dc42, upper);
+  else
+    err = floppy_insert(d->src, upper);
+
+  if (!err)
+    insert_floppy_animation();
+  return err;
+}
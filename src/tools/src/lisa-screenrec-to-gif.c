@@ -0,0 +1,419 @@
+/**************************************************************************************\
+*                   A part of the Apple Lisa 2 Emulator Project                        *
+*                                                                                      *
+*                    Copyright (C) 2020  Ray A. Arachelian                             *
+*                            All Rights Reserved                                       *
+*                                                                                      *
+*          Convert LisaEm screen recordings (lisaem --screenrec, see screenrec.h)      *
+*              into animated GIFs, or a PBM stream for ffmpeg and friends.             *
+*                                                                                      *
+\**************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../../include/screenrec.h"
+
+typedef struct
+{
+  int type, flags, width, height, xbytes, first, nlines;
+  uint64_t clocks;
+  uint32_t clen;
+} rec_t;
+
+static uint8_t frame[SCREENREC_MAX_FRAME];  // current frame in the geometry of the last record
+static uint8_t band[SCREENREC_MAX_FRAME];
+static uint8_t cdata[SCREENREC_LZ4_BOUND(SCREENREC_MAX_FRAME)];
+static int fwidth, fheight, fxbytes;        // geometry of frame[]
+static int canvas_w, canvas_h;               // largest geometry in the file, what we output
+
+void usage(void)
+{
+  fprintf(stderr, "Usage: lisa-screenrec-to-gif [-s scale] recording.lrec output.gif\n");
+  fprintf(stderr, "       lisa-screenrec-to-gif -p [-f fps] recording.lrec >frames.pbm\n\n");
+  fprintf(stderr, "  -s scale  slow down (>1) or speed up (<1) the GIF, default 1.0\n");
+  fprintf(stderr, "  -p        write a PBM stream at a fixed frame rate to stdout, i.e.\n");
+  fprintf(stderr, "            lisa-screenrec-to-gif -p -f 30 x.lrec | ffmpeg -f image2pipe -c:v pbm -framerate 30 -i - x.mp4\n");
+  fprintf(stderr, "  -f fps    frame rate of the PBM stream, default 30\n");
+  exit(1);
+}
+
+static uint32_t get16(uint8_t *p) { return (p[0] << 8) | p[1]; }
+static uint32_t get32(uint8_t *p) { return (get16(p) << 16) | get16(p + 2); }
+
+// returns 1 with the header in r, 0 at end of file, -1 on a bad record
+static int read_header(FILE *f, rec_t *r)
+{
+  uint8_t h[SCREENREC_HEADER_SIZE];
+
+  if (fread(h, SCREENREC_HEADER_SIZE, 1, f) != 1)
+    return 0;
+  r->type = h[0];
+  r->flags = h[1];
+  r->width = get16(&h[2]);
+  r->height = get16(&h[4]);
+  r->xbytes = get16(&h[6]);
+  r->first = get16(&h[8]);
+  r->nlines = get16(&h[10]);
+  r->clocks = ((uint64_t)get32(&h[12]) << 32) | get32(&h[16]);
+  r->clen = get32(&h[20]);
+
+  if ((r->type != SCREENREC_KEYFRAME && r->type != SCREENREC_DELTA) || r->xbytes * r->height > SCREENREC_MAX_FRAME ||
+      r->first + r->nlines > r->height || r->xbytes * 8 < r->width || r->clen > sizeof(cdata))
+    return -1;
+  return 1;
+}
+
+static int lz4_decompress(const uint8_t *src, int slen, uint8_t *dst, int dlen)
+{
+  const uint8_t *ip = src, *iend = src + slen;
+  uint8_t *op = dst, *oend = dst + dlen;
+  int len, off, b;
+
+  while (ip < iend)
+  {
+    int token = *ip++;
+
+    len = token >> 4;
+    if (len == 15)
+      do
+      {
+        if (ip >= iend)
+          return -1;
+        len += (b = *ip++);
+      } while (b == 255);
+    if (ip + len > iend || op + len > oend)
+      return -1;
+    memcpy(op, ip, len);
+    ip += len;
+    op += len;
+    if (ip >= iend)
+      break; // last sequence is literals only
+
+    if (ip + 2 > iend)
+      return -1;
+    off = ip[0] | (ip[1] << 8);
+    ip += 2;
+    len = (token & 15) + 4;
+    if ((token & 15) == 15)
+      do
+      {
+        if (ip >= iend)
+          return -1;
+        len += (b = *ip++);
+      } while (b == 255);
+    if (off == 0 || op - off < dst || op + len > oend)
+      return -1;
+    while (len--) // byte at a time, matches may overlap
+    {
+      *op = *(op - off);
+      op++;
+    }
+  }
+  return (int)(op - dst);
+}
+
+// read a record's data and apply it to frame[]
+static int apply_record(FILE *f, rec_t *r)
+{
+  int len = r->nlines * r->xbytes, i;
+  uint8_t *p = &frame[r->first * r->xbytes];
+
+  if (fread(cdata, r->clen, 1, f) != 1 && r->clen)
+    return -1;
+  if (r->flags & SCREENREC_RAW)
+  {
+    if ((int)r->clen != len)
+      return -1;
+    memcpy(band, cdata, len);
+  }
+  else if (lz4_decompress(cdata, r->clen, band, len) != len)
+    return -1;
+
+  if (r->type == SCREENREC_KEYFRAME)
+  {
+    fwidth = r->width;
+    fheight = r->height;
+    fxbytes = r->xbytes;
+    memset(frame, 0, sizeof(frame));
+    memcpy(p, band, len);
+  }
+  else
+  {
+    if (r->xbytes != fxbytes || r->height != fheight)
+      return -1; // delta without a keyframe for this geometry
+    for (i = 0; i < len; i++)
+      p[i] ^= band[i];
+  }
+  return 0;
+}
+
+static inline int pixel(int x, int y)
+{
+  if (x >= fwidth || y >= fheight)
+    return 0;
+  return (frame[y * fxbytes + (x >> 3)] >> (7 - (x & 7))) & 1;
+}
+
+//----------------------------------------------------------------------------------------------
+// GIF writer - 2 colour global palette, LZW with a minimum code size of 2.
+
+static FILE *gif;
+static uint8_t gifblock[256];
+static int gifblocklen;
+static uint32_t gifbits;
+static int gifbitcount;
+static uint16_t lzwchild[4096][2];
+
+static void gif_byte(int b)
+{
+  gifblock[gifblocklen++] = (uint8_t)b;
+  if (gifblocklen == 255)
+  {
+    fputc(255, gif);
+    fwrite(gifblock, 255, 1, gif);
+    gifblocklen = 0;
+  }
+}
+
+static void gif_code(int code, int size)
+{
+  gifbits |= (uint32_t)code << gifbitcount;
+  gifbitcount += size;
+  while (gifbitcount >= 8)
+  {
+    gif_byte(gifbits & 0xff);
+    gifbits >>= 8;
+    gifbitcount -= 8;
+  }
+}
+
+static void gif_le16(int v)
+{
+  fputc(v & 0xff, gif);
+  fputc((v >> 8) & 0xff, gif);
+}
+
+static void gif_start(void)
+{
+  fwrite("GIF89a", 6, 1, gif);
+  gif_le16(canvas_w);
+  gif_le16(canvas_h);
+  fputc(0x80, gif);                             // global colour table of 2 entries
+  fputc(0, gif);                                // background
+  fputc(0, gif);                                // aspect
+  fwrite("\xff\xff\xff\x00\x00\x00", 6, 1, gif); // 0=white 1=black, just like the Lisa
+  fwrite("\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 19, 1, gif); // loop forever
+}
+
+// write lines first..first+nlines-1 of the canvas as a frame shown for delay/100ths of a second
+static void gif_frame(int first, int nlines, int delay)
+{
+  enum
+  {
+    CLEAR = 4,
+    EOI = 5,
+    FIRSTFREE = 6
+  };
+  int x, y, prefix = -1, next = FIRSTFREE, size = 3;
+
+  fwrite("\x21\xf9\x04\x04", 4, 1, gif); // graphic control: leave the frame in place
+  gif_le16(delay);
+  fputc(0, gif);
+  fputc(0, gif);
+
+  fputc(0x2c, gif); // image descriptor, only the changed band
+  gif_le16(0);
+  gif_le16(first);
+  gif_le16(canvas_w);
+  gif_le16(nlines);
+  fputc(0, gif);
+
+  fputc(2, gif); // LZW minimum code size
+  gifblocklen = 0;
+  gifbits = 0;
+  gifbitcount = 0;
+  memset(lzwchild, 0, sizeof(lzwchild));
+  gif_code(CLEAR, size);
+
+  for (y = first; y < first + nlines; y++)
+    for (x = 0; x < canvas_w; x++)
+    {
+      int p = pixel(x, y);
+
+      if (prefix < 0)
+      {
+        prefix = p;
+        continue;
+      }
+      if (lzwchild[prefix][p])
+      {
+        prefix = lzwchild[prefix][p];
+        continue;
+      }
+
+      gif_code(prefix, size);
+      lzwchild[prefix][p] = (uint16_t)next++;
+      if (next > (1 << size) && size < 12)
+        size++;
+      if (next == 4096) // table full, start over
+      {
+        gif_code(CLEAR, size);
+        memset(lzwchild, 0, sizeof(lzwchild));
+        next = FIRSTFREE;
+        size = 3;
+      }
+      prefix = p;
+    }
+
+  gif_code(prefix, size);
+  gif_code(EOI, size);
+  if (gifbitcount)
+    gif_byte(gifbits & 0xff);
+  if (gifblocklen)
+  {
+    fputc(gifblocklen, gif);
+    fwrite(gifblock, gifblocklen, 1, gif);
+  }
+  fputc(0, gif); // end of image data
+}
+
+//----------------------------------------------------------------------------------------------
+
+static void write_pbm(FILE *out)
+{
+  static uint8_t line[SCREENREC_MAX_FRAME];
+  int y, cxbytes = (canvas_w + 7) / 8;
+
+  fprintf(out, "P4\n%d %d\n", canvas_w, canvas_h);
+  for (y = 0; y < canvas_h; y++)
+  {
+    memset(line, 0, cxbytes);
+    if (y < fheight)
+      memcpy(line, &frame[y * fxbytes], fxbytes < cxbytes ? fxbytes : cxbytes);
+    fwrite(line, cxbytes, 1, out);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  char *in = NULL, *out = NULL, magic[8];
+  int i, ret, pbm = 0, gif_started = 0;
+  double fps = 30.0, scale = 1.0, t, owed = 0.0;
+  long frames = 0;
+  FILE *f;
+  rec_t r, pending;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-p"))
+      pbm = 1;
+    else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+      fps = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+      scale = atof(argv[++i]);
+    else if (argv[i][0] == '-')
+      usage();
+    else if (!in)
+      in = argv[i];
+    else if (!out)
+      out = argv[i];
+    else
+      usage();
+  }
+  if (!in || (!pbm && !out) || fps <= 0 || scale <= 0)
+    usage();
+
+  f = fopen(in, "rb");
+  if (!f || fread(magic, 8, 1, f) != 1 || memcmp(magic, SCREENREC_MAGIC, 8))
+  {
+    fprintf(stderr, "%s is not a LisaEm screen recording\n", in);
+    return 2;
+  }
+
+  // first pass over the headers for the largest geometry, so XL and normal frames can share an output
+  while ((ret = read_header(f, &r)) > 0 && !fseek(f, r.clen, SEEK_CUR))
+  {
+    if (r.width > canvas_w)
+      canvas_w = r.width;
+    if (r.height > canvas_h)
+      canvas_h = r.height;
+  }
+  if (!canvas_w)
+  {
+    fprintf(stderr, "%s has no frames\n", in);
+    return 2;
+  }
+  fseek(f, 8, SEEK_SET);
+
+  if (!pbm)
+  {
+    gif = fopen(out, "wb");
+    if (!gif)
+    {
+      fprintf(stderr, "Could not create %s: %s\n", out, strerror(errno));
+      return 3;
+    }
+    gif_start();
+  }
+
+  t = 0.0; // time of the next PBM frame, in seconds
+  memset(&pending, 0, sizeof(pending));
+  while ((ret = read_header(f, &r)) > 0)
+  {
+    if (pbm)
+    {
+      // frame[] holds what was on screen until this record's time
+      for (; t * SCREENREC_CLOCKS_PER_SEC < (double)r.clocks && frames; t += 1.0 / fps, frames++)
+        write_pbm(stdout);
+    }
+    else if (gif_started)
+    {
+      // the previous record's frame is shown until this one, GIF delays are in 1/100ths
+      // viewers won't go below 2, so carry the rounding over to later frames to keep the pace right.
+      double delay = (double)(r.clocks - pending.clocks) * 100.0 * scale / SCREENREC_CLOCKS_PER_SEC;
+      int d = (int)(delay - owed + 0.5);
+
+      d = d < 2 ? 2 : (d > 65535 ? 65535 : d);
+      owed += d - delay;
+      gif_frame(pending.type == SCREENREC_KEYFRAME ? 0 : pending.first,
+                pending.type == SCREENREC_KEYFRAME ? canvas_h : pending.nlines, d);
+      frames++;
+    }
+
+    if (apply_record(f, &r))
+    {
+      ret = -1;
+      break;
+    }
+
+    if (pbm && !frames) // first frame starts the clock
+    {
+      t = (double)r.clocks / SCREENREC_CLOCKS_PER_SEC;
+      frames = 1;
+      write_pbm(stdout);
+      t += 1.0 / fps;
+    }
+    pending = r;
+    gif_started = 1;
+  }
+
+  if (ret < 0)
+    fprintf(stderr, "Bad record in %s, stopping there.\n", in);
+
+  if (pbm)
+    write_pbm(stdout); // hold the last frame for one more tick
+  else
+  {
+    if (gif_started)
+      gif_frame(pending.type == SCREENREC_KEYFRAME ? 0 : pending.first,
+                pending.type == SCREENREC_KEYFRAME ? canvas_h : pending.nlines, 100);
+    fputc(0x3b, gif); // trailer
+    fclose(gif);
+    fprintf(stderr, "Wrote %ld frames to %s\n", frames + 1, out);
+  }
+
+  fclose(f);
+  return ret < 0 ? 4 : 0;
+}
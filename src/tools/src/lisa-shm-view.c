@@ -0,0 +1,166 @@
+/**************************************************************************************\
+*                   A part of the Apple Lisa 2 Emulator Project                        *
+*                                                                                      *
+*                    Copyright (C) 2020  Ray A. Arachelian                             *
+*                            All Rights Reserved                                       *
+*                                                                                      *
+*          Reference viewer/recorder for LisaEm's shared memory video export           *
+*                        (lisaem --shm <name>, see shmvideo.h)                         *
+*                                                                                      *
+\**************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/shmvideo.h"
+
+static int width, height, xbytes;
+static uint8_t frame[SHMVIDEO_MAX_LINES * 128];
+
+void usage(void)
+{
+  fprintf(stderr, "Usage: lisa-shm-view [-o prefix] [-n frames] [-i msec] [-1] name\n\n");
+  fprintf(stderr, "  name       shared memory segment given to lisaem --shm\n");
+  fprintf(stderr, "  -o prefix  write each changed frame as prefix-NNNNNN.pbm\n");
+  fprintf(stderr, "  -n frames  stop after this many changed frames\n");
+  fprintf(stderr, "  -i msec    polling interval, default 20\n");
+  fprintf(stderr, "  -1         write a single snapshot to stdout as a PBM and exit\n\n");
+  fprintf(stderr, "Without -o or -1 a status line is printed for each frame with changes.\n");
+  exit(1);
+}
+
+// Copy the lines changed since lastframe into our own frame buffer.  Returns the number of lines
+// copied, or -1 if the emulator published another frame while we were copying (try again).
+static int grab_frame(shmvideo_header *hdr, uint32_t lastframe, uint32_t *gotframe)
+{
+  uint32_t seq, y, changed = 0;
+  uint8_t *ram = SHMVIDEO_RAM(hdr);
+
+  seq = hdr->seq;
+  if (seq & 1)
+    return -1;
+  __sync_synchronize();
+
+  width = hdr->width;
+  height = hdr->height;
+  xbytes = hdr->xbytes;
+  if (height > SHMVIDEO_MAX_LINES || xbytes > 128 || hdr->video_offset + xbytes * height > hdr->ram_size)
+    return -1;
+
+  for (y = 0; y < (uint32_t)height; y++)
+    if (hdr->line_frame[y] > lastframe || !lastframe)
+    {
+      memcpy(&frame[y * xbytes], &ram[hdr->video_offset + y * xbytes], xbytes);
+      changed++;
+    }
+  *gotframe = hdr->frame;
+
+  __sync_synchronize();
+  return (hdr->seq == seq) ? (int)changed : -1;
+}
+
+static int write_pbm(FILE *f)
+{
+  fprintf(f, "P4\n%d %d\n", width, height); // 1=black, msb first, just like the Lisa
+  return fwrite(frame, xbytes, height, f) == (size_t)height ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+  char *prefix = NULL, *name = NULL, shmname[256], filename[1024];
+  int i, fd, snapshot = 0, interval = 20, changed;
+  long maxframes = -1, frames = 0;
+  uint32_t lastframe = 0, gotframe = 0;
+  struct stat st;
+  shmvideo_header *hdr;
+  FILE *f;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      prefix = argv[++i];
+    else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+      maxframes = atol(argv[++i]);
+    else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+      interval = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-1"))
+      snapshot = 1;
+    else if (argv[i][0] == '-' || name)
+      usage();
+    else
+      name = argv[i];
+  }
+  if (!name)
+    usage();
+
+  fprintf(stderr, "  ---------------------------------------------------------------------------\n");
+  fprintf(stderr, "    Lisa Shared Memory Video Viewer v0.0.1          http://lisaem.sunder.net\n");
+  fprintf(stderr, "  ---------------------------------------------------------------------------\n");
+  fprintf(stderr, "          Copyright (C) 2020, Ray A. Arachelian, All Rights Reserved.\n");
+  fprintf(stderr, "              Released under the GNU Public License, Version 2.0\n");
+  fprintf(stderr, "    There is absolutely no warranty for this program. Use at your own risk.  \n");
+  fprintf(stderr, "  ---------------------------------------------------------------------------\n\n");
+
+  snprintf(shmname, sizeof(shmname), "%s%s", (name[0] == '/') ? "" : "/", name);
+  fd = shm_open(shmname, O_RDONLY, 0);
+  if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < SHMVIDEO_HEADER_SIZE)
+  {
+    fprintf(stderr, "Could not open shared memory segment %s: %s\n", shmname, strerror(errno));
+    return 2;
+  }
+
+  // read only, so a viewer can never disturb the emulator
+  hdr = (shmvideo_header *)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (hdr == MAP_FAILED || hdr->magic != SHMVIDEO_MAGIC || hdr->version != SHMVIDEO_VERSION ||
+      hdr->header_size + hdr->ram_size > (uint32_t)st.st_size)
+  {
+    fprintf(stderr, "%s is not a LisaEm video segment\n", shmname);
+    return 3;
+  }
+
+  for (;;)
+  {
+    if (!hdr->flags)
+    {
+      fprintf(stderr, "LisaEm (pid %u) has exited.\n", hdr->pid);
+      return 0;
+    }
+
+    if (hdr->frame != lastframe || (snapshot && !gotframe))
+    {
+      changed = grab_frame(hdr, snapshot ? 0 : lastframe, &gotframe);
+      if (changed < 0)
+        continue; // raced the emulator, go again
+
+      if (snapshot)
+        return write_pbm(stdout) ? 4 : 0;
+
+      if (changed && prefix)
+      {
+        snprintf(filename, sizeof(filename), "%s-%06u.pbm", prefix, gotframe);
+        f = fopen(filename, "wb");
+        if (!f || write_pbm(f))
+        {
+          fprintf(stderr, "Could not write %s\n", filename);
+          return 4;
+        }
+        fclose(f);
+      }
+      else if (changed)
+        printf("frame %u clocks %llu: %d of %d lines changed%s\n", gotframe, (unsigned long long)hdr->clocks,
+               changed, height, (hdr->flags & SHMVIDEO_RUNNING) ? "" : " (powered off)");
+
+      lastframe = gotframe;
+      if (changed && maxframes > 0 && ++frames >= maxframes)
+        return 0;
+    }
+
+    usleep(interval * 1000);
+  }
+}